@@ -90,6 +90,55 @@ void profile(const TriangleMesh &mesh)
                 occlusion_output0(ivertex) = (double)num_hits/(double)num_samples;
             }
         }
+
+        AABBTreeIndirect::WideTree wide_tree;
+        {
+            PROFILE_BLOCK(AABBIndirectWide_Init);
+            wide_tree.build(tree);
+        }
+        {
+            PROFILE_BLOCK(EigenMesh3D_AABBIndirectWide_AmbientOcclusion);
+            occlusion_output0.resize(num_vertices, 1);
+            for (int ivertex = 0; ivertex < num_vertices; ++ ivertex) {
+                const Eigen::Vector3d origin = mesh.its.vertices[ivertex].template cast<double>();
+                const Eigen::Vector3d normal = vertex_normals.row(ivertex).template cast<double>();
+                int num_hits = 0;
+                for (int s = 0; s < num_samples; s++) {
+                    Eigen::Vector3d d = dirs.row(s);
+                    if(d.dot(normal) < 0) {
+                        // reverse ray
+                        d *= -1;
+                    }
+                    igl::Hit hit;
+                    if (AABBTreeIndirect::intersect_ray_first_hit(mesh.its.vertices, mesh.its.indices, wide_tree, (origin + 1e-4 * d).eval(), d, hit))
+                        ++ num_hits;
+                }
+                occlusion_output0(ivertex) = (double)num_hits/(double)num_samples;
+            }
+        }
+        {
+            // All the samples of a vertex are cast as a single packet.
+            PROFILE_BLOCK(EigenMesh3D_AABBIndirectWidePacket_AmbientOcclusion);
+            occlusion_output0.resize(num_vertices, 1);
+            std::vector<Eigen::Vector3d> origins(num_samples), directions(num_samples);
+            std::vector<igl::Hit>        hits(num_samples);
+            for (int ivertex = 0; ivertex < num_vertices; ++ ivertex) {
+                const Eigen::Vector3d origin = mesh.its.vertices[ivertex].template cast<double>();
+                const Eigen::Vector3d normal = vertex_normals.row(ivertex).template cast<double>();
+                for (int s = 0; s < num_samples; s++) {
+                    Eigen::Vector3d d = dirs.row(s);
+                    if(d.dot(normal) < 0) {
+                        // reverse ray
+                        d *= -1;
+                    }
+                    origins[s]    = origin + 1e-4 * d;
+                    directions[s] = d;
+                }
+                size_t num_hits = AABBTreeIndirect::intersect_rays_first_hit(mesh.its.vertices, mesh.its.indices, wide_tree,
+                    origins.data(), directions.data(), origins.size(), hits.data());
+                occlusion_output0(ivertex) = (double)num_hits/(double)num_samples;
+            }
+        }
     }
 
     Eigen::MatrixXd occlusion_output1;
@@ -0,0 +1,145 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cmath>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/Model.hpp>
+#include <libslic3r/TriangleMesh.hpp>
+#include <libslic3r/Slicing.hpp>
+#include <libslic3r/SlicingAdaptive.hpp>
+
+const std::string USAGE_STR = {
+    "Usage: adaptiveslicing [modelfile.stl] [quality]\n"
+    "Without a model file, spheres of increasing density are used."
+};
+
+using namespace Slic3r;
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+double seconds_since(const Clock::time_point &t)
+{
+    return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+// The linear scan over the sorted faces as done by SlicingAdaptive::next_layer_height()
+// before the faces crossing the print_z were tracked incrementally, kept for comparison.
+class SlicingAdaptiveScan : public SlicingAdaptive
+{
+public:
+    float next_layer_height_scan(const float print_z, float quality_factor, size_t &current_facet)
+    {
+        auto slope_height = [](const FaceZ &face, float max_surface_deviation) {
+            return std::min(max_surface_deviation / 0.184f, (face.n_cos > 1e-5) ? float(1.44 * max_surface_deviation * sqrt(face.n_sin / face.n_cos)) : FLT_MAX);
+        };
+
+        float height = float(m_slicing_params.max_layer_height);
+        float max_surface_deviation = float((quality_factor < 0.5f) ?
+            lerp(m_slicing_params.min_layer_height, m_slicing_params.layer_height, 2. * quality_factor) :
+            lerp(m_slicing_params.max_layer_height, m_slicing_params.layer_height, 2. * (1. - quality_factor)));
+
+        size_t ordered_id = current_facet;
+        bool   first_hit  = false;
+        for (; ordered_id < m_faces.size(); ++ ordered_id) {
+            const std::pair<float, float> &zspan = m_faces[ordered_id].z_span;
+            if (zspan.first >= print_z)
+                break;
+            if (zspan.second > print_z) {
+                if (! first_hit) {
+                    first_hit = true;
+                    current_facet = ordered_id;
+                }
+                if (zspan.second < print_z + EPSILON)
+                    continue;
+                height = std::min(height, slope_height(m_faces[ordered_id], max_surface_deviation));
+            }
+        }
+        height = std::max(height, float(m_slicing_params.min_layer_height));
+        if (height > float(m_slicing_params.min_layer_height)) {
+            for (; ordered_id < m_faces.size(); ++ ordered_id) {
+                const std::pair<float, float> &zspan = m_faces[ordered_id].z_span;
+                if (zspan.first >= print_z + height)
+                    break;
+                if (zspan.second < print_z + EPSILON)
+                    continue;
+                float reduced_height = slope_height(m_faces[ordered_id], max_surface_deviation);
+                float z_diff = zspan.first - print_z;
+                if (reduced_height < z_diff)
+                    height = z_diff;
+                else if (reduced_height < height)
+                    height = reduced_height;
+            }
+            height = std::max(height, float(m_slicing_params.min_layer_height));
+        }
+        return height;
+    }
+};
+
+void benchmark(const ModelObject &object, float quality)
+{
+    SlicingParameters params = SlicingParameters::create_from_config(PrintConfig::defaults(), PrintObjectConfig::defaults(),
+        object.bounding_box().max.z(), std::vector<unsigned int>{ 1 });
+
+    Clock::time_point t = Clock::now();
+    SlicingAdaptiveScan as;
+    as.set_slicing_parameters(params);
+    as.prepare(object);
+    double t_prepare = seconds_since(t);
+
+    std::vector<float> heights_swept, heights_scanned;
+    t = Clock::now();
+    for (double print_z = params.first_object_layer_height; print_z + EPSILON < params.object_print_z_height();) {
+        heights_swept.emplace_back(as.next_layer_height(float(print_z), quality));
+        print_z += heights_swept.back();
+    }
+    double t_swept = seconds_since(t);
+
+    t = Clock::now();
+    size_t current_facet = 0;
+    for (double print_z = params.first_object_layer_height; print_z + EPSILON < params.object_print_z_height();) {
+        heights_scanned.emplace_back(as.next_layer_height_scan(float(print_z), quality, current_facet));
+        print_z += heights_scanned.back();
+    }
+    double t_scanned = seconds_since(t);
+
+    std::cout << object.volumes.front()->mesh().facets_count() << " facets, " << heights_swept.size() << " layers" << std::endl
+              << "  prepare: " << t_prepare << " s, swept: " << t_swept << " s, scanned: " << t_scanned << " s" << std::endl
+              << "  layer heights " << (heights_swept == heights_scanned ? "match" : "DIFFER") << std::endl;
+}
+
+} // namespace
+
+int main(const int argc, const char *argv[])
+{
+    using std::cout; using std::endl;
+
+    if (argc > 1 && std::string(argv[1]) == "--help") {
+        cout << USAGE_STR << endl;
+        return EXIT_SUCCESS;
+    }
+
+    float quality = argc > 2 ? std::stof(argv[2]) : 0.5f;
+
+    if (argc > 1) {
+        Model model = Model::read_from_file(argv[1]);
+        for (ModelObject *o : model.objects) {
+            o->ensure_on_bed();
+            benchmark(*o, quality);
+        }
+    } else {
+        for (double fa : { 2. * PI / 100., 2. * PI / 300., 2. * PI / 1000. }) {
+            Model model;
+            ModelObject *object = model.add_object();
+            TriangleMesh sphere = make_sphere(25., fa);
+            object->add_volume(sphere);
+            object->add_instance();
+            object->ensure_on_bed();
+            benchmark(*object, quality);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,85 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <random>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/ShortestPath.hpp>
+
+const std::string USAGE_STR = {
+    "Usage: chaining [number_of_segments] [number_of_runs]"
+};
+
+using namespace Slic3r;
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+double seconds_since(const Clock::time_point &t)
+{
+    return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+// Short segments scattered over a 200x200mm bed, like gap fills or sparse
+// infill lines of many small islands. Every fourth segment cannot be reversed.
+void random_segments(size_t n, unsigned seed, Points &end_points, std::vector<bool> &could_reverse)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> pos(0., 200.), len(-2., 2.);
+
+    end_points.clear();
+    could_reverse.clear();
+    for (size_t i = 0; i < n; ++i) {
+        Vec2d a(pos(rng), pos(rng));
+        end_points.emplace_back(Point::new_scale(a.x(), a.y()));
+        end_points.emplace_back(Point::new_scale(a.x() + len(rng), a.y() + len(rng)));
+        could_reverse.emplace_back(i % 4 != 0);
+    }
+}
+
+} // namespace
+
+int main(const int argc, const char *argv[])
+{
+    using std::cout; using std::endl;
+
+    if (argc > 1 && std::string(argv[1]) == "--help") {
+        cout << USAGE_STR << endl;
+        return EXIT_SUCCESS;
+    }
+
+    std::vector<size_t> sizes = {100, 1000, 10000, 100000};
+    if (argc > 1) sizes = {size_t(std::stoul(argv[1]))};
+    size_t runs = argc > 2 ? std::stoul(argv[2]) : 5;
+
+    Point start = Point::new_scale(0., 0.);
+
+    for (size_t n : sizes) {
+        double t_greedy = 0., t_improve = 0., l_greedy = 0., l_improve = 0.;
+        for (size_t run = 0; run < runs; ++run) {
+            Points            end_points;
+            std::vector<bool> could_reverse;
+            random_segments(n, unsigned(run), end_points, could_reverse);
+
+            auto t = Clock::now();
+            std::vector<std::pair<size_t, bool>> chain = chain_segments(end_points, could_reverse, &start);
+            t_greedy += seconds_since(t);
+            l_greedy += chain_travel_length(chain, end_points, &start);
+
+            t = Clock::now();
+            improve_chain(chain, end_points, could_reverse, &start);
+            t_improve += seconds_since(t);
+            l_improve += chain_travel_length(chain, end_points, &start);
+        }
+
+        cout << n << " segments:" << endl;
+        cout << "  greedy:        " << 1000. * t_greedy / runs << " ms, travel "
+             << unscale<double>(l_greedy) / runs << " mm" << endl;
+        cout << "  + local search: " << 1000. * t_improve / runs << " ms, travel "
+             << unscale<double>(l_improve) / runs << " mm ("
+             << 100. * (l_greedy - l_improve) / l_greedy << "% shorter)" << endl;
+    }
+
+    return EXIT_SUCCESS;
+}
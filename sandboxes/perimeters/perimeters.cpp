@@ -0,0 +1,104 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+
+#include <tbb/parallel_for.h>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/Model.hpp>
+#include <libslic3r/Print.hpp>
+#include <libslic3r/Layer.hpp>
+
+const std::string USAGE_STR = {
+    "Usage: perimeters model_file [model_file ...] [--runs number_of_runs]\n"
+    "For example: perimeters tests/data/20mm_cube.obj tests/data/pyramid.obj"
+};
+
+using namespace Slic3r;
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+double seconds_since(const Clock::time_point &t)
+{
+    return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+size_t count_perimeters(const PrintObject &object)
+{
+    size_t n = 0;
+    for (const Layer *layer : object.layers())
+        for (const LayerRegion *layerm : layer->regions())
+            n += layerm->perimeters.items_count();
+    return n;
+}
+
+} // namespace
+
+int main(const int argc, const char *argv[])
+{
+    using std::cout; using std::endl;
+
+    std::vector<std::string> files;
+    size_t runs = 5;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg(argv[i]);
+        if (arg == "--help") {
+            cout << USAGE_STR << endl;
+            return EXIT_SUCCESS;
+        } else if (arg == "--runs" && i + 1 < argc)
+            runs = std::stoul(argv[++i]);
+        else
+            files.emplace_back(std::move(arg));
+    }
+
+    if (files.empty()) {
+        cout << USAGE_STR << endl;
+        return EXIT_FAILURE;
+    }
+
+    DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+
+    for (const std::string &file : files) {
+        Model model = Model::read_from_file(file);
+        model.center_instances_around_point(Vec2d(100., 100.));
+        for (ModelObject *mo : model.objects)
+            mo->ensure_on_bed();
+
+        Print print;
+        print.apply(model, config);
+        print.set_status_silent();
+
+        size_t num_layers = 0, num_perimeters = 0;
+        double t_slice = 0., t_perimeters = 0.;
+        for (PrintObject *object : print.objects()) {
+            auto t = Clock::now();
+            object->slice();
+            t_slice += seconds_since(t);
+
+            // Layer::make_perimeters() only depends on the slices of the layer
+            // and of the layer below, so the layers may be processed in any order.
+            for (size_t run = 0; run < runs; ++run) {
+                t = Clock::now();
+                tbb::parallel_for(tbb::blocked_range<size_t>(0, object->layers().size()),
+                    [object](const tbb::blocked_range<size_t> &range) {
+                        for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++layer_idx)
+                            object->get_layer(int(layer_idx))->make_perimeters();
+                    });
+                t_perimeters += seconds_since(t);
+            }
+            num_layers     += object->layers().size();
+            num_perimeters += count_perimeters(*object);
+        }
+
+        t_perimeters /= double(runs);
+        cout << file << ":" << endl;
+        cout << "  slicing:    " << 1000. * t_slice << " ms, " << num_layers << " layers" << endl;
+        cout << "  perimeters: " << 1000. * t_perimeters << " ms, "
+             << num_layers / t_perimeters << " layers/s, "
+             << num_perimeters / t_perimeters << " perimeters/s" << endl;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,120 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <algorithm>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/Model.hpp>
+#include <libslic3r/SLAPrint.hpp>
+#include <libslic3r/SLA/AGGRaster.hpp>
+#include <libslic3r/SLA/ScanlineRaster.hpp>
+
+const std::string USAGE_STR = {
+    "Usage: slaraster modelfile.stl [gamma]"
+};
+
+using namespace Slic3r;
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+double seconds_since(const Clock::time_point &t)
+{
+    return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+} // namespace
+
+int main(const int argc, const char *argv[])
+{
+    using std::cout; using std::endl;
+
+    if (argc < 2) {
+        cout << USAGE_STR << endl;
+        return EXIT_SUCCESS;
+    }
+
+    double gamma = argc > 2 ? std::stod(argv[2]) : 1.;
+
+    DynamicPrintConfig config;
+    config.apply(SLAFullPrintConfig{});
+    Model model = Model::read_from_file(argv[1]);
+    for (ModelObject *o : model.objects) o->center_around_origin();
+
+    // The rasterization step is skipped without a printer, only the slices
+    // are prepared.
+    SLAPrint print;
+    print.apply(model, config);
+    print.process();
+
+    const SLAPrinterConfig &pcfg = print.printer_config();
+    sla::RasterBase::Resolution res{size_t(pcfg.display_pixels_x.getInt()),
+                                    size_t(pcfg.display_pixels_y.getInt())};
+    sla::RasterBase::PixelDim pxdim{pcfg.display_width.getFloat() / res.width_px,
+                                    pcfg.display_height.getFloat() / res.height_px};
+
+    sla::RasterBase::Trafo trafo;
+    trafo.center_x = scaled(pcfg.display_width.getFloat() / 2.);
+    trafo.center_y = scaled(pcfg.display_height.getFloat() / 2.);
+
+    struct Encoding {
+        const char *       name;
+        sla::RasterEncoder encoder;
+        double             time = 0.;
+        size_t             bytes = 0;
+    };
+
+    std::vector<Encoding> encodings = {
+        {"PNG", sla::PNGRasterEncoder{}},
+        {"PNG level 1", sla::PNGRasterEncoder{1}},
+        {"RLE", sla::RLERasterEncoder{}},
+        {"Delta RLE", sla::DeltaRLERasterEncoder{}}};
+
+    double t_agg = 0., t_scanline = 0.;
+    size_t npolys = 0, ndiff = 0;
+    int    maxdiff = 0;
+
+    for (const SLAPrint::PrintLayer &layer : print.print_layers()) {
+        npolys += layer.transformed_slices().size();
+
+        auto t = Clock::now();
+        sla::RasterGrayscaleAAGammaPower agg(res, pxdim, trafo, gamma);
+        for (const ClipperLib::Polygon &poly : layer.transformed_slices())
+            agg.draw(poly);
+        t_agg += seconds_since(t);
+
+        t = Clock::now();
+        sla::RasterGrayscaleScanline scanline(res, pxdim, trafo, gamma);
+        for (const ClipperLib::Polygon &poly : layer.transformed_slices())
+            scanline.draw(poly);
+        scanline.read_pixel(0, 0); // forces the rasterization
+        t_scanline += seconds_since(t);
+
+        for (Encoding &enc : encodings) {
+            t = Clock::now();
+            enc.bytes += scanline.encode(enc.encoder).size();
+            enc.time += seconds_since(t);
+        }
+
+        for (size_t row = 0; row < res.height_px; ++row)
+            for (size_t col = 0; col < res.width_px; ++col) {
+                int d = std::abs(int(agg.read_pixel(col, row)) -
+                                 int(scanline.read_pixel(col, row)));
+                maxdiff = std::max(maxdiff, d);
+                ndiff += d > 0;
+            }
+    }
+
+    cout << "Layers: " << print.print_layers().size()
+         << ", polygons: " << npolys << endl;
+    cout << "AGGRaster:        " << t_agg << " s" << endl;
+    cout << "Scanline raster:  " << t_scanline << " s" << endl;
+    for (const Encoding &enc : encodings)
+        cout << enc.name << " encoding: " << enc.time << " s, "
+             << enc.bytes / 1024 << " KiB" << endl;
+    cout << "Differing pixels: " << ndiff << ", max difference: " << maxdiff
+         << endl;
+
+    return EXIT_SUCCESS;
+}
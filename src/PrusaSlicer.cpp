@@ -464,6 +464,9 @@ int CLI::run(int argc, char **argv)
                 Print       fff_print;
                 SLAPrint    sla_print;
                 SL1Archive  sla_archive(sla_print.printer_config());
+                // The layers are exported right after slicing, there is no
+                // need to keep them all in memory until then.
+                sla_archive.set_streaming(true);
                 sla_print.set_printer(&sla_archive);
                 sla_print.set_status_callback(
                             [](const PrintBase::SlicingStatus& s)
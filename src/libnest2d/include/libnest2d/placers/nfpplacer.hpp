@@ -8,6 +8,9 @@
 #include <iterator>
 #include <future>
 #include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 #ifndef NDEBUG
 #include <iostream>
@@ -75,6 +78,134 @@ inline void enumerate(
 
 namespace placers {
 
+/**
+ * Identifies the untranslated shape of an item: the raw shape (by a hash of
+ * its contour) together with the inflation and rotation applied to it.
+ */
+template<class RawShape> struct ShapeKey {
+    std::size_t hash = 0;
+    TCoord<TPoint<RawShape>> inflation = 0;
+    double rotation = 0.;
+
+    explicit ShapeKey(const _Item<RawShape>& item):
+        hash(contourHash(item.rawShape())),
+        inflation(item.inflation()),
+        rotation(item.rotation()) {}
+
+    bool operator==(const ShapeKey& other) const {
+        return hash == other.hash && inflation == other.inflation &&
+               rotation == other.rotation;
+    }
+
+    static std::size_t contourHash(const RawShape& sh) {
+        using Coord = TCoord<TPoint<RawShape>>;
+        std::size_t seed = sl::contourVertexCount(sh);
+        auto combine = [&seed](Coord c) {
+            seed ^= std::hash<Coord>()(c) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        };
+        for(auto it = sl::cbegin(sh); it != sl::cend(sh); ++it) {
+            combine(getX(*it)); combine(getY(*it));
+        }
+        return seed;
+    }
+
+    static bool sameContour(const RawShape& a, const RawShape& b) {
+        using Vertex = TPoint<RawShape>;
+        return sl::contourVertexCount(a) == sl::contourVertexCount(b) &&
+               std::equal(sl::cbegin(a), sl::cend(a), sl::cbegin(b),
+                          [](const Vertex& v1, const Vertex& v2) {
+            return getX(v1) == getX(v2) && getY(v1) == getY(v2);
+        });
+    }
+};
+
+/**
+ * Cache of the no-fit polygons computed for pairs of convex items.
+ *
+ * The nfp of an item pair only depends on the untranslated shapes of the two
+ * items, the translation of the stationary item merely offsets it. The entries
+ * are stored relative to the translation of the stationary item, so they can
+ * be reused for every placement of the same two shapes. This is what happens
+ * all the time when many instances of the same object are arranged.
+ *
+ * The cache is thread safe and can be shared by the placers of subsequent
+ * arrangements. It is cleared when it grows above its capacity.
+ */
+template<class RawShape> class NfpCache {
+    using Item = _Item<RawShape>;
+    using Key = ShapeKey<RawShape>;
+
+    struct PairKey {
+        Key stationary, orbiter;
+        bool operator==(const PairKey& o) const {
+            return stationary == o.stationary && orbiter == o.orbiter;
+        }
+    };
+
+    struct PairHash {
+        std::size_t operator()(const PairKey& k) const {
+            return k.stationary.hash * 31 + k.orbiter.hash;
+        }
+    };
+
+    // The raw shapes are kept to rule out hash collisions.
+    struct Entry {
+        RawShape stationary, orbiter, nfp;
+    };
+
+    std::size_t capacity_;
+    mutable std::mutex mutex_;
+    std::unordered_map<PairKey, Entry, PairHash> entries_;
+
+public:
+
+    explicit NfpCache(std::size_t capacity = 20000): capacity_(capacity) {}
+
+    /// Get the nfp of the two items around the stationary item's current
+    /// position. Returns false if the pair of shapes was not cached yet.
+    bool find(const Item& stationary, const Item& orbiter, RawShape& nfp) const
+    {
+        PairKey key{Key(stationary), Key(orbiter)};
+
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            auto it = entries_.find(key);
+            if(it == entries_.end() ||
+               !Key::sameContour(it->second.stationary, stationary.rawShape()) ||
+               !Key::sameContour(it->second.orbiter, orbiter.rawShape()))
+                return false;
+
+            nfp = it->second.nfp;
+        }
+
+        sl::translate(nfp, stationary.translation());
+        return true;
+    }
+
+    /// Store the nfp of the two items calculated at the stationary item's
+    /// current position.
+    void insert(const Item& stationary, const Item& orbiter, const RawShape& nfp)
+    {
+        PairKey key{Key(stationary), Key(orbiter)};
+        Entry entry{stationary.rawShape(), orbiter.rawShape(), nfp};
+        sl::translate(entry.nfp, TPoint<RawShape>{0, 0} - stationary.translation());
+
+        std::lock_guard<std::mutex> lk(mutex_);
+        if(entries_.size() >= capacity_) entries_.clear();
+        entries_.emplace(key, std::move(entry));
+    }
+
+    std::size_t size() const {
+        std::lock_guard<std::mutex> lk(mutex_);
+        return entries_.size();
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lk(mutex_);
+        entries_.clear();
+    }
+};
+
 template<class RawShape>
 struct NfpPConfig {
 
@@ -167,6 +298,15 @@ struct NfpPConfig {
                        const ItemGroup&              // remaining items
                        )> before_packing;
 
+    /**
+     * @brief Optional cache for the no-fit polygons of convex item pairs.
+     *
+     * The cache can be shared between placers and kept alive between
+     * arrangements to reuse the nfps of shapes that were already placed next
+     * to each other.
+     */
+    std::shared_ptr<NfpCache<RawShape>> nfp_cache;
+
     NfpPConfig(): rotations({0.0, Pi/2.0, Pi, 3*Pi/2}),
         alignment(Alignment::CENTER), starting_point(Alignment::CENTER) {}
 };
@@ -576,11 +716,69 @@ private:
 
     using Shapes = TMultiShape<RawShape>;
 
+    // The merged nfp of the last few orbiting shapes, together with the
+    // items it was calculated for. When the next item has the same shape and
+    // the packed items only got appended to, the nfps of the new items are
+    // merged into it instead of merging the nfps of all the items again.
+    struct PlacedItem {
+        const Item *item;
+        Vertex translation;
+        double rotation;
+
+        explicit PlacedItem(const Item& itm):
+            item(&itm), translation(itm.translation()),
+            rotation(itm.rotation()) {}
+
+        bool unchanged(const Item& itm) const {
+            return item == &itm && translation == itm.translation() &&
+                   rotation == double(itm.rotation());
+        }
+    };
+
+    struct MergedNfp {
+        ShapeKey<RawShape> orbiter;
+        RawShape orbiter_shape;
+        std::vector<PlacedItem> items;
+        Shapes nfp;
+    };
+
+    std::vector<MergedNfp> merged_nfps_;
+
+    MergedNfp* findMergedNfp(const Item& trsh)
+    {
+        ShapeKey<RawShape> key(trsh);
+        for(MergedNfp& m : merged_nfps_) {
+            if(!(m.orbiter == key) ||
+               !ShapeKey<RawShape>::sameContour(m.orbiter_shape, trsh.rawShape()))
+                continue;
+
+            bool valid = m.items.size() <= items_.size();
+            for(size_t i = 0; valid && i < m.items.size(); ++i)
+                valid = m.items[i].unchanged(items_[i]);
+
+            if(valid) return &m;
+            m.items.clear(); m.nfp.clear();
+            return &m;
+        }
+
+        // One entry per rotation of the orbiting shape is plenty
+        if(merged_nfps_.size() >= std::max<size_t>(config_.rotations.size(), 1))
+            merged_nfps_.erase(merged_nfps_.begin());
+
+        merged_nfps_.emplace_back(
+            MergedNfp{key, trsh.rawShape(), {}, {}});
+
+        return &merged_nfps_.back();
+    }
+
     Shapes calcnfp(const Item &trsh, Lvl<nfp::NfpLevel::CONVEX_ONLY>)
     {
         using namespace nfp;
 
-        Shapes nfps(items_.size());
+        MergedNfp *merged = findMergedNfp(trsh);
+        size_t first = merged->items.size();
+
+        Shapes nfps(items_.size() - first);
 
         // /////////////////////////////////////////////////////////////////////
         // TODO: this is a workaround and should be solved in Item with mutexes
@@ -599,17 +797,30 @@ private:
         }
         // /////////////////////////////////////////////////////////////////////
 
-        __parallel::enumerate(items_.begin(), items_.end(),
-                              [&nfps, &trsh](const Item& sh, size_t n)
+        NfpCache<RawShape> *cache = config_.nfp_cache.get();
+
+        __parallel::enumerate(items_.begin() + first, items_.end(),
+                              [&nfps, &trsh, cache](const Item& sh, size_t n)
         {
+            if(cache && cache->find(sh, trsh, nfps[n])) return;
+
             auto& fixedp = sh.transformedShape();
             auto& orbp = trsh.transformedShape();
             auto subnfp_r = noFitPolygon<NfpLevel::CONVEX_ONLY>(fixedp, orbp);
             correctNfpPosition(subnfp_r, sh, trsh);
             nfps[n] = subnfp_r.first;
+
+            if(cache) cache->insert(sh, trsh, nfps[n]);
         });
 
-        return nfp::merge(nfps);
+        if(first > 0)
+            nfps.insert(nfps.end(), merged->nfp.begin(), merged->nfp.end());
+
+        merged->nfp = nfp::merge(nfps);
+        for(size_t i = first; i < items_.size(); ++i)
+            merged->items.emplace_back(items_[i]);
+
+        return merged->nfp;
     }
 
 
@@ -7,12 +7,22 @@
 #define slic3r_AABBTreeIndirect_hpp_
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
 #include <limits>
 #include <type_traits>
 #include <vector>
 
+#include <tbb/parallel_invoke.h>
+
 #include "Utils.hpp" // for next_highest_power_of_2()
 
+// SSE/SSE2 is supported by any Intel/AMD x64 processor.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define SLIC3R_AABB_SSE
+    #include <xmmintrin.h>
+#endif
+
 extern "C"
 {
 // Ray-Triangle Intersection Test Routines by Tomas Moller, May 2000
@@ -141,10 +151,21 @@ private:
 		// Insert an inner node into the tree. Inner node does not reference any input entity (triangle, line segment etc).
 		m_nodes[node].idx  = inner;
 		m_nodes[node].bbox = bbox;
-        build_recursive(input, node * 2 + 1, left, center);
-		build_recursive(input, node * 2 + 2, center + 1, right);
+		// The two subtrees occupy disjoint ranges of both the input and the nodes,
+		// large ones are built in parallel.
+		if (right - left > parallel_build_threshold)
+			tbb::parallel_invoke(
+				[&]() { build_recursive(input, node * 2 + 1, left, center); },
+				[&]() { build_recursive(input, node * 2 + 2, center + 1, right); });
+		else {
+	        build_recursive(input, node * 2 + 1, left, center);
+			build_recursive(input, node * 2 + 2, center + 1, right);
+		}
 	}
 
+	// Minimum number of input entities of a subtree to build its two halves in parallel.
+	static constexpr size_t parallel_build_threshold = 16384;
+
 	// Partition the input m_nodes <left, right> at "k" and "dimension" using the QuickSelect method:
 	// https://en.wikipedia.org/wiki/Quickselect
 	// Items left of the k'th item are lower than the k'th item in the "dimension", 
@@ -214,6 +235,130 @@ using Tree3f = Tree<3, float>;
 using Tree2d = Tree<2, double>;
 using Tree3d = Tree<3, double>;
 
+// Four way AABB tree for ray casting, created by collapsing a balanced binary Tree<3, ...>.
+// The bounding boxes of the four children of a node are stored next to each other
+// (structure of arrays) in single precision, so that a ray is tested against all of them
+// with a few SSE instructions. Leaves are not stored as nodes, a child of a node references
+// either another node or directly the external source entity.
+// Working with a quarter of the nodes of the binary tree and without recursion, the ray
+// casting is considerably faster. Coherent rays (rays of similar origin and direction,
+// for example the rays sampling a cone) may be traversed together as a packet,
+// sharing the loads of the nodes.
+class WideTree
+{
+public:
+    static constexpr size_t Width = 4;
+    enum : size_t {
+        // Child is not used.
+        npos = size_t(-1),
+        // Child references the external source entity (triangle) stored in the lower bits.
+        leaf = size_t(1) << (sizeof(size_t) * 8 - 1)
+    };
+
+    struct alignas(16) Node {
+        // Bounding boxes of the children per dimension. Unused children have
+        // empty (inverted) boxes, which are never hit.
+        float  min[3][Width];
+        float  max[3][Width];
+        // Index of the child node or the source entity with the leaf bit set, npos if unused.
+        size_t child[Width];
+
+        static bool   is_valid(size_t child) { return child != npos; }
+        static bool   is_leaf(size_t child)  { return child != npos && (child & leaf) != 0; }
+        static size_t entity(size_t child)   { return child & ~size_t(leaf); }
+    };
+
+    WideTree() = default;
+    template<typename BinaryTree> explicit WideTree(const BinaryTree &tree) { this->build(tree); }
+
+    void clear() { m_nodes.clear(); }
+
+    template<typename BinaryTree>
+    void build(const BinaryTree &tree)
+    {
+        m_nodes.clear();
+        if (tree.empty())
+            return;
+        // The rays are tested against the boxes in single precision. Padding the boxes by a small
+        // fraction of the coordinates of the tree covers the rounding of the ray origins and
+        // directions, the triangles are intersected with the precision of the ray.
+        const auto &root = tree.node(0).bbox;
+        double pad = std::max(1., double(std::max(root.min().cwiseAbs().maxCoeff(), root.max().cwiseAbs().maxCoeff()))) / double(1 << 20);
+        m_nodes.reserve(tree.nodes().size() / 3 + 1);
+        m_nodes.emplace_back();
+        collapse(tree, 0, 0, pad);
+    }
+
+    const std::vector<Node>& nodes() const { return m_nodes; }
+    const Node&              node(size_t idx) const { return m_nodes[idx]; }
+    bool                     empty() const { return m_nodes.empty(); }
+
+private:
+    // Fill the wide node with up to four descendants of the binary node. The inner descendant
+    // with the largest surface area is replaced by its children until the node is full,
+    // which keeps the large boxes (the ones most likely to be hit) near the root.
+    template<typename BinaryTree>
+    void collapse(const BinaryTree &tree, size_t bin_idx, size_t wide_idx, double pad)
+    {
+        std::array<size_t, Width> children;
+        size_t                    cnt = 0;
+        if (tree.node(bin_idx).is_leaf())
+            children[cnt ++] = bin_idx;
+        else {
+            children[cnt ++] = BinaryTree::left_child_idx(bin_idx);
+            children[cnt ++] = BinaryTree::right_child_idx(bin_idx);
+            while (cnt < Width) {
+                size_t best      = cnt;
+                double best_area = -1.;
+                for (size_t i = 0; i < cnt; ++ i)
+                    if (const auto &n = tree.node(children[i]); n.is_inner()) {
+                        auto   d    = n.bbox.diagonal();
+                        double area = double(d.x()) * d.y() + double(d.y()) * d.z() + double(d.z()) * d.x();
+                        if (area > best_area) {
+                            best      = i;
+                            best_area = area;
+                        }
+                    }
+                if (best == cnt)
+                    break;
+                size_t opened     = children[best];
+                children[best]    = BinaryTree::left_child_idx(opened);
+                children[cnt ++]  = BinaryTree::right_child_idx(opened);
+            }
+        }
+
+        for (size_t lane = 0; lane < Width; ++ lane) {
+            Node &node = m_nodes[wide_idx];
+            if (lane < cnt) {
+                const auto &n = tree.node(children[lane]);
+                assert(n.is_valid());
+                for (int d = 0; d < 3; ++ d) {
+                    node.min[d][lane] = float(double(n.bbox.min()(d)) - pad);
+                    node.max[d][lane] = float(double(n.bbox.max()(d)) + pad);
+                }
+                node.child[lane] = n.is_leaf() ? (n.idx | leaf) : npos;
+            } else {
+                for (int d = 0; d < 3; ++ d) {
+                    node.min[d][lane] = std::numeric_limits<float>::infinity();
+                    node.max[d][lane] = - std::numeric_limits<float>::infinity();
+                }
+                node.child[lane] = npos;
+            }
+        }
+
+        // Recurse into the inner children, the nodes are stored depth first.
+        for (size_t lane = 0; lane < cnt; ++ lane)
+            if (tree.node(children[lane]).is_inner()) {
+                size_t idx = m_nodes.size();
+                m_nodes.emplace_back();
+                m_nodes[wide_idx].child[lane] = idx;
+                collapse(tree, children[lane], idx, pad);
+            }
+    }
+
+	std::vector<Node> m_nodes;
+};
+
 namespace detail {
 	template<typename AVertexType, typename AIndexedFaceType, typename ATreeType, typename AVectorType>
 	struct RayIntersector {
@@ -399,6 +544,183 @@ namespace detail {
 		}
 	}
 
+	// Ray prepared for testing against the single precision boxes of a WideTree.
+	struct WideRay {
+		float origin[3];
+		float invdir[3];
+
+		WideRay() = default;
+		template<typename VectorType>
+		WideRay(const VectorType &o, const VectorType &dir) {
+			for (int i = 0; i < 3; ++ i) {
+				origin[i] = float(o(i));
+				invdir[i] = float(1. / double(dir(i)));
+			}
+		}
+	};
+
+	// Test the ray against the four child boxes of a WideTree node within the ray parameter
+	// interval <0, tmax>. Returns a bit mask of the hit children, tnear receives the ray
+	// parameters, at which the boxes are entered.
+	// NaNs produced by a ray lying in the plane of a box side are ignored by the min / max
+	// operations, same as the scalar ray_box_intersect_invdir() does.
+	inline unsigned ray_box_mask(const WideTree::Node &node, const WideRay &ray, float tmax, float tnear[WideTree::Width])
+	{
+		// Conservative upper bound compensating the rounding of the slab distances,
+		// see "Robust BVH Ray Traversal" by Thiago Ize.
+		tmax *= 1.f + 4.f * std::numeric_limits<float>::epsilon();
+#ifdef SLIC3R_AABB_SSE
+		__m128 tn = _mm_setzero_ps();
+		__m128 tf = _mm_set1_ps(tmax);
+		for (int d = 0; d < 3; ++ d) {
+			__m128 o  = _mm_set1_ps(ray.origin[d]);
+			__m128 id = _mm_set1_ps(ray.invdir[d]);
+			__m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.min[d]), o), id);
+			__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.max[d]), o), id);
+			// If any of the arguments is NaN, the second argument is returned.
+			tn = _mm_max_ps(_mm_min_ps(t0, t1), tn);
+			tf = _mm_min_ps(_mm_max_ps(t0, t1), tf);
+		}
+		_mm_storeu_ps(tnear, tn);
+		return unsigned(_mm_movemask_ps(_mm_cmple_ps(tn, tf)));
+#else
+		unsigned mask = 0;
+		for (size_t lane = 0; lane < WideTree::Width; ++ lane) {
+			float tn = 0.f;
+			float tf = tmax;
+			for (int d = 0; d < 3; ++ d) {
+				float t0 = (node.min[d][lane] - ray.origin[d]) * ray.invdir[d];
+				float t1 = (node.max[d][lane] - ray.origin[d]) * ray.invdir[d];
+				float lo = t1 < t0 ? t1 : t0;
+				float hi = t1 > t0 ? t1 : t0;
+				if (lo > tn) tn = lo;
+				if (hi < tf) tf = hi;
+			}
+			tnear[lane] = tn;
+			if (tn <= tf)
+				mask |= 1u << lane;
+		}
+		return mask;
+#endif
+	}
+
+	// Maximum number of rays traced together by intersect_rays_first_hit(), one bit of a mask for each.
+	static constexpr size_t MaxPacketSize = 64;
+
+	// Depth of the traversal stack. The depth of the WideTree does not exceed the depth
+	// of the balanced binary tree, each level adds at most three pending children.
+	static constexpr size_t WideStackSize = 3 * 64 + 1;
+
+	template<typename VertexType, typename IndexedFaceType, typename VectorType>
+	inline void intersect_packet_first_hit(
+		const std::vector<VertexType> 		&vertices,
+		const std::vector<IndexedFaceType> 	&faces,
+		const WideTree 						&tree,
+		const VectorType 					*origins,
+		const VectorType 					*dirs,
+		size_t 								 num_rays,
+		igl::Hit 							*hits)
+	{
+		assert(num_rays > 0 && num_rays <= MaxPacketSize);
+
+		std::array<WideRay, MaxPacketSize> rays;
+		for (size_t r = 0; r < num_rays; ++ r) {
+			rays[r]    = WideRay(origins[r], dirs[r]);
+			hits[r].id = -1;
+			hits[r].t  = std::numeric_limits<float>::infinity();
+		}
+
+		struct Entry { size_t node; uint64_t rays; };
+		std::array<Entry, WideStackSize> stack;
+		size_t 							 stack_size = 0;
+		stack[stack_size ++] = { 0, num_rays == 64 ? ~uint64_t(0) : (uint64_t(1) << num_rays) - 1 };
+
+		while (stack_size > 0) {
+			const Entry          entry = stack[-- stack_size];
+			const WideTree::Node &node = tree.node(entry.node);
+
+			std::array<uint64_t, WideTree::Width> lane_rays { 0, 0, 0, 0 };
+			std::array<float, WideTree::Width>    lane_near;
+			lane_near.fill(std::numeric_limits<float>::infinity());
+			for (size_t r = 0; r < num_rays; ++ r)
+				if (entry.rays & (uint64_t(1) << r)) {
+					float    tnear[WideTree::Width];
+					unsigned mask = ray_box_mask(node, rays[r], hits[r].t, tnear);
+					for (size_t lane = 0; lane < WideTree::Width; ++ lane)
+						if (mask & (1u << lane)) {
+							lane_rays[lane] |= uint64_t(1) << r;
+							lane_near[lane]  = std::min(lane_near[lane], tnear[lane]);
+						}
+				}
+
+			// Intersect the triangles first, shortening the rays before descending into the inner nodes.
+			std::array<size_t, WideTree::Width> inner;
+			size_t 								num_inner = 0;
+			for (size_t lane = 0; lane < WideTree::Width; ++ lane) {
+				size_t child = node.child[lane];
+				if (lane_rays[lane] == 0 || ! WideTree::Node::is_valid(child))
+					continue;
+				if (! WideTree::Node::is_leaf(child)) {
+					inner[num_inner ++] = lane;
+					continue;
+				}
+				size_t idx  = WideTree::Node::entity(child);
+				auto   face = faces[idx];
+				for (size_t r = 0; r < num_rays; ++ r)
+					if (lane_rays[lane] & (uint64_t(1) << r)) {
+					    double t, u, v;
+						if (intersect_triangle(origins[r], dirs[r], vertices[face(0)], vertices[face(1)], vertices[face(2)], t, u, v)
+							&& t > 0. && float(t) < hits[r].t)
+							hits[r] = igl::Hit { int(idx), -1, float(u), float(v), float(t) };
+					}
+			}
+
+			// Push the inner children, the nearest one goes last to be visited first.
+			std::sort(inner.begin(), inner.begin() + num_inner,
+				[&lane_near](size_t l, size_t r) { return lane_near[l] > lane_near[r]; });
+			for (size_t i = 0; i < num_inner; ++ i) {
+				assert(stack_size < stack.size());
+				stack[stack_size ++] = { node.child[inner[i]], lane_rays[inner[i]] };
+			}
+		}
+	}
+
+	template<typename VertexType, typename IndexedFaceType, typename VectorType>
+	inline void intersect_ray_all_hits_wide(
+		const std::vector<VertexType> 		&vertices,
+		const std::vector<IndexedFaceType> 	&faces,
+		const WideTree 						&tree,
+		const VectorType 					&origin,
+		const VectorType 					&dir,
+		std::vector<igl::Hit> 				&hits)
+	{
+		WideRay 						  ray(origin, dir);
+		std::array<size_t, WideStackSize> stack;
+		size_t 							  stack_size = 0;
+		stack[stack_size ++] = 0;
+
+		while (stack_size > 0) {
+			const WideTree::Node &node = tree.node(stack[-- stack_size]);
+			float    tnear[WideTree::Width];
+			unsigned mask = ray_box_mask(node, ray, std::numeric_limits<float>::infinity(), tnear);
+			for (size_t lane = 0; lane < WideTree::Width; ++ lane) {
+				size_t child = node.child[lane];
+				if (! (mask & (1u << lane)) || ! WideTree::Node::is_valid(child))
+					continue;
+				if (WideTree::Node::is_leaf(child)) {
+					size_t idx  = WideTree::Node::entity(child);
+					auto   face = faces[idx];
+				    double t, u, v;
+					if (intersect_triangle(origin, dir, vertices[face(0)], vertices[face(1)], vertices[face(2)], t, u, v) && t > 0.)
+						hits.emplace_back(igl::Hit{ int(idx), -1, float(u), float(v), float(t) });
+				} else {
+					assert(stack_size < stack.size());
+					stack[stack_size ++] = child;
+				}
+			}
+		}
+	}
+
 	// Nothing to do with COVID-19 social distancing.
 	template<typename AVertexType, typename AIndexedFaceType, typename ATreeType, typename AVectorType>
 	struct IndexedTriangleSetDistancer {
@@ -665,6 +987,95 @@ inline bool intersect_ray_all_hits(
 	return ! hits.empty();
 }
 
+// Find a first intersection of a ray with indexed triangle set using a WideTree
+// built over the AABBTreeIndirect::Tree of the indexed triangle set.
+// Intersection test is calculated with the accuracy of VectorType::Scalar.
+template<typename VertexType, typename IndexedFaceType, typename VectorType>
+inline bool intersect_ray_first_hit(
+	// Indexed triangle set - 3D vertices.
+	const std::vector<VertexType> 		&vertices,
+	// Indexed triangle set - triangular faces, references to vertices.
+	const std::vector<IndexedFaceType> 	&faces,
+	// WideTree over vertices & faces.
+	const WideTree 						&tree,
+	// Origin of the ray.
+	const VectorType					&origin,
+	// Direction of the ray.
+	const VectorType 					&dir,
+	// First intersection of the ray with the indexed triangle set.
+	igl::Hit 							&hit)
+{
+	if (tree.empty())
+		return false;
+	igl::Hit out;
+	detail::intersect_packet_first_hit(vertices, faces, tree, &origin, &dir, 1, &out);
+	if (out.id < 0)
+		return false;
+	hit = out;
+	return true;
+}
+
+// Find the first intersections of a packet of rays with indexed triangle set using a WideTree.
+// The rays are traversed together in groups of up to 64 rays, which pays off if the rays
+// are coherent, for example if they sample a cone or a disk.
+// hits[i].id is -1 if the i-th ray does not hit the indexed triangle set.
+// Returns the number of rays hitting the indexed triangle set.
+template<typename VertexType, typename IndexedFaceType, typename VectorType>
+inline size_t intersect_rays_first_hit(
+	// Indexed triangle set - 3D vertices.
+	const std::vector<VertexType> 		&vertices,
+	// Indexed triangle set - triangular faces, references to vertices.
+	const std::vector<IndexedFaceType> 	&faces,
+	// WideTree over vertices & faces.
+	const WideTree 						&tree,
+	// Origins of the rays.
+	const VectorType					*origins,
+	// Directions of the rays.
+	const VectorType 					*dirs,
+	size_t 								 num_rays,
+	// First intersections of the rays with the indexed triangle set, num_rays entries.
+	igl::Hit 							*hits)
+{
+	size_t num_hits = 0;
+	for (size_t first = 0; first < num_rays; first += detail::MaxPacketSize) {
+		size_t n = std::min(num_rays - first, detail::MaxPacketSize);
+		if (tree.empty())
+			for (size_t r = 0; r < n; ++ r)
+				hits[first + r] = igl::Hit { -1, -1, 0.f, 0.f, std::numeric_limits<float>::infinity() };
+		else
+			detail::intersect_packet_first_hit(vertices, faces, tree, origins + first, dirs + first, n, hits + first);
+		for (size_t r = 0; r < n; ++ r)
+			num_hits += hits[first + r].id >= 0;
+	}
+	return num_hits;
+}
+
+// Find all intersections of a ray with indexed triangle set using a WideTree.
+// The output hits are sorted by the ray parameter.
+template<typename VertexType, typename IndexedFaceType, typename VectorType>
+inline bool intersect_ray_all_hits(
+	// Indexed triangle set - 3D vertices.
+	const std::vector<VertexType> 		&vertices,
+	// Indexed triangle set - triangular faces, references to vertices.
+	const std::vector<IndexedFaceType> 	&faces,
+	// WideTree over vertices & faces.
+	const WideTree 						&tree,
+	// Origin of the ray.
+	const VectorType					&origin,
+	// Direction of the ray.
+	const VectorType 					&dir,
+	// All intersections of the ray with the indexed triangle set, sorted by parameter t.
+	std::vector<igl::Hit> 				&hits)
+{
+	hits.clear();
+	if (! tree.empty()) {
+		hits.reserve(8);
+		detail::intersect_ray_all_hits_wide(vertices, faces, tree, origin, dir, hits);
+	    std::sort(hits.begin(), hits.end(), [](const auto &l, const auto &r) { return l.t < r.t; });
+	}
+	return ! hits.empty();
+}
+
 // Finding a closest triangle, its closest point and squared distance to the closest point
 // on a 3D indexed triangle set using a pre-built AABBTreeIndirect::Tree.
 // Closest point to triangle test will be performed with the accuracy of VectorType::Scalar
@@ -103,6 +103,14 @@ void fill_config(PConf& pcfg) {
     pcfg.parallel = true;
 }
 
+// Minimum number of identical items which are tiled on a lattice instead of
+// being packed one by one.
+const size_t LATTICE_MIN_ITEMS = 16;
+
+// Items tiled on a lattice have to cover at least this much of their bounding
+// box, otherwise the packing would waste too much space.
+const double LATTICE_MIN_FILL = 0.75;
+
 // Apply penalty to object function result. This is used only when alignment
 // after arrange is explicitly disabled (PConfig::Alignment::DONT_ALIGN)
 static double fixed_overfit(const std::tuple<double, Box>& result, const Box &binbb)
@@ -313,6 +321,9 @@ public:
         , m_norm(std::sqrt(m_bin_area))
     {
         fill_config(m_pconf);
+        // The nfps of the item pairs are reused within one arrangement, where
+        // the instances of the same object are placed many times.
+        m_pconf.nfp_cache = std::make_shared<placers::NfpCache<clppr::Polygon>>();
 
         // Set up a callback that is called just before arranging starts
         // This functionality is provided by the Nester class (m_pack).
@@ -452,6 +463,106 @@ template<class Bin> void remove_large_items(std::vector<Item> &items, Bin &&bin)
             ++it : it = items.erase(it);
 }
 
+using LatticePConfig = placers::NfpPConfig<clppr::Polygon>;
+
+template<class BinT>
+bool arrange_lattice(std::vector<Item> &,
+                     const BinT &,
+                     const LatticePConfig &,
+                     const std::function<void(unsigned)> &,
+                     const std::function<bool()> &)
+{
+    return false;
+}
+
+// Many instances of the same object on a rectangular bed are tiled on a
+// lattice of their bounding boxes. The pile is kept roughly square and is
+// aligned in the bed as the placer configuration says, the items not fitting
+// go to the next virtual beds. The items are not rotated, the nfp placer is
+// used if it is allowed to rotate them or if the pile is not to be aligned.
+// Like the first fit selection, the progress is reported with the number of
+// the remaining items and the items left after a stop are not touched.
+template<>
+bool arrange_lattice(std::vector<Item> &                   items,
+                     const Box &                           bin,
+                     const LatticePConfig &                pcfg,
+                     const std::function<void(unsigned)> & progressfn,
+                     const std::function<bool()> &         stopfn)
+{
+    using Key = placers::ShapeKey<clppr::Polygon>;
+    using Alignment = LatticePConfig::Alignment;
+
+    if (items.size() < LATTICE_MIN_ITEMS) return false;
+
+    if (pcfg.alignment == Alignment::DONT_ALIGN ||
+        std::any_of(pcfg.rotations.begin(), pcfg.rotations.end(),
+                    [](double rot) { return rot != 0.; }))
+        return false;
+
+    const Item &front = items.front();
+    Key key(front);
+    for (const Item &itm : items)
+        if (!(Key(itm) == key) || !Key::sameContour(itm.rawShape(), front.rawShape()))
+            return false;
+
+    Box  ibb = front.boundingBox();
+    auto w   = double(ibb.width()), h = double(ibb.height());
+    if (w <= 0. || h <= 0. || std::abs(front.area()) < LATTICE_MIN_FILL * w * h)
+        return false;
+
+    double cols_max = std::floor(bin.width() / w);
+    double rows_max = std::floor(bin.height() / h);
+    if (cols_max < 1. || rows_max < 1.) return false;
+
+    size_t per_bed = size_t(std::min(cols_max * rows_max, double(items.size())));
+
+    for (size_t first = 0, bed = 0; first < items.size(); first += per_bed, ++bed) {
+        size_t count = std::min(per_bed, items.size() - first);
+
+        double cols = std::clamp(std::ceil(std::sqrt(count * h / w)), 1., cols_max);
+        double rows = std::ceil(count / cols);
+        if (rows > rows_max) {
+            rows = rows_max;
+            cols = std::ceil(count / rows);
+        }
+
+        auto pilew = clppr::cInt(cols * w), pileh = clppr::cInt(rows * h);
+        auto c = bin.center();
+        clppr::IntPoint origin{c.X - pilew / 2, c.Y - pileh / 2};
+        switch (pcfg.alignment) {
+        case Alignment::BOTTOM_LEFT:
+            origin = bin.minCorner();
+            break;
+        case Alignment::BOTTOM_RIGHT:
+            origin = {bin.maxCorner().X - pilew, bin.minCorner().Y};
+            break;
+        case Alignment::TOP_LEFT:
+            origin = {bin.minCorner().X, bin.maxCorner().Y - pileh};
+            break;
+        case Alignment::TOP_RIGHT:
+            origin = {bin.maxCorner().X - pilew, bin.maxCorner().Y - pileh};
+            break;
+        default:
+            break;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            if (stopfn && stopfn()) return true;
+
+            Item &itm = items[first + i];
+            auto  col = clppr::cInt(i % size_t(cols)), row = clppr::cInt(i / size_t(cols));
+
+            clppr::IntPoint cell{origin.X + col * clppr::cInt(w), origin.Y + row * clppr::cInt(h)};
+            itm.translate(cell - itm.boundingBox().minCorner());
+            itm.binId(int(bed));
+
+            if (progressfn) progressfn(unsigned(items.size() - first - i - 1));
+        }
+    }
+
+    return true;
+}
+
 template<class BinT> // Arrange for arbitrary bin type
 void _arrange(
         std::vector<Item> &           shapes,
@@ -477,6 +588,12 @@ void _arrange(
     for (Item& itm : shapes) itm.inflate(infl);
     for (Item& itm : excludes) itm.inflate(infl);
     
+    // Identical items on an empty bed do not need the nfp based packing
+    if (excludes.empty() && arrange_lattice(shapes, corrected_bin, arranger.config(), progressfn, stopfn)) {
+        for (Item &itm : shapes) itm.inflate(-infl);
+        return;
+    }
+
     remove_large_items(excludes, corrected_bin);
 
     // If there is something on the plate
@@ -2,6 +2,9 @@
 #include <vector>
 #include <float.h>
 #include <unordered_map>
+#include <limits>
+
+#include <tbb/parallel_for.h>
 
 #if 0
 // #ifdef SLIC3R_GUI
@@ -34,6 +37,7 @@ EdgeGrid::Grid::~Grid()
 {
 	m_contours.clear();
 	m_cell_data.clear();
+	m_cell_segments.clear();
 	m_cells.clear();
 }
 
@@ -319,6 +323,17 @@ void EdgeGrid::Grid::create_from_m_contours(coord_t resolution)
 		for (visitor.j = 0; visitor.j < pts.size(); ++ visitor.j)
 			this->visit_cells_intersecting_line(pts[visitor.j], pts[(visitor.j + 1 == pts.size()) ? 0 : visitor.j + 1], visitor);
 	}
+
+	// 7) Copy the segments next to each other in the order of m_cell_data for the distance queries.
+	m_cell_segments.resize(m_cell_data.size());
+	for (size_t i = 0; i < m_cell_data.size(); ++ i) {
+		const Slic3r::Points &pts = *m_contours[m_cell_data[i].first];
+		size_t                ipt = m_cell_data[i].second;
+		CellSegment          &seg = m_cell_segments[i];
+		seg.prev = pts[(ipt == 0) ? (pts.size() - 1) : ipt - 1];
+		seg.a    = pts[ipt];
+		seg.b    = pts[(ipt + 1 == pts.size()) ? 0 : ipt + 1];
+	}
 }
 
 #if 0
@@ -1041,15 +1056,16 @@ float EdgeGrid::Grid::signed_distance_bilinear(const Point &pt) const
 	return f;
 }
 
-EdgeGrid::Grid::ClosestPointResult EdgeGrid::Grid::closest_point(const Point &pt, coord_t search_radius) const 
+EdgeGrid::Grid::ClosestSegment EdgeGrid::Grid::closest_segment(const Point &pt, coord_t search_radius) const
 {
+	ClosestSegment result;
+	result.distance = double(search_radius);
 	BoundingBox bbox;
 	bbox.min = bbox.max = Point(pt(0) - m_bbox.min(0), pt(1) - m_bbox.min(1));
 	bbox.defined = true;
 	// Upper boundary, round to grid and test validity.
 	bbox.max(0) += search_radius;
 	bbox.max(1) += search_radius;
-	ClosestPointResult result;
 	if (bbox.max(0) < 0 || bbox.max(1) < 0)
 		return result;
 	bbox.max(0) /= m_resolution;
@@ -1073,49 +1089,38 @@ EdgeGrid::Grid::ClosestPointResult EdgeGrid::Grid::closest_point(const Point &pt
 		return result;
 	// Traverse all cells in the bounding box.
 	double d_min = double(search_radius);
-	// Signum of the distance field at pt.
-	int sign_min = 0;
-	double l2_seg_min = 1.;
 	for (int r = bbox.min(1); r <= bbox.max(1); ++ r) {
 		for (int c = bbox.min(0); c <= bbox.max(0); ++ c) {
 			const Cell &cell = m_cells[r * m_cols + c];
 			for (size_t i = cell.begin; i < cell.end; ++ i) {
-				const size_t          contour_idx = m_cell_data[i].first;
-				const Slic3r::Points &pts         = *m_contours[contour_idx];
-				size_t ipt = m_cell_data[i].second;
 				// End points of the line segment.
-				const Slic3r::Point &p1 = pts[ipt];
-				const Slic3r::Point &p2 = pts[(ipt + 1 == pts.size()) ? 0 : ipt + 1];
-				const Slic3r::Point v_seg = p2 - p1;
-				const Slic3r::Point v_pt  = pt - p1;
+				const CellSegment &seg = m_cell_segments[i];
+				const int64_t v_seg_x = int64_t(seg.b.x()) - int64_t(seg.a.x());
+				const int64_t v_seg_y = int64_t(seg.b.y()) - int64_t(seg.a.y());
+				const int64_t v_pt_x  = int64_t(pt.x()) - int64_t(seg.a.x());
+				const int64_t v_pt_y  = int64_t(pt.y()) - int64_t(seg.a.y());
 				// dot(p2-p1, pt-p1)
-				int64_t t_pt = int64_t(v_seg(0)) * int64_t(v_pt(0)) + int64_t(v_seg(1)) * int64_t(v_pt(1));
+				int64_t t_pt = v_seg_x * v_pt_x + v_seg_y * v_pt_y;
 				// l2 of seg
-				int64_t l2_seg = int64_t(v_seg(0)) * int64_t(v_seg(0)) + int64_t(v_seg(1)) * int64_t(v_seg(1));
+				int64_t l2_seg = v_seg_x * v_seg_x + v_seg_y * v_seg_y;
 				if (t_pt < 0) {
 					// Closest to p1.
-					double dabs = sqrt(int64_t(v_pt(0)) * int64_t(v_pt(0)) + int64_t(v_pt(1)) * int64_t(v_pt(1)));
+					double dabs = sqrt(double(v_pt_x * v_pt_x + v_pt_y * v_pt_y));
 					if (dabs < d_min) {
 						// Previous point.
-						const Slic3r::Point &p0 = pts[(ipt == 0) ? (pts.size() - 1) : ipt - 1];
-						Slic3r::Point v_seg_prev = p1 - p0;
-						int64_t t2_pt = int64_t(v_seg_prev(0)) * int64_t(v_pt(0)) + int64_t(v_seg_prev(1)) * int64_t(v_pt(1));
+						const int64_t v_seg_prev_x = int64_t(seg.a.x()) - int64_t(seg.prev.x());
+						const int64_t v_seg_prev_y = int64_t(seg.a.y()) - int64_t(seg.prev.y());
+						int64_t t2_pt = v_seg_prev_x * v_pt_x + v_seg_prev_y * v_pt_y;
 						if (t2_pt > 0) {
 							// Inside the wedge between the previous and the next segment.
 							d_min = dabs;
 							// Set the signum depending on whether the vertex is convex or reflex.
-							int64_t det = int64_t(v_seg_prev(0)) * int64_t(v_seg(1)) - int64_t(v_seg_prev(1)) * int64_t(v_seg(0));
+							int64_t det = v_seg_prev_x * v_seg_y - v_seg_prev_y * v_seg_x;
 							assert(det != 0);
-							sign_min = (det > 0) ? 1 : -1;
-							result.contour_idx = contour_idx;
-							result.start_point_idx = ipt;
-							result.t = 0.;
-#ifndef NDEBUG
-							Vec2d vfoot = (p1 - pt).cast<double>();
-							double dist_foot = vfoot.norm();
-							double dist_foot_err = dist_foot - d_min;
-							assert(std::abs(dist_foot_err) < 1e-7 * d_min);
-#endif /* NDEBUG */
+							result.sign = (det > 0) ? 1 : -1;
+							result.idx = i;
+							result.on_segment = false;
+							result.t = 0;
 						}
 					}
 				}
@@ -1125,31 +1130,34 @@ EdgeGrid::Grid::ClosestPointResult EdgeGrid::Grid::closest_point(const Point &pt
 				} else {
 					// Closest to the segment.
 					assert(t_pt >= 0 && t_pt <= l2_seg);
-					int64_t d_seg = int64_t(v_seg(1)) * int64_t(v_pt(0)) - int64_t(v_seg(0)) * int64_t(v_pt(1));
+					int64_t d_seg = v_seg_y * v_pt_x - v_seg_x * v_pt_y;
 					double d = double(d_seg) / sqrt(double(l2_seg));
 					double dabs = std::abs(d);
 					if (dabs < d_min) {
 						d_min = dabs;
-						sign_min = (d_seg < 0) ? -1 : ((d_seg == 0) ? 0 : 1);
-						l2_seg_min = l2_seg;
-						result.contour_idx = contour_idx;
-						result.start_point_idx = ipt;
+						result.sign = (d_seg < 0) ? -1 : ((d_seg == 0) ? 0 : 1);
+						result.idx = i;
+						result.on_segment = true;
 						result.t = t_pt;
-#ifndef NDEBUG
-						Vec2d foot = p1.cast<double>() * (1. - result.t / l2_seg_min) + p2.cast<double>() * (result.t / l2_seg_min);
-						Vec2d vfoot = foot - pt.cast<double>();
-						double dist_foot = vfoot.norm();
-						double dist_foot_err = dist_foot - d_min;
-						assert(std::abs(dist_foot_err) < 1e-7 || std::abs(dist_foot_err) < 1e-7 * d_min);
-#endif /* NDEBUG */
+						result.l2 = l2_seg;
 					}
 				}
 			}
 		}
 	}
-    if (result.contour_idx != size_t(-1) && d_min <= double(search_radius)) {
-		result.distance = d_min * sign_min;
-		result.t /= l2_seg_min;
+	result.distance = d_min;
+	return result;
+}
+
+EdgeGrid::Grid::ClosestPointResult EdgeGrid::Grid::closest_point(const Point &pt, coord_t search_radius) const 
+{
+	ClosestPointResult result;
+	ClosestSegment     closest = this->closest_segment(pt, search_radius);
+	if (closest.idx != size_t(-1) && closest.distance <= double(search_radius)) {
+		result.contour_idx     = m_cell_data[closest.idx].first;
+		result.start_point_idx = m_cell_data[closest.idx].second;
+		result.distance        = closest.distance * closest.sign;
+		result.t               = closest.on_segment ? double(closest.t) / double(closest.l2) : 0.;
 		assert(result.t >= 0. && result.t < 1.);
 #ifndef NDEBUG
 		{
@@ -1166,102 +1174,18 @@ EdgeGrid::Grid::ClosestPointResult EdgeGrid::Grid::closest_point(const Point &pt
 			assert(std::abs(dist_foot_err) < 1e-7 || std::abs(dist_foot_err) < 1e-7 * std::abs(result.distance));
 		}
 #endif /* NDEBUG */
-	} else
-		result = ClosestPointResult();
+	}
 	return result;
 }
 
 bool EdgeGrid::Grid::signed_distance_edges(const Point &pt, coord_t search_radius, coordf_t &result_min_dist, bool *pon_segment) const 
 {
-	BoundingBox bbox;
-	bbox.min = bbox.max = Point(pt(0) - m_bbox.min(0), pt(1) - m_bbox.min(1));
-	bbox.defined = true;
-	// Upper boundary, round to grid and test validity.
-	bbox.max(0) += search_radius;
-	bbox.max(1) += search_radius;
-	if (bbox.max(0) < 0 || bbox.max(1) < 0)
-		return false;
-	bbox.max(0) /= m_resolution;
-	bbox.max(1) /= m_resolution;
-	if ((size_t)bbox.max(0) >= m_cols)
-		bbox.max(0) = m_cols - 1;
-	if ((size_t)bbox.max(1) >= m_rows)
-		bbox.max(1) = m_rows - 1;
-	// Lower boundary, round to grid and test validity.
-	bbox.min(0) -= search_radius;
-	bbox.min(1) -= search_radius;
-	if (bbox.min(0) < 0)
-		bbox.min(0) = 0;
-	if (bbox.min(1) < 0)
-		bbox.min(1) = 0;
-	bbox.min(0) /= m_resolution;
-	bbox.min(1) /= m_resolution;
-	// Is the interval empty?
-	if (bbox.min(0) > bbox.max(0) ||
-		bbox.min(1) > bbox.max(1))
+	ClosestSegment closest = this->closest_segment(pt, search_radius);
+	if (closest.idx == size_t(-1) || closest.distance >= search_radius)
 		return false;
-	// Traverse all cells in the bounding box.
-	double d_min = double(search_radius);
-	// Signum of the distance field at pt.
-	int sign_min = 0;
-	bool on_segment = false;
-	for (int r = bbox.min(1); r <= bbox.max(1); ++ r) {
-		for (int c = bbox.min(0); c <= bbox.max(0); ++ c) {
-			const Cell &cell = m_cells[r * m_cols + c];
-			for (size_t i = cell.begin; i < cell.end; ++ i) {
-				const Slic3r::Points &pts = *m_contours[m_cell_data[i].first];
-				size_t ipt = m_cell_data[i].second;
-				// End points of the line segment.
-				const Slic3r::Point &p1 = pts[ipt];
-				const Slic3r::Point &p2 = pts[(ipt + 1 == pts.size()) ? 0 : ipt + 1];
-				Slic3r::Point v_seg = p2 - p1;
-				Slic3r::Point v_pt  = pt - p1;
-				// dot(p2-p1, pt-p1)
-				int64_t t_pt = int64_t(v_seg(0)) * int64_t(v_pt(0)) + int64_t(v_seg(1)) * int64_t(v_pt(1));
-				// l2 of seg
-				int64_t l2_seg = int64_t(v_seg(0)) * int64_t(v_seg(0)) + int64_t(v_seg(1)) * int64_t(v_seg(1));
-				if (t_pt < 0) {
-					// Closest to p1.
-					double dabs = sqrt(int64_t(v_pt(0)) * int64_t(v_pt(0)) + int64_t(v_pt(1)) * int64_t(v_pt(1)));
-					if (dabs < d_min) {
-						// Previous point.
-						const Slic3r::Point &p0 = pts[(ipt == 0) ? (pts.size() - 1) : ipt - 1];
-						Slic3r::Point v_seg_prev = p1 - p0;
-						int64_t t2_pt = int64_t(v_seg_prev(0)) * int64_t(v_pt(0)) + int64_t(v_seg_prev(1)) * int64_t(v_pt(1));
-						if (t2_pt > 0) {
-							// Inside the wedge between the previous and the next segment.
-							d_min = dabs;
-							// Set the signum depending on whether the vertex is convex or reflex.
-							int64_t det = int64_t(v_seg_prev(0)) * int64_t(v_seg(1)) - int64_t(v_seg_prev(1)) * int64_t(v_seg(0));
-							assert(det != 0);
-							sign_min = (det > 0) ? 1 : -1;
-							on_segment = false;
-						}
-					}
-				}
-				else if (t_pt > l2_seg) {
-					// Closest to p2. Then p2 is the starting point of another segment, which shall be discovered in the same cell.
-					continue;
-				} else {
-					// Closest to the segment.
-					assert(t_pt >= 0 && t_pt <= l2_seg);
-					int64_t d_seg = int64_t(v_seg(1)) * int64_t(v_pt(0)) - int64_t(v_seg(0)) * int64_t(v_pt(1));
-					double d = double(d_seg) / sqrt(double(l2_seg));
-					double dabs = std::abs(d);
-					if (dabs < d_min) {
-						d_min = dabs;
-						sign_min = (d_seg < 0) ? -1 : ((d_seg == 0) ? 0 : 1);
-						on_segment = true;
-					}
-				}
-			}
-		}
-	}
-	if (d_min >= search_radius)
-		return false;
-	result_min_dist = d_min * sign_min;
+	result_min_dist = closest.distance * closest.sign;
 	if (pon_segment != NULL)
-		*pon_segment = on_segment;
+		*pon_segment = closest.on_segment;
 	return true;
 }
 
@@ -1275,6 +1199,20 @@ bool EdgeGrid::Grid::signed_distance(const Point &pt, coord_t search_radius, coo
 	return true;
 }
 
+std::vector<coordf_t> EdgeGrid::Grid::signed_distances(const Points &pts, coord_t search_radius) const
+{
+	std::vector<coordf_t> out(pts.size(), std::numeric_limits<coordf_t>::quiet_NaN());
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, pts.size(), 256),
+		[this, &pts, search_radius, &out](const tbb::blocked_range<size_t> &range) {
+			for (size_t i = range.begin(); i < range.end(); ++ i) {
+				coordf_t dist;
+				if (this->signed_distance(pts[i], search_radius, dist))
+					out[i] = dist;
+			}
+		});
+	return out;
+}
+
 Polygons EdgeGrid::Grid::contours_simplified(coord_t offset, bool fill_holes) const
 {
 	assert(std::abs(2 * offset) < m_resolution);
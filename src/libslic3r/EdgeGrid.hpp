@@ -66,6 +66,9 @@ public:
 	// Calculate a signed distance to the contours in search_radius from the point. If no edge is found in search_radius,
 	// return an interpolated value from m_signed_distance_field, if it exists.
 	bool signed_distance(const Point &pt, coord_t search_radius, coordf_t &result_min_dist) const;
+	// Batch version of signed_distance(), the points are processed in parallel.
+	// NaN is returned for the points, for which signed_distance() returns false.
+	std::vector<coordf_t> signed_distances(const Points &pts, coord_t search_radius) const;
 
 	const BoundingBox& 	bbox() const { return m_bbox; }
 	const coord_t 		resolution() const { return m_resolution; }
@@ -249,6 +252,22 @@ protected:
 	};
 
 	void create_from_m_contours(coord_t resolution);
+
+	// Closest segment or vertex found by closest_segment().
+	struct ClosestSegment {
+		// Index into m_cell_data and m_cell_segments, size_t(-1) if nothing was found.
+		size_t 	idx 		= size_t(-1);
+		// Unsigned distance.
+		double 	distance;
+		int 	sign 		= 0;
+		// Closest to the inside of the segment, not to its first point.
+		bool 	on_segment 	= false;
+		// dot(b - a, pt - a) and the squared length of the segment, if on_segment.
+		int64_t t 			= 0;
+		int64_t l2 			= 1;
+	};
+	// Shared kernel of closest_point() and signed_distance_edges().
+	ClosestSegment closest_segment(const Point &pt, coord_t search_radius) const;
 #if 0
 	bool line_cell_intersect(const Point &p1, const Point &p2, const Cell &cell);
 #endif
@@ -280,6 +299,16 @@ protected:
 	// Referencing a contour and a line segment of m_contours.
 	std::vector<std::pair<size_t, size_t> >		m_cell_data;
 
+	// Copy of the segments referenced by m_cell_data in the same order, together with the point
+	// preceding the segment on its contour. The distance queries run over this contiguous copy
+	// instead of dereferencing m_contours for every segment.
+	struct CellSegment {
+		Slic3r::Point 	prev;
+		Slic3r::Point 	a;
+		Slic3r::Point 	b;
+	};
+	std::vector<CellSegment> 					m_cell_segments;
+
 	// Full grid of cells.
 	std::vector<Cell> 							m_cells;
 
@@ -162,7 +162,7 @@ void Fill3DHoneycomb::_fill_surface_single(
 		pl.translate(bb.min);
 
     // clip pattern to boundaries, chain the clipped polylines
-    Polylines polylines_chained = chain_polylines(intersection_pl(polylines, to_polygons(expolygon)));
+    Polylines polylines_chained = chain_polylines(intersection_pl(polylines, to_polygons(expolygon)), nullptr, true);
 
     // connect lines if needed
     if (! polylines_chained.empty()) {
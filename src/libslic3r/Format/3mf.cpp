@@ -6,12 +6,16 @@
 #include "../Geometry.hpp"
 #include "../GCode/ThumbnailData.hpp"
 #include "../Time.hpp"
+#include "../Channel.hpp"
+#include "../Thread.hpp"
 
 #include "../I18N.hpp"
 
 #include "3mf.hpp"
 
+#include <cmath>
 #include <limits>
+#include <memory>
 #include <stdexcept>
 
 #include <boost/algorithm/string/classification.hpp>
@@ -28,6 +32,7 @@
 namespace pt = boost::property_tree;
 
 #include <expat.h>
+#include <tbb/parallel_for.h>
 #include <Eigen/Dense>
 #include "miniz_extension.hpp"
 
@@ -163,6 +168,72 @@ int get_attribute_value_int(const char** attributes, unsigned int attributes_siz
     return (text != nullptr) ? ::atoi(text) : 0;
 }
 
+// Fast path for the numbers of the mesh section, which make up most of a model file.
+// Plain decimal numbers are parsed directly, independently of the locale. Anything else
+// (leading spaces, too many digits, hexadecimal, inf, ...) falls back to ::atof().
+float parse_float(const char* text)
+{
+    static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+    const char* p = text;
+    bool negative = (*p == '-');
+    if (*p == '-' || *p == '+')
+        ++p;
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool valid = false;
+    for (; *p >= '0' && *p <= '9'; ++p, valid = true)
+    {
+        mantissa = mantissa * 10 + uint64_t(*p - '0');
+        digits += (mantissa != 0);
+    }
+    if (*p == '.')
+    {
+        for (++p; *p >= '0' && *p <= '9'; ++p, valid = true)
+        {
+            mantissa = mantissa * 10 + uint64_t(*p - '0');
+            digits += (mantissa != 0);
+            --exponent;
+        }
+    }
+    if (valid && (*p == 'e' || *p == 'E'))
+    {
+        ++p;
+        bool negative_exp = (*p == '-');
+        if (*p == '-' || *p == '+')
+            ++p;
+        int exp = 0;
+        valid = (*p >= '0' && *p <= '9');
+        for (; *p >= '0' && *p <= '9' && exp < 10000; ++p)
+            exp = exp * 10 + (*p - '0');
+        exponent += negative_exp ? -exp : exp;
+    }
+
+    // The mantissa has to be exact and the power of ten representable to get the correctly rounded value.
+    if (!valid || *p != '\0' || digits > 15 || exponent < -22 || exponent > 22)
+        return (float)::atof(text);
+
+    double value = (exponent < 0) ? double(mantissa) / pow10[-exponent] : double(mantissa) * pow10[exponent];
+    return (float)(negative ? -value : value);
+}
+
+// Fast path for the vertex indices of the triangles, see parse_float().
+unsigned int parse_uint(const char* text)
+{
+    const char* p = text;
+    uint64_t value = 0;
+    for (; *p >= '0' && *p <= '9' && value <= UINT32_MAX; ++p)
+        value = value * 10 + uint64_t(*p - '0');
+
+    if (p == text || *p != '\0' || value > UINT32_MAX)
+        return (unsigned int)::atoi(text);
+
+    return (unsigned int)value;
+}
+
 bool get_attribute_value_bool(const char** attributes, unsigned int attributes_size, const char* attribute_key)
 {
     const char* text = get_attribute_value_charptr(attributes, attributes_size, attribute_key);
@@ -286,8 +357,9 @@ namespace Slic3r {
         {
             std::vector<float> vertices;
             std::vector<unsigned int> triangles;
-            std::vector<std::string> custom_supports;
-            std::vector<std::string> custom_seam;
+            // Custom supports and seam data, stored only for the triangles having some, ordered by the triangle index.
+            std::vector<std::pair<unsigned int, std::string>> custom_supports;
+            std::vector<std::pair<unsigned int, std::string>> custom_seam;
 
             bool empty()
             {
@@ -397,6 +469,8 @@ namespace Slic3r {
         bool m_check_version;
 
         XML_Parser m_xml_parser;
+        // Size of the model file being parsed, used to estimate the number of vertices of an object.
+        mz_uint64 m_model_size;
         Model* m_model;
         float m_unit_factor;
         CurrentObject m_curr_object;
@@ -516,6 +590,7 @@ namespace Slic3r {
         : m_version(0)
         , m_check_version(false)
         , m_xml_parser(nullptr)
+        , m_model_size(0)
         , m_model(nullptr)   
         , m_unit_factor(1.0f)
         , m_curr_metadata_name("")
@@ -757,43 +832,95 @@ namespace Slic3r {
             return false;
         }
 
+        m_model_size = stat.m_uncomp_size;
+
         XML_SetUserData(m_xml_parser, (void*)this);
         XML_SetElementHandler(m_xml_parser, _3MF_Importer::_handle_start_model_xml_element, _3MF_Importer::_handle_end_model_xml_element);
         XML_SetCharacterDataHandler(m_xml_parser, _3MF_Importer::_handle_model_xml_characters);
 
-        struct CallbackData
+        // The model data is decompressed by a worker thread while it is being parsed. The buffers are passed
+        // to the parser through the filled channel and recycled through the free channel.
+        // A negative index in the filled channel marks the end of the data, -1 if it was extracted successfully.
+        // A negative index in the free channel stops the worker thread.
+        static const size_t BufferSize = 1024 * 1024;
+        static const int BuffersCount = 4;
+        std::vector<std::vector<char>> buffers(BuffersCount, std::vector<char>(BufferSize));
+        std::vector<size_t> sizes(BuffersCount, 0);
+        Channel<int> free_buffers;
+        Channel<int> filled_buffers;
+        for (int i = 0; i < BuffersCount; ++i)
         {
-            XML_Parser& parser;
-            const mz_zip_archive_file_stat& stat;
+            free_buffers.push(i, true);
+        }
 
-            CallbackData(XML_Parser& parser, const mz_zip_archive_file_stat& stat) : parser(parser), stat(stat) {}
-        };
+        boost::thread extract_thread = create_thread([&archive, &stat, &buffers, &sizes, &free_buffers, &filled_buffers]() {
+            mz_zip_reader_extract_iter_state* iter = mz_zip_reader_extract_iter_new(&archive, stat.m_file_index, 0);
+            if (iter == nullptr)
+            {
+                filled_buffers.push(-2);
+                return;
+            }
+
+            mz_uint64 extracted = 0;
+            while (extracted < stat.m_uncomp_size)
+            {
+                int id = free_buffers.pop();
+                if (id < 0)
+                    break;
 
-        CallbackData data(m_xml_parser, stat);
+                sizes[id] = mz_zip_reader_extract_iter_read(iter, buffers[id].data(), BufferSize);
+                if (sizes[id] == 0)
+                    break;
+
+                extracted += sizes[id];
+                filled_buffers.push(id);
+            }
+
+            // mz_zip_reader_extract_iter_free() verifies the size and the crc of the extracted data
+            bool res = (mz_zip_reader_extract_iter_free(iter) != 0) && (extracted == stat.m_uncomp_size);
+            filled_buffers.push(res ? -1 : -2);
+        });
+
+        // Stops the worker thread and waits for it, also when the parser throws.
+        auto stop_extract_thread = [&extract_thread, &free_buffers]() {
+            free_buffers.push(-1);
+            extract_thread.join();
+        };
 
         mz_bool res = 0;
 
         try
         {
-            res = mz_zip_reader_extract_file_to_callback(&archive, stat.m_filename, [](void* pOpaque, mz_uint64 file_ofs, const void* pBuf, size_t n)->size_t {
-                CallbackData* data = (CallbackData*)pOpaque;
-                if (!XML_Parse(data->parser, (const char*)pBuf, (int)n, (file_ofs + n == data->stat.m_uncomp_size) ? 1 : 0))
-                {
-                    char error_buf[1024];
-                    ::sprintf(error_buf, "Error (%s) while parsing '%s' at line %d", XML_ErrorString(XML_GetErrorCode(data->parser)), data->stat.m_filename, (int)XML_GetCurrentLineNumber(data->parser));
-                    throw Slic3r::FileIOError(error_buf);
-                }
+            int id;
+            while ((id = filled_buffers.pop()) >= 0)
+            {
+                if (!XML_Parse(m_xml_parser, buffers[id].data(), (int)sizes[id], 0))
+                    break;
+                free_buffers.push(id);
+            }
 
-                return n;
-                }, &data, 0);
+            // the final call lets the parser report unclosed elements,
+            // an extraction error (-2) is reported below
+            if (id == -1 && XML_Parse(m_xml_parser, nullptr, 0, 1))
+                res = 1;
+            else if (id != -2)
+            {
+                char error_buf[1024];
+                ::sprintf(error_buf, "Error (%s) while parsing '%s' at line %d", XML_ErrorString(XML_GetErrorCode(m_xml_parser)), stat.m_filename, (int)XML_GetCurrentLineNumber(m_xml_parser));
+                throw Slic3r::FileIOError(error_buf);
+            }
+
+            stop_extract_thread();
         }
         catch (const version_error& e)
         {
+            stop_extract_thread();
             // rethrow the exception
             throw Slic3r::FileIOError(e.what());
         }
         catch (std::exception& e)
         {
+            stop_extract_thread();
             add_error(e.what());
             return false;
         }
@@ -1254,7 +1381,10 @@ namespace Slic3r {
         bool res = true;
         unsigned int num_attributes = (unsigned int)XML_GetSpecifiedAttributeCount(m_xml_parser);
 
-        if (::strcmp(MODEL_TAG, name) == 0)
+        // The vertices and the triangles are by far the most frequent elements, they are checked first.
+        if (::strcmp(VERTEX_TAG, name) == 0)
+            res = _handle_start_vertex(attributes, num_attributes);
+        else if (::strcmp(MODEL_TAG, name) == 0)
             res = _handle_start_model(attributes, num_attributes);
         else if (::strcmp(RESOURCES_TAG, name) == 0)
             res = _handle_start_resources(attributes, num_attributes);
@@ -1264,8 +1394,6 @@ namespace Slic3r {
             res = _handle_start_mesh(attributes, num_attributes);
         else if (::strcmp(VERTICES_TAG, name) == 0)
             res = _handle_start_vertices(attributes, num_attributes);
-        else if (::strcmp(VERTEX_TAG, name) == 0)
-            res = _handle_start_vertex(attributes, num_attributes);
         else if (::strcmp(TRIANGLES_TAG, name) == 0)
             res = _handle_start_triangles(attributes, num_attributes);
         else if (::strcmp(TRIANGLE_TAG, name) == 0)
@@ -1292,7 +1420,9 @@ namespace Slic3r {
 
         bool res = true;
 
-        if (::strcmp(MODEL_TAG, name) == 0)
+        if (::strcmp(VERTEX_TAG, name) == 0)
+            res = _handle_end_vertex();
+        else if (::strcmp(MODEL_TAG, name) == 0)
             res = _handle_end_model();
         else if (::strcmp(RESOURCES_TAG, name) == 0)
             res = _handle_end_resources();
@@ -1302,8 +1432,6 @@ namespace Slic3r {
             res = _handle_end_mesh();
         else if (::strcmp(VERTICES_TAG, name) == 0)
             res = _handle_end_vertices();
-        else if (::strcmp(VERTEX_TAG, name) == 0)
-            res = _handle_end_vertex();
         else if (::strcmp(TRIANGLES_TAG, name) == 0)
             res = _handle_end_triangles();
         else if (::strcmp(TRIANGLE_TAG, name) == 0)
@@ -1492,12 +1620,14 @@ namespace Slic3r {
     {
         // reset current geometry
         m_curr_object.geometry.reset();
+        // the character data (whitespace) of the mesh section is not needed
+        XML_SetCharacterDataHandler(m_xml_parser, nullptr);
         return true;
     }
 
     bool _3MF_Importer::_handle_end_mesh()
     {
-        // do nothing
+        XML_SetCharacterDataHandler(m_xml_parser, _3MF_Importer::_handle_model_xml_characters);
         return true;
     }
 
@@ -1505,12 +1635,24 @@ namespace Slic3r {
     {
         // reset current vertices
         m_curr_object.geometry.vertices.clear();
+
+        // The 3MF format does not store the number of vertices. The rest of the model file, at about 128 bytes
+        // per vertex with its triangles, bounds the number of vertices, but it may contain many more objects.
+        // At most a block of 64k vertices is reserved, a bigger mesh grows the vector as usual.
+        static const mz_uint64 BytesPerVertex = 128;
+        static const mz_uint64 MaxReservedVertices = 1 << 16;
+        mz_uint64 position = (mz_uint64)std::max<XML_Index>(0, XML_GetCurrentByteIndex(m_xml_parser));
+        if (position < m_model_size)
+            m_curr_object.geometry.vertices.reserve(3 * (size_t)std::min((m_model_size - position) / BytesPerVertex, MaxReservedVertices));
         return true;
     }
 
     bool _3MF_Importer::_handle_end_vertices()
     {
-        // do nothing
+        // release the excess capacity of an overestimated reservation, the vertices are kept until the end of the import
+        std::vector<float>& vertices = m_curr_object.geometry.vertices;
+        if (vertices.capacity() > vertices.size() + vertices.size() / 4)
+            vertices.shrink_to_fit();
         return true;
     }
 
@@ -1518,9 +1660,17 @@ namespace Slic3r {
     {
         // appends the vertex coordinates
         // missing values are set equal to ZERO
-        m_curr_object.geometry.vertices.push_back(m_unit_factor * get_attribute_value_float(attributes, num_attributes, X_ATTR));
-        m_curr_object.geometry.vertices.push_back(m_unit_factor * get_attribute_value_float(attributes, num_attributes, Y_ATTR));
-        m_curr_object.geometry.vertices.push_back(m_unit_factor * get_attribute_value_float(attributes, num_attributes, Z_ATTR));
+        // the attributes are scanned only once, the coordinates are identified by their single character names
+        float coords[3] = { 0.0f, 0.0f, 0.0f };
+        for (unsigned int a = 0; a + 1 < num_attributes; a += 2)
+        {
+            const char* key = attributes[a];
+            if (key[0] >= X_ATTR[0] && key[0] <= Z_ATTR[0] && key[1] == '\0')
+                coords[key[0] - X_ATTR[0]] = parse_float(attributes[a + 1]);
+        }
+
+        std::vector<float>& vertices = m_curr_object.geometry.vertices;
+        vertices.insert(vertices.end(), { m_unit_factor * coords[0], m_unit_factor * coords[1], m_unit_factor * coords[2] });
         return true;
     }
 
@@ -1534,6 +1684,8 @@ namespace Slic3r {
     {
         // reset current triangles
         m_curr_object.geometry.triangles.clear();
+        // a closed mesh has about twice as many triangles as vertices
+        m_curr_object.geometry.triangles.reserve(2 * m_curr_object.geometry.vertices.size());
         return true;
     }
 
@@ -1554,12 +1706,23 @@ namespace Slic3r {
 
         // appends the triangle's vertices indices
         // missing values are set equal to ZERO
-        m_curr_object.geometry.triangles.push_back((unsigned int)get_attribute_value_int(attributes, num_attributes, V1_ATTR));
-        m_curr_object.geometry.triangles.push_back((unsigned int)get_attribute_value_int(attributes, num_attributes, V2_ATTR));
-        m_curr_object.geometry.triangles.push_back((unsigned int)get_attribute_value_int(attributes, num_attributes, V3_ATTR));
-
-        m_curr_object.geometry.custom_supports.push_back(get_attribute_value_string(attributes, num_attributes, CUSTOM_SUPPORTS_ATTR));
-        m_curr_object.geometry.custom_seam.push_back(get_attribute_value_string(attributes, num_attributes, CUSTOM_SEAM_ATTR));
+        // the attributes are scanned only once
+        Geometry& geometry = m_curr_object.geometry;
+        unsigned int triangle_id = (unsigned int)geometry.triangles.size() / 3;
+        unsigned int indices[3] = { 0, 0, 0 };
+        for (unsigned int a = 0; a + 1 < num_attributes; a += 2)
+        {
+            const char* key = attributes[a];
+            const char* value = attributes[a + 1];
+            if (key[0] == V1_ATTR[0] && key[1] >= V1_ATTR[1] && key[1] <= V3_ATTR[1] && key[2] == '\0')
+                indices[key[1] - V1_ATTR[1]] = parse_uint(value);
+            else if (value[0] != '\0' && ::strcmp(key, CUSTOM_SUPPORTS_ATTR) == 0)
+                geometry.custom_supports.emplace_back(triangle_id, value);
+            else if (value[0] != '\0' && ::strcmp(key, CUSTOM_SEAM_ATTR) == 0)
+                geometry.custom_seam.emplace_back(triangle_id, value);
+        }
+
+        geometry.triangles.insert(geometry.triangles.end(), { indices[0], indices[1], indices[2] });
         return true;
     }
 
@@ -1894,15 +2057,15 @@ namespace Slic3r {
             volume->calculate_convex_hull();
 
             // recreate custom supports and seam from previously loaded attribute
-            for (unsigned i=0; i<triangles_count; ++i) {
-                size_t index = src_start_id/3 + i;
-                assert(index < geometry.custom_supports.size());
-                assert(index < geometry.custom_seam.size());
-                if (! geometry.custom_supports[index].empty())
-                    volume->supported_facets.set_triangle_from_string(i, geometry.custom_supports[index]);
-                if (! geometry.custom_seam[index].empty())
-                    volume->seam_facets.set_triangle_from_string(i, geometry.custom_seam[index]);
-            }
+            unsigned int first_triangle_id = src_start_id / 3;
+            auto set_custom_data = [first_triangle_id, triangles_count](const std::vector<std::pair<unsigned int, std::string>>& custom_data, FacetsAnnotation& facets) {
+                auto it = std::lower_bound(custom_data.begin(), custom_data.end(), first_triangle_id,
+                    [](const std::pair<unsigned int, std::string>& data, unsigned int id) { return data.first < id; });
+                for (; it != custom_data.end() && it->first < first_triangle_id + triangles_count; ++it)
+                    facets.set_triangle_from_string(int(it->first - first_triangle_id), it->second);
+            };
+            set_custom_data(geometry.custom_supports, volume->supported_facets);
+            set_custom_data(geometry.custom_seam, volume->seam_facets);
 
 
             // apply the remaining volume's metadata
@@ -1969,6 +2132,306 @@ namespace Slic3r {
             importer->_handle_end_config_xml_element(name);
     }
 
+    // Formats the number with 9 significant digits the way "%.9g" does, which
+    // is enough for any float to survive the round trip through the text.
+    // Unlike printf, the decimal point does not depend on the locale.
+    static char* format_number(char* p, double v)
+    {
+        if (std::isnan(v)) {
+            memcpy(p, "nan", 3);
+            return p + 3;
+        }
+        if (std::signbit(v)) {
+            *p++ = '-';
+            v = -v;
+        }
+        if (std::isinf(v)) {
+            memcpy(p, "inf", 3);
+            return p + 3;
+        }
+        if (v == 0.) {
+            *p++ = '0';
+            return p;
+        }
+
+        auto scaled = [v](int e) {
+            int k = 8 - e;
+            // Ties are rounded to even like printf does.
+            return uint64_t(std::nearbyint(k >= 0 ? v * std::pow(10., k) : v / std::pow(10., -k)));
+        };
+
+        int e = int(std::floor(std::log10(v)));
+        uint64_t digits = scaled(e);
+        while (digits >= 1000000000ull)
+            digits = scaled(++e);
+        while (digits < 100000000ull)
+            digits = scaled(--e);
+
+        char d[9];
+        for (int i = 8; i >= 0; --i, digits /= 10)
+            d[i] = char('0' + digits % 10);
+        int last = 8;
+        while (last > 0 && d[last] == '0')
+            --last;
+
+        if (e < -4 || e >= 9) {
+            *p++ = d[0];
+            if (last > 0) {
+                *p++ = '.';
+                for (int i = 1; i <= last; ++i)
+                    *p++ = d[i];
+            }
+            *p++ = 'e';
+            *p++ = e < 0 ? '-' : '+';
+            int ae = std::abs(e);
+            if (ae >= 100)
+                *p++ = char('0' + ae / 100);
+            *p++ = char('0' + ae / 10 % 10);
+            *p++ = char('0' + ae % 10);
+        }
+        else if (e < 0) {
+            *p++ = '0';
+            *p++ = '.';
+            for (int i = e + 1; i < 0; ++i)
+                *p++ = '0';
+            for (int i = 0; i <= last; ++i)
+                *p++ = d[i];
+        }
+        else {
+            for (int i = 0; i <= e; ++i)
+                *p++ = d[i];
+            if (last > e) {
+                *p++ = '.';
+                for (int i = e + 1; i <= last; ++i)
+                    *p++ = d[i];
+            }
+        }
+
+        return p;
+    }
+
+    static char* format_number(char* p, uint64_t v)
+    {
+        char d[20];
+        int n = 0;
+        do {
+            d[n++] = char('0' + v % 10);
+            v /= 10;
+        } while (v != 0);
+        while (n > 0)
+            *p++ = d[--n];
+        return p;
+    }
+
+    // CRC-32 of two concatenated blocks from the CRCs of the blocks, computed
+    // like zlib's crc32_combine() does. miniz does not provide it.
+    static uint32_t combine_crc32(uint32_t crc1, uint32_t crc2, uint64_t len2)
+    {
+        auto times = [](const uint32_t* mat, uint32_t vec) {
+            uint32_t sum = 0;
+            for (; vec != 0; vec >>= 1, ++mat)
+                if (vec & 1)
+                    sum ^= *mat;
+            return sum;
+        };
+        auto square = [&times](uint32_t* sq, const uint32_t* mat) {
+            for (int n = 0; n < 32; ++n)
+                sq[n] = times(mat, mat[n]);
+        };
+
+        if (len2 == 0)
+            return crc1;
+
+        // Operator for a single zero bit, then for two and four zero bits.
+        uint32_t even[32], odd[32];
+        odd[0] = 0xedb88320u;
+        for (int n = 1; n < 32; ++n)
+            odd[n] = 1u << (n - 1);
+        square(even, odd);
+        square(odd, even);
+
+        // Apply len2 zero bytes to crc1.
+        do {
+            square(even, odd);
+            if (len2 & 1)
+                crc1 = times(even, crc1);
+            len2 >>= 1;
+            if (len2 == 0)
+                break;
+            square(odd, even);
+            if (len2 & 1)
+                crc1 = times(odd, crc1);
+            len2 >>= 1;
+        } while (len2 != 0);
+
+        return crc1 ^ crc2;
+    }
+
+    // Writes text straight into a raw deflate stream. The text is compressed
+    // in chunks of bounded size, so a big document is never held in memory
+    // uncompressed. Documents written by separate writers (possibly in
+    // parallel) can be joined by append(), as each of them ends with a full
+    // flush, which byte aligns the deflate stream.
+    class XmlDeflater
+    {
+    public:
+        static const size_t ChunkSize = 1 << 20;
+
+        explicit XmlDeflater(mz_uint level)
+            : m_compressor(tdefl_compressor_alloc(), &tdefl_compressor_free)
+        {
+            if (!m_compressor)
+                throw std::bad_alloc();
+
+            mz_uint flags = tdefl_create_comp_flags_from_zip_params(int(level), -MZ_DEFAULT_WINDOW_BITS, MZ_DEFAULT_STRATEGY);
+            tdefl_init(m_compressor.get(), &XmlDeflater::put_buf, &m_block.data, int(flags));
+        }
+
+        // The compressor keeps a pointer to the output buffer.
+        XmlDeflater(const XmlDeflater&) = delete;
+        XmlDeflater& operator=(const XmlDeflater&) = delete;
+
+        // Compressed data of a finished writer.
+        struct Block
+        {
+            std::vector<uint8_t> data;
+            uint32_t crc{ MZ_CRC32_INIT };
+            uint64_t size{ 0 };
+        };
+
+        XmlDeflater& operator<<(const char* str) { return write(str, strlen(str)); }
+        XmlDeflater& operator<<(const std::string& str) { return write(str.data(), str.size()); }
+        XmlDeflater& operator<<(unsigned int v) { return write_number(uint64_t(v)); }
+        XmlDeflater& operator<<(size_t v) { return write_number(uint64_t(v)); }
+        XmlDeflater& operator<<(float v) { return write_number(double(v)); }
+        XmlDeflater& operator<<(double v) { return write_number(v); }
+
+        // Compress the pending text and end the deflate stream with a full flush.
+        void flush()
+        {
+            compress(TDEFL_FULL_FLUSH);
+        }
+
+        // Finish the stream and take its compressed data.
+        Block take()
+        {
+            flush();
+            Block ret = std::move(m_block);
+            m_block = Block();
+            return ret;
+        }
+
+        // Append the stream of another writer.
+        void append(const Block& other)
+        {
+            flush();
+            m_block.data.insert(m_block.data.end(), other.data.begin(), other.data.end());
+            m_block.crc = combine_crc32(m_block.crc, other.crc, other.size);
+            m_block.size += other.size;
+        }
+
+        bool add_to_archive(mz_zip_archive& archive, const std::string& name)
+        {
+            flush();
+
+            // An empty stored block marked as the last one of the stream.
+            static const uint8_t final_block[] = { 0x01, 0x00, 0x00, 0xff, 0xff };
+            m_block.data.insert(m_block.data.end(), std::begin(final_block), std::end(final_block));
+
+            return mz_zip_writer_add_mem_ex(&archive, name.c_str(), m_block.data.data(), m_block.data.size(), nullptr, 0,
+                MZ_ZIP_FLAG_COMPRESSED_DATA, m_block.size, m_block.crc);
+        }
+
+    private:
+        std::unique_ptr<tdefl_compressor, void(*)(tdefl_compressor*)> m_compressor;
+        std::string m_text;
+        Block m_block;
+
+        static mz_bool put_buf(const void* buf, int len, void* user)
+        {
+            auto data = static_cast<std::vector<uint8_t>*>(user);
+            auto bytes = static_cast<const uint8_t*>(buf);
+            data->insert(data->end(), bytes, bytes + len);
+            return MZ_TRUE;
+        }
+
+        XmlDeflater& write(const char* str, size_t len)
+        {
+            m_text.append(str, len);
+            if (m_text.size() >= ChunkSize)
+                compress(TDEFL_NO_FLUSH);
+            return *this;
+        }
+
+        template<class T> XmlDeflater& write_number(T v)
+        {
+            char buf[32];
+            return write(buf, size_t(format_number(buf, v) - buf));
+        }
+
+        void compress(tdefl_flush flush)
+        {
+            m_block.crc = uint32_t(mz_crc32(m_block.crc, reinterpret_cast<const mz_uint8*>(m_text.data()), m_text.size()));
+            m_block.size += m_text.size();
+            if (tdefl_compress_buffer(m_compressor.get(), m_text.data(), m_text.size(), flush) != TDEFL_STATUS_OKAY)
+                throw Slic3r::FileIOError("Unable to compress the model file");
+            m_text.clear();
+        }
+    };
+
+    // A document assembled from pieces, which are formatted and compressed in
+    // parallel. The static text is prepended to the next generated piece.
+    class XmlPieces
+    {
+    public:
+        using Generator = std::function<void(XmlDeflater&)>;
+
+        // Number of vertices or triangles written by a single piece.
+        static const size_t PieceSize = 1 << 16;
+
+        void text(const std::string& str) { m_text += str; }
+
+        void add(Generator fn)
+        {
+            m_pieces.push_back({ std::move(m_text), std::move(fn) });
+            m_text.clear();
+        }
+
+        // Write all the pieces into the output stream.
+        void write(XmlDeflater& out, mz_uint level)
+        {
+            if (!m_text.empty())
+                add(nullptr);
+
+            std::vector<XmlDeflater::Block> deflated(m_pieces.size());
+            tbb::parallel_for(size_t(0), m_pieces.size(), [this, &deflated, level](size_t i) {
+                const Piece& piece = m_pieces[i];
+                XmlDeflater stream(level);
+                stream << piece.prefix;
+                if (piece.fn)
+                    piece.fn(stream);
+                deflated[i] = stream.take();
+            });
+
+            for (XmlDeflater::Block& block : deflated) {
+                out.append(block);
+                block = XmlDeflater::Block();
+            }
+
+            m_pieces.clear();
+        }
+
+    private:
+        struct Piece
+        {
+            std::string prefix;
+            Generator fn;
+        };
+
+        std::vector<Piece> m_pieces;
+        std::string m_text;
+    };
+
     class _3MF_Exporter : public _3MF_Base
     {
         struct BuildItem
@@ -2026,9 +2489,9 @@ namespace Slic3r {
         bool _add_thumbnail_file_to_archive(mz_zip_archive& archive, const ThumbnailData& thumbnail_data);
         bool _add_relationships_file_to_archive(mz_zip_archive& archive);
         bool _add_model_file_to_archive(const std::string& filename, mz_zip_archive& archive, const Model& model, IdToObjectDataMap& objects_data);
-        bool _add_object_to_model_stream(std::stringstream& stream, unsigned int& object_id, ModelObject& object, BuildItemsList& build_items, VolumeToOffsetsMap& volumes_offsets);
-        bool _add_mesh_to_object_stream(std::stringstream& stream, ModelObject& object, VolumeToOffsetsMap& volumes_offsets);
-        bool _add_build_to_model_stream(std::stringstream& stream, const BuildItemsList& build_items);
+        bool _add_object_to_model_stream(XmlPieces& pieces, unsigned int& object_id, ModelObject& object, BuildItemsList& build_items, VolumeToOffsetsMap& volumes_offsets);
+        bool _add_mesh_to_object_stream(XmlPieces& pieces, ModelObject& object, VolumeToOffsetsMap& volumes_offsets);
+        bool _add_build_to_model_stream(XmlDeflater& stream, const BuildItemsList& build_items);
         bool _add_layer_height_profile_file_to_archive(mz_zip_archive& archive, Model& model);
         bool _add_layer_config_ranges_file_to_archive(mz_zip_archive& archive, Model& model);
         bool _add_sla_support_points_file_to_archive(mz_zip_archive& archive, Model& model);
@@ -2239,12 +2702,12 @@ namespace Slic3r {
 
     bool _3MF_Exporter::_add_model_file_to_archive(const std::string& filename, mz_zip_archive& archive, const Model& model, IdToObjectDataMap& objects_data)
     {
-        std::stringstream stream;
+        // The document is compressed while it is being written, it is never held in memory as a whole.
         // https://en.cppreference.com/w/cpp/types/numeric_limits/max_digits10
         // Conversion of a floating-point value to text and back is exact as long as at least max_digits10 were used (9 for float, 17 for double).
         // It is guaranteed to produce the same floating-point value, even though the intermediate text representation is not exact.
-        // The default value of std::stream precision is 6 digits only!
-		stream << std::setprecision(std::numeric_limits<float>::max_digits10);
+        // XmlDeflater formats all the floating point numbers with 9 significant digits.
+        XmlDeflater stream(MZ_DEFAULT_LEVEL);
         stream << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
         stream << "<" << MODEL_TAG << " unit=\"millimeter\" xml:lang=\"en-US\" xmlns=\"http://schemas.microsoft.com/3dmanufacturing/core/2015/02\" xmlns:slic3rpe=\"http://schemas.slic3r.org/3mf/2017/06\">\n";
         stream << " <" << METADATA_TAG << " name=\"" << SLIC3RPE_3MF_VERSION << "\">" << VERSION_3MF << "</" << METADATA_TAG << ">\n";
@@ -2270,6 +2733,8 @@ namespace Slic3r {
         // all the object instances of all ModelObjects are stored and indexed in a 1 based linear fashion.
         // Therefore the list of object_ids here may not be continuous.
         unsigned int object_id = 1;
+        // The objects are formatted and compressed in parallel.
+        XmlPieces pieces;
         for (ModelObject* obj : model.objects)
         {
             if (obj == nullptr)
@@ -2281,13 +2746,15 @@ namespace Slic3r {
             // Store geometry of all ModelVolumes contained in a single ModelObject into a single 3MF indexed triangle set object.
             // object_it->second.volumes_offsets will contain the offsets of the ModelVolumes in that single indexed triangle set.
             // object_id will be increased to point to the 1st instance of the next ModelObject.
-            if (!_add_object_to_model_stream(stream, object_id, *obj, build_items, object_it->second.volumes_offsets))
+            if (!_add_object_to_model_stream(pieces, object_id, *obj, build_items, object_it->second.volumes_offsets))
             {
                 add_error("Unable to add object to archive");
                 return false;
             }
         }
 
+        pieces.write(stream, MZ_DEFAULT_LEVEL);
+
         stream << " </" << RESOURCES_TAG << ">\n";
 
         // Store the transformations of all the ModelInstances of all ModelObjects, indexed in a linear fashion.
@@ -2299,9 +2766,7 @@ namespace Slic3r {
 
         stream << "</" << MODEL_TAG << ">\n";
 
-        std::string out = stream.str();
-
-        if (!mz_zip_writer_add_mem(&archive, MODEL_FILE.c_str(), (const void*)out.data(), out.length(), MZ_DEFAULT_COMPRESSION))
+        if (!stream.add_to_archive(archive, MODEL_FILE))
         {
             add_error("Unable to add model file to archive");
             return false;
@@ -2310,7 +2775,7 @@ namespace Slic3r {
         return true;
     }
 
-    bool _3MF_Exporter::_add_object_to_model_stream(std::stringstream& stream, unsigned int& object_id, ModelObject& object, BuildItemsList& build_items, VolumeToOffsetsMap& volumes_offsets)
+    bool _3MF_Exporter::_add_object_to_model_stream(XmlPieces& pieces, unsigned int& object_id, ModelObject& object, BuildItemsList& build_items, VolumeToOffsetsMap& volumes_offsets)
     {
         unsigned int id = 0;
         for (const ModelInstance* instance : object.instances)
@@ -2320,11 +2785,11 @@ namespace Slic3r {
                 continue;
 
             unsigned int instance_id = object_id + id;
-            stream << "  <" << OBJECT_TAG << " id=\"" << instance_id << "\" type=\"model\">\n";
+            pieces.text("  <" + std::string(OBJECT_TAG) + " id=\"" + std::to_string(instance_id) + "\" type=\"model\">\n");
 
             if (id == 0)
             {
-                if (!_add_mesh_to_object_stream(stream, object, volumes_offsets))
+                if (!_add_mesh_to_object_stream(pieces, object, volumes_offsets))
                 {
                     add_error("Unable to add mesh to archive");
                     return false;
@@ -2332,9 +2797,9 @@ namespace Slic3r {
             }
             else
             {
-                stream << "   <" << COMPONENTS_TAG << ">\n";
-                stream << "    <" << COMPONENT_TAG << " objectid=\"" << object_id << "\" />\n";
-                stream << "   </" << COMPONENTS_TAG << ">\n";
+                pieces.text("   <" + std::string(COMPONENTS_TAG) + ">\n");
+                pieces.text("    <" + std::string(COMPONENT_TAG) + " objectid=\"" + std::to_string(object_id) + "\" />\n");
+                pieces.text("   </" + std::string(COMPONENTS_TAG) + ">\n");
             }
 
             Transform3d t = instance->get_matrix();
@@ -2342,7 +2807,7 @@ namespace Slic3r {
             assert(instance_id == build_items.size() + 1);
             build_items.emplace_back(instance_id, t, instance->printable);
 
-            stream << "  </" << OBJECT_TAG << ">\n";
+            pieces.text("  </" + std::string(OBJECT_TAG) + ">\n");
 
             ++id;
         }
@@ -2351,10 +2816,10 @@ namespace Slic3r {
         return true;
     }
 
-    bool _3MF_Exporter::_add_mesh_to_object_stream(std::stringstream& stream, ModelObject& object, VolumeToOffsetsMap& volumes_offsets)
+    bool _3MF_Exporter::_add_mesh_to_object_stream(XmlPieces& pieces, ModelObject& object, VolumeToOffsetsMap& volumes_offsets)
     {
-        stream << "   <" << MESH_TAG << ">\n";
-        stream << "    <" << VERTICES_TAG << ">\n";
+        pieces.text("   <" + std::string(MESH_TAG) + ">\n");
+        pieces.text("    <" + std::string(VERTICES_TAG) + ">\n");
 
         unsigned int vertices_count = 0;
         for (ModelVolume* volume : object.volumes)
@@ -2378,20 +2843,29 @@ namespace Slic3r {
 
             vertices_count += (int)its.vertices.size();
 
-            const Transform3d& matrix = volume->get_matrix();
+            // The pieces are generated after this loop, the matrix is copied as get_matrix() returns a cached value.
+            Transform3d matrix = volume->get_matrix();
 
-            for (size_t i = 0; i < its.vertices.size(); ++i)
+            // The vertices are written in pieces of bounded size, which are formatted and compressed in parallel.
+            for (size_t begin = 0; begin < its.vertices.size(); begin += XmlPieces::PieceSize)
             {
-                stream << "     <" << VERTEX_TAG << " ";
-                Vec3f v = (matrix * its.vertices[i].cast<double>()).cast<float>();
-                stream << "x=\"" << v(0) << "\" ";
-                stream << "y=\"" << v(1) << "\" ";
-                stream << "z=\"" << v(2) << "\" />\n";
+                size_t end = std::min(its.vertices.size(), begin + XmlPieces::PieceSize);
+                pieces.add([volume, matrix, begin, end](XmlDeflater& stream) {
+                    const indexed_triangle_set &its = volume->mesh().its;
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        stream << "     <" << VERTEX_TAG << " ";
+                        Vec3f v = (matrix * its.vertices[i].cast<double>()).cast<float>();
+                        stream << "x=\"" << v(0) << "\" ";
+                        stream << "y=\"" << v(1) << "\" ";
+                        stream << "z=\"" << v(2) << "\" />\n";
+                    }
+                });
             }
         }
 
-        stream << "    </" << VERTICES_TAG << ">\n";
-        stream << "    <" << TRIANGLES_TAG << ">\n";
+        pieces.text("    </" + std::string(VERTICES_TAG) + ">\n");
+        pieces.text("    <" + std::string(TRIANGLES_TAG) + ">\n");
 
         unsigned int triangles_count = 0;
         for (ModelVolume* volume : object.volumes)
@@ -2409,33 +2883,41 @@ namespace Slic3r {
             triangles_count += (int)its.indices.size();
             volume_it->second.last_triangle_id = triangles_count - 1;
 
-            for (int i = 0; i < int(its.indices.size()); ++ i)
+            unsigned int first_vertex_id = volume_it->second.first_vertex_id;
+            for (size_t begin = 0; begin < its.indices.size(); begin += XmlPieces::PieceSize)
             {
-                stream << "     <" << TRIANGLE_TAG << " ";
-                for (int j = 0; j < 3; ++j)
-                {
-                    stream << "v" << j + 1 << "=\"" << its.indices[i][j] + volume_it->second.first_vertex_id << "\" ";
-                }
+                size_t end = std::min(its.indices.size(), begin + XmlPieces::PieceSize);
+                pieces.add([volume, first_vertex_id, begin, end](XmlDeflater& stream) {
+                    const indexed_triangle_set &its = volume->mesh().its;
+                    for (int i = int(begin); i < int(end); ++ i)
+                    {
+                        stream << "     <" << TRIANGLE_TAG << " ";
+                        for (int j = 0; j < 3; ++j)
+                        {
+                            stream << "v" << (unsigned int)(j + 1) << "=\"" << (unsigned int)(its.indices[i][j] + first_vertex_id) << "\" ";
+                        }
 
-                std::string custom_supports_data_string = volume->supported_facets.get_triangle_as_string(i);
-                if (! custom_supports_data_string.empty())
-                    stream << CUSTOM_SUPPORTS_ATTR << "=\"" << custom_supports_data_string << "\" ";
+                        std::string custom_supports_data_string = volume->supported_facets.get_triangle_as_string(i);
+                        if (! custom_supports_data_string.empty())
+                            stream << CUSTOM_SUPPORTS_ATTR << "=\"" << custom_supports_data_string << "\" ";
 
-                std::string custom_seam_data_string = volume->seam_facets.get_triangle_as_string(i);
-                if (! custom_seam_data_string.empty())
-                    stream << CUSTOM_SEAM_ATTR << "=\"" << custom_seam_data_string << "\" ";
+                        std::string custom_seam_data_string = volume->seam_facets.get_triangle_as_string(i);
+                        if (! custom_seam_data_string.empty())
+                            stream << CUSTOM_SEAM_ATTR << "=\"" << custom_seam_data_string << "\" ";
 
-                stream << "/>\n";
+                        stream << "/>\n";
+                    }
+                });
             }
         }
 
-        stream << "    </" << TRIANGLES_TAG << ">\n";
-        stream << "   </" << MESH_TAG << ">\n";
+        pieces.text("    </" + std::string(TRIANGLES_TAG) + ">\n");
+        pieces.text("   </" + std::string(MESH_TAG) + ">\n");
 
         return true;
     }
 
-    bool _3MF_Exporter::_add_build_to_model_stream(std::stringstream& stream, const BuildItemsList& build_items)
+    bool _3MF_Exporter::_add_build_to_model_stream(XmlDeflater& stream, const BuildItemsList& build_items)
     {
         if (build_items.size() == 0)
         {
@@ -2457,7 +2939,7 @@ namespace Slic3r {
                         stream << " ";
                 }
             }
-            stream << "\" " << PRINTABLE_ATTR << "=\"" << item.printable << "\" />\n";
+            stream << "\" " << PRINTABLE_ATTR << "=\"" << (item.printable ? "1" : "0") << "\" />\n";
         }
 
         stream << " </" << BUILD_TAG << ">\n";
@@ -17,13 +17,19 @@
 #include "libslic3r/MTUtils.hpp"
 #include "libslic3r/PrintConfig.hpp"
 #include "libslic3r/SLA/RasterBase.hpp"
+#include "libslic3r/SLA/ScanlineRaster.hpp"
 #include "libslic3r/miniz_extension.hpp"
 #include "libslic3r/PNGRead.hpp"
+#include "libslic3r/I18N.hpp"
 
 #include <boost/property_tree/ini_parser.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/algorithm/string.hpp>
 
+//! macro used to mark string used at localization,
+//! return same string
+#define L(s) Slic3r::I18N::translate(s)
+
 namespace marchsq {
 
 template<> struct _RasterTraits<Slic3r::png::ImageGreyscale> {
@@ -49,6 +55,7 @@ namespace Slic3r {
 
 namespace {
 
+// Encoded layer image, png or rle (see sla::RLERasterEncoder)
 struct PNGBuffer { std::vector<uint8_t> buf; std::string fname; };
 struct ArchiveData {
     boost::property_tree::ptree profile, config;
@@ -86,8 +93,15 @@ PNGBuffer read_png(const mz_zip_archive_file_stat &entry,
     return {std::move(buf), (name.empty() ? entry.m_filename : name)};
 }
 
+bool is_layer_image(const std::string &name)
+{
+    auto ext = boost::filesystem::path(name).extension().string();
+    return ext == ".png" || ext == ".rle";
+}
+
 ArchiveData extract_sla_archive(const std::string &zipfname,
-                                 const std::string &exclude)
+                                 const std::string &exclude,
+                                 bool               read_images = true)
 {
     ArchiveData arch;
 
@@ -117,7 +131,7 @@ ArchiveData extract_sla_archive(const std::string &zipfname,
             if (name == CONFIG_FNAME) arch.config = read_ini(entry, zip);
             if (name == PROFILE_FNAME) arch.profile = read_ini(entry, zip);
 
-            if (boost::filesystem::path(name).extension().string() == ".png") {
+            if (read_images && is_layer_image(name)) {
                 auto it = std::lower_bound(
                     arch.images.begin(), arch.images.end(), PNGBuffer{{}, name},
                     [](const PNGBuffer &r1, const PNGBuffer &r2) {
@@ -187,6 +201,7 @@ void invert_raster_trafo(ExPolygons &                  expolys,
 struct RasterParams {
     sla::RasterBase::Trafo trafo; // Raster transformations
     coord_t        width, height; // scaled raster dimensions (not resolution)
+    sla::RasterBase::Resolution res; // resolution of the layer images
     double         px_h, px_w;    // pixel dimesions
     marchsq::Coord win;           // marching squares window size
 };
@@ -218,6 +233,13 @@ RasterParams get_raster_params(const DynamicPrintConfig &cfg)
     rstp.height = scaled(opt_disp_h->value);
     rstp.width  = scaled(opt_disp_w->value);
 
+    // The layer images are written rotated for the portrait orientation,
+    // see SL1Archive::create_raster().
+    auto cols = size_t(std::max(opt_disp_cols->value, 0));
+    auto rows = size_t(std::max(opt_disp_rows->value, 0));
+    if (rstp.trafo.flipXY) std::swap(cols, rows);
+    rstp.res = sla::RasterBase::Resolution{cols, rows};
+
     return rstp;
 }
 
@@ -251,33 +273,56 @@ std::vector<ExPolygons> extract_slices_from_sla_archive(
         tbb::spin_mutex mutex;
     } st {100. / slices.size(), 0., 0.};
 
-    tbb::parallel_for(size_t(0), arch.images.size(),
-                     [&arch, &slices, &st, &rstp, progr](size_t i) {
-        // Status indication guarded with the spinlock
-        {
-            std::lock_guard<tbb::spin_mutex> lck(st.mutex);
-            if (st.stop) return;
-
-            st.val += st.incr;
-            double curr = std::round(st.val);
-            if (curr > st.prev) {
-                st.prev = curr;
-                st.stop = !progr(int(curr));
-            }
-        }
+    // Delta encoded images can only be decoded after their predecessor,
+    // the images are processed in groups starting with a standalone image.
+    std::vector<size_t> groups;
+    for (size_t i = 0; i < arch.images.size(); ++i) {
+        const std::vector<uint8_t> &buf = arch.images[i].buf;
+        if (groups.empty() || !sla::is_delta_rle(buf.data(), buf.size()))
+            groups.emplace_back(i);
+    }
+    groups.emplace_back(arch.images.size());
 
+    tbb::parallel_for(size_t(0), groups.size() - 1,
+                     [&arch, &slices, &st, &rstp, &groups, progr](size_t g) {
         png::ImageGreyscale img;
-        png::ReadBuf rb{arch.images[i].buf.data(), arch.images[i].buf.size()};
-        if (!png::decode_png(rb, img)) return;
-
-        auto rings = marchsq::execute(img, 128, rstp.win);
-        ExPolygons expolys = rings_to_expolygons(rings, rstp.px_w, rstp.px_h);
-
-        // Invert the raster transformations indicated in
-        // the profile metadata
-        invert_raster_trafo(expolys, rstp.trafo, rstp.width, rstp.height);
+        img.rows = 0; img.cols = 0;
+
+        for (size_t i = groups[g]; i < groups[g + 1]; ++i) {
+            // Status indication guarded with the spinlock
+            {
+                std::lock_guard<tbb::spin_mutex> lck(st.mutex);
+                if (st.stop) return;
+
+                st.val += st.incr;
+                double curr = std::round(st.val);
+                if (curr > st.prev) {
+                    st.prev = curr;
+                    st.stop = !progr(int(curr));
+                }
+            }
 
-        slices[i] = std::move(expolys);
+            // The following delta encoded images of the group cannot be
+            // decoded without this one, the archive is reported as invalid.
+            const std::vector<uint8_t> &buf = arch.images[i].buf;
+            png::ReadBuf rb{buf.data(), buf.size()};
+            bool decoded = png::is_png(rb) ?
+                               png::decode_png(rb, img) :
+                               sla::decode_rle(buf.data(), buf.size(), rstp.res,
+                                               img.buf, img.cols, img.rows);
+            if (!decoded)
+                throw Slic3r::FileIOError("Invalid layer image " +
+                                          arch.images[i].fname);
+
+            auto rings = marchsq::execute(img, 128, rstp.win);
+            ExPolygons expolys = rings_to_expolygons(rings, rstp.px_w, rstp.px_h);
+
+            // Invert the raster transformations indicated in
+            // the profile metadata
+            invert_raster_trafo(expolys, rstp.trafo, rstp.width, rstp.height);
+
+            slices[i] = std::move(expolys);
+        }
     });
 
     if (st.stop) slices = {};
@@ -289,7 +334,7 @@ std::vector<ExPolygons> extract_slices_from_sla_archive(
 
 void import_sla_archive(const std::string &zipfname, DynamicPrintConfig &out)
 {
-    ArchiveData arch = extract_sla_archive(zipfname, "png");
+    ArchiveData arch = extract_sla_archive(zipfname, "thumbnail", false);
     out.load(arch.profile);
 }
 
@@ -433,16 +478,36 @@ uqptr<sla::RasterBase> SL1Archive::create_raster() const
 
     double gamma = m_cfg.gamma_correction.getFloat();
 
+    // The single pass scanline raster is faster, its anti-aliased edge pixels
+    // differ slightly from the AGG raster.
+    if (m_cfg.fast_rasterization.getBool())
+        return sla::create_raster_grayscale_scanline(res, pxdim, gamma, tr);
+
     return sla::create_raster_grayscale_aa(res, pxdim, gamma, tr);
 }
 
 sla::RasterEncoder SL1Archive::get_encoder() const
 {
-    return sla::PNGRasterEncoder{};
+    // Only PNG is accepted by the Prusa printers, the run-length encodings are
+    // faster and with the delta encoding much smaller for tall prints. All of
+    // them can be imported.
+    switch (m_cfg.layer_encoding.getInt()) {
+    case slaleFastPNG: return sla::PNGRasterEncoder{1};
+    case slaleRLE: return sla::RLERasterEncoder{};
+    case slaleDeltaRLE: return sla::DeltaRLERasterEncoder{};
+    case slalePNG:
+    default: return sla::PNGRasterEncoder{};
+    }
+}
+
+size_t SL1Archive::layer_group_size() const
+{
+    // A standalone layer every once in a while keeps the encoding parallel.
+    return m_cfg.layer_encoding.getInt() == slaleDeltaRLE ? 32 : 1;
 }
 
 void SL1Archive::export_print(Zipper& zipper,
-                              const SLAPrint &print,
+                              SLAPrint &print,
                               const std::string &prjname)
 {
     std::string project =
@@ -463,14 +528,51 @@ void SL1Archive::export_print(Zipper& zipper,
         zipper.add_entry("prusaslicer.ini");
         zipper << to_ini(slicerconf);
         
-        size_t i = 0;
-        for (const sla::EncodedRaster &rst : m_layers) {
-
-            std::string imgname = project + string_printf("%.5d", i++) + "." +
-                                  rst.extension();
-            
-            zipper.add_entry(imgname.c_str(), rst.data(), rst.size());
+        if (is_streaming()) {
+            // Rasterize, encode and deflate the layers in parallel, write
+            // them into the archive in order as soon as they are ready.
+            const auto &layers = print.print_layers();
+            int         status = -1;
+            stream_layers(
+                layers.size(),
+                [&layers](sla::RasterBase &raster, size_t idx) {
+                    for (const ClipperLib::Polygon &poly :
+                         layers[idx].transformed_slices())
+                        raster.draw(poly);
+                },
+                [&zipper, &project](sla::EncodedRaster &&rst, size_t idx) {
+                    std::string imgname = project +
+                                          string_printf("%.5d", int(idx)) +
+                                          "." + rst.extension();
+
+                    return zipper.compress_entry(imgname, rst.data(), rst.size());
+                },
+                [&zipper](Zipper::CompressedEntry &&entry, size_t) {
+                    zipper.add_entry(entry);
+                },
+                [&print] { return print.canceled(); },
+                [&print, &status, &layers](size_t done) {
+                    // The export follows the finished print at 90 %, like
+                    // the G-code export.
+                    int st = 90 + int(10 * done / layers.size());
+                    if (st != status)
+                        print.set_status(status = st, L("Rasterizing layers"));
+                });
+
+            if (print.canceled())
+                throw CanceledException();
+        } else {
+            size_t i = 0;
+            for (const sla::EncodedRaster &rst : m_layers) {
+
+                std::string imgname = project + string_printf("%.5d", i++) + "." +
+                                      rst.extension();
+                
+                zipper.add_entry(imgname.c_str(), rst.data(), rst.size());
+            }
         }
+    } catch(CanceledException&) {
+        throw;
     } catch(std::exception& e) {
         BOOST_LOG_TRIVIAL(error) << e.what();
         // Rethrow the exception
@@ -14,6 +14,7 @@ class SL1Archive: public SLAPrinter {
 protected:
     uqptr<sla::RasterBase> create_raster() const override;
     sla::RasterEncoder get_encoder() const override;
+    size_t layer_group_size() const override;
     
 public:
     
@@ -21,8 +22,11 @@ public:
     explicit SL1Archive(const SLAPrinterConfig &cfg): m_cfg(cfg) {}
     explicit SL1Archive(SLAPrinterConfig &&cfg): m_cfg(std::move(cfg)) {}
     
-    void export_print(Zipper &zipper, const SLAPrint &print, const std::string &projectname = "");
-    void export_print(const std::string &fname, const SLAPrint &print, const std::string &projectname = "")
+    // In streaming mode, the layers are rasterized here. The status is
+    // reported through the print and a cancellation of the print throws
+    // CanceledException.
+    void export_print(Zipper &zipper, SLAPrint &print, const std::string &projectname = "");
+    void export_print(const std::string &fname, SLAPrint &print, const std::string &projectname = "")
     {
         Zipper zipper(fname);
         export_print(zipper, print, projectname);
@@ -31,6 +31,7 @@
 #include "SVG.hpp"
 
 #include <tbb/parallel_for.h>
+#include <tbb/pipeline.h>
 
 #include <Shiny/Shiny.h>
 
@@ -995,6 +996,60 @@ std::vector<const PrintInstance*> sort_object_instances_by_model_order(const Pri
     return instances;
 }
 
+template<typename LayerGenerator>
+void GCode::process_layers(const Print &print, FILE *file, size_t num_layers, LayerGenerator &&layer_generator)
+{
+    // The G-code of the layers is generated, post-processed and written out by serial stages of a pipeline,
+    // thus the post-processors may work on a layer on their own threads while the following layers are being generated.
+    // Each post-processor keeps its own state and it consumes the layers in order.
+    size_t layer_idx = 0;
+    const auto generator = tbb::make_filter<void, LayerResult>(tbb::filter::serial_in_order,
+        [&print, num_layers, &layer_idx, &layer_generator](tbb::flow_control &fc) -> LayerResult {
+            if (layer_idx == num_layers) {
+                fc.stop();
+                return {};
+            }
+            LayerResult result = layer_generator(layer_idx ++);
+            print.throw_if_canceled();
+            return result;
+        });
+    // Apply spiral vase post-processing if this layer contains suitable geometry
+    // (we must feed all the G-code into the post-processor, including the first
+    // bottom non-spiral layers otherwise it will mess with positions)
+    // we apply spiral vase at this stage because it requires a full layer.
+    // Just a reminder: A spiral vase mode is allowed for a single object per layer, single material print only.
+    const auto spiral_vase = tbb::make_filter<LayerResult, LayerResult>(tbb::filter::serial_in_order,
+        [spiral_vase = m_spiral_vase.get()](LayerResult in) -> LayerResult {
+            if (spiral_vase != nullptr && ! in.gcode.empty()) {
+                spiral_vase->enable = in.spiral_vase_enable;
+                in.gcode = spiral_vase->process_layer(in.gcode);
+            }
+            return in;
+        });
+    // Apply cooling logic; this may alter speeds.
+    // The cooling buffer works on its own copy of the configuration and of the extruders, and it keeps its own fan state,
+    // as the generator modifies its state while the cooling buffer processes the layers below.
+    const auto cooling = tbb::make_filter<LayerResult, std::string>(tbb::filter::serial_in_order,
+        [cooling_buffer = m_cooling_buffer.get()](LayerResult in) -> std::string {
+            return (cooling_buffer == nullptr || in.gcode.empty()) ? std::move(in.gcode) : cooling_buffer->process_layer(in.gcode, in.layer_id);
+        });
+#ifdef HAS_PRESSURE_EQUALIZER
+    // Apply pressure equalization if enabled;
+    const auto pressure_equalizer = tbb::make_filter<std::string, std::string>(tbb::filter::serial_in_order,
+        [pressure_equalizer = m_pressure_equalizer.get()](std::string in) -> std::string {
+            return (pressure_equalizer == nullptr || in.empty()) ? in : pressure_equalizer->process(in.c_str(), false);
+        });
+#endif /* HAS_PRESSURE_EQUALIZER */
+    const auto output = tbb::make_filter<std::string, void>(tbb::filter::serial_in_order,
+        [this, file](const std::string &gcode) { _write(file, gcode); });
+
+#ifdef HAS_PRESSURE_EQUALIZER
+    tbb::parallel_pipeline(LayerPipelineSize, generator & spiral_vase & cooling & pressure_equalizer & output);
+#else /* HAS_PRESSURE_EQUALIZER */
+    tbb::parallel_pipeline(LayerPipelineSize, generator & spiral_vase & cooling & output);
+#endif /* HAS_PRESSURE_EQUALIZER */
+}
+
 void GCode::_do_export(Print& print, FILE* file, ThumbnailsGeneratorCallback thumbnail_cb)
 {
     PROFILE_FUNC();
@@ -1046,7 +1101,6 @@ void GCode::_do_export(Print& print, FILE* file, ThumbnailsGeneratorCallback thu
     m_volumetric_speed = DoExport::autospeed_volumetric_limit(print);
     print.throw_if_canceled();
 
-    m_cooling_buffer = make_unique<CoolingBuffer>(*this);
     if (print.config().spiral_vase.value)
         m_spiral_vase = make_unique<SpiralVase>(print.config());
 #ifdef HAS_PRESSURE_EQUALIZER
@@ -1156,6 +1210,8 @@ void GCode::_do_export(Print& print, FILE* file, ThumbnailsGeneratorCallback thu
     }
     print.throw_if_canceled();
 
+    // The cooling buffer copies the configuration and the extruders, as it processes the layers on its own thread.
+    m_cooling_buffer = make_unique<CoolingBuffer>(*this);
     m_cooling_buffer->set_current_extruder(initial_extruder_id);
 
     // Emit machine envelope limits for the Marlin firmware.
@@ -1285,16 +1341,23 @@ void GCode::_do_export(Print& print, FILE* file, ThumbnailsGeneratorCallback thu
                 _writeln(file, between_objects_gcode);
             }
             // Reset the cooling buffer internal state (the current position, feed rate, accelerations).
-            m_cooling_buffer->reset();
+            m_cooling_buffer->reset(m_writer.get_position());
             m_cooling_buffer->set_current_extruder(initial_extruder_id);
             // Pair the object layers with the support layers by z, extrude them.
             std::vector<LayerToPrint> layers_to_print = collect_layers_to_print(object);
-            for (const LayerToPrint &ltp : layers_to_print) {
+            const size_t              single_object_instance_idx = *print_object_instance_sequential_active - object.instances().data();
+            this->process_layers(print, file, layers_to_print.size(), [this, &print, &tool_ordering, &layers_to_print, single_object_instance_idx](size_t idx) {
+                if (idx % LayerBatchSize == 0) {
+                    std::vector<const Layer*> layers;
+                    for (size_t i = idx; i < std::min(idx + LayerBatchSize, layers_to_print.size()); ++ i)
+                        layers.emplace_back(layers_to_print[i].object_layer);
+                    this->prepare_layers(layers);
+                }
+                const LayerToPrint &ltp = layers_to_print[idx];
                 std::vector<LayerToPrint> lrs;
-                lrs.emplace_back(std::move(ltp));
-                this->process_layer(file, print, lrs, tool_ordering.tools_for_layer(ltp.print_z()), nullptr, *print_object_instance_sequential_active - object.instances().data());
-                print.throw_if_canceled();
-            }
+                lrs.emplace_back(ltp);
+                return this->process_layer(print, lrs, tool_ordering.tools_for_layer(ltp.print_z()), nullptr, single_object_instance_idx);
+            });
 #ifdef HAS_PRESSURE_EQUALIZER
             if (m_pressure_equalizer)
                 _write(file, m_pressure_equalizer->process("", true));
@@ -1340,13 +1403,20 @@ void GCode::_do_export(Print& print, FILE* file, ThumbnailsGeneratorCallback thu
             print.throw_if_canceled();
         }
         // Extrude the layers.
-        for (auto &layer : layers_to_print) {
+        this->process_layers(print, file, layers_to_print.size(), [this, &print, &tool_ordering, &layers_to_print, &print_object_instances_ordering](size_t idx) {
+            if (idx % LayerBatchSize == 0) {
+                std::vector<const Layer*> layers;
+                for (size_t i = idx; i < std::min(idx + LayerBatchSize, layers_to_print.size()); ++ i)
+                    for (const LayerToPrint &ltp : layers_to_print[i].second)
+                        layers.emplace_back(ltp.object_layer);
+                this->prepare_layers(layers);
+            }
+            const auto       &layer       = layers_to_print[idx];
             const LayerTools &layer_tools = tool_ordering.tools_for_layer(layer.first);
             if (m_wipe_tower && layer_tools.has_wipe_tower)
                 m_wipe_tower->next_layer();
-            this->process_layer(file, print, layer.second, layer_tools, &print_object_instances_ordering, size_t(-1));
-            print.throw_if_canceled();
-        }
+            return this->process_layer(print, layer.second, layer_tools, &print_object_instances_ordering, size_t(-1));
+        });
 #ifdef HAS_PRESSURE_EQUALIZER
         if (m_pressure_equalizer)
             _write(file, m_pressure_equalizer->process("", true));
@@ -1356,9 +1426,13 @@ void GCode::_do_export(Print& print, FILE* file, ThumbnailsGeneratorCallback thu
             _write(file, m_wipe_tower->finalize(*this));
     }
 
+    // Release the distance fields prepared for the seam placement and the island assignment.
+    this->prepare_layers({});
+
     // Write end commands to file.
     _write(file, this->retract());
-    _write(file, m_writer.set_fan(false));
+    // The fan was controlled by the cooling buffer while the layers were exported.
+    _write(file, m_cooling_buffer->set_fan(0));
 
     // adds tag for processor
     _write_format(file, ";%s%s\n", GCodeProcessor::Extrusion_Role_Tag.c_str(), ExtrusionEntity::role_to_string(erCustom).c_str());
@@ -1794,14 +1868,41 @@ namespace Skirt {
 
 } // namespace Skirt
 
+void GCode::prepare_layers(const std::vector<const Layer*> &layers)
+{
+    // In spiral vase mode the loops are split at the last position, the seam placer is not consulted.
+    if (! m_spiral_vase)
+        m_seam_placer.prepare_lower_layer_edge_grids(layers);
+
+    m_layer_islands.clear();
+    for (const Layer *layer : layers)
+        if (layer != nullptr) {
+            m_layer_islands.emplace_back();
+            m_layer_islands.back().layer = layer;
+        }
+    std::sort(m_layer_islands.begin(), m_layer_islands.end(), [](const LayerIslands &l, const LayerIslands &r) { return l.layer < r.layer; });
+    m_layer_islands.erase(std::unique(m_layer_islands.begin(), m_layer_islands.end(),
+        [](const LayerIslands &l, const LayerIslands &r) { return l.layer == r.layer; }), m_layer_islands.end());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, m_layer_islands.size()),
+        [this](const tbb::blocked_range<size_t> &range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i)
+                m_layer_islands[i] = assign_extrusions_to_islands(*m_layer_islands[i].layer);
+        });
+}
+
+const LayerIslands* GCode::layer_islands(const Layer *layer) const
+{
+    auto it = std::lower_bound(m_layer_islands.begin(), m_layer_islands.end(), layer,
+        [](const LayerIslands &l, const Layer *layer) { return l.layer < layer; });
+    return (it != m_layer_islands.end() && it->layer == layer) ? &(*it) : nullptr;
+}
+
 // In sequential mode, process_layer is called once per each object and its copy,
 // therefore layers will contain a single entry and single_object_instance_idx will point to the copy of the object.
 // In non-sequential mode, process_layer is called per each print_z height with all object and support layers accumulated.
 // For multi-material prints, this routine minimizes extruder switches by gathering extruder specific extrusion paths
 // and performing the extruder specific extrusions together.
-void GCode::process_layer(
-    // Write into the output file.
-    FILE                            		*file,
+GCode::LayerResult GCode::process_layer(
     const Print                    			&print,
     // Set of object & print layers of the same PrintObject and with the same print_z.
     const std::vector<LayerToPrint> 		&layers,
@@ -1818,7 +1919,7 @@ void GCode::process_layer(
 
     if (layer_tools.extruders.empty())
         // Nothing to extrude.
-        return;
+        return {};
 
     // Extract 1st object_layer and support_layer of this set of layers with an equal print_z.
     const Layer         *object_layer  = nullptr;
@@ -1837,6 +1938,9 @@ void GCode::process_layer(
     // Initialize config with the 1st object to be printed at this layer.
     m_config.apply(layer.object()->config(), true);
 
+    // The spiral vase post-processor keeps its state from the layer below, unless enabled or disabled for this layer.
+    LayerResult result { {}, layer.id(), m_spiral_vase && ! m_enable_loop_clipping };
+
     // Check whether it is possible to apply the spiral vase logic for this layer.
     // Just a reminder: A spiral vase mode is allowed for a single object, single material print only.
     if (m_spiral_vase && layers.size() == 1 && support_layer == nullptr) {
@@ -1850,12 +1954,12 @@ void GCode::process_layer(
                     break;
                 }
         }
-        m_spiral_vase->enable = enable;
+        result.spiral_vase_enable = enable;
     }
     // If we're going to apply spiralvase to this layer, disable loop clipping
-    m_enable_loop_clipping = ! m_spiral_vase || ! m_spiral_vase->enable;
+    m_enable_loop_clipping = ! result.spiral_vase_enable;
 
-    std::string gcode;
+    std::string &gcode = result.gcode;
 
     // add tag for processor
     gcode += "; " + GCodeProcessor::Layer_Change_Tag + "\n";
@@ -1983,24 +2087,13 @@ void GCode::process_layer(
             //   option
             // (Still, we have to keep track of regions because we need to apply their config)
             size_t n_slices = layer.lslices.size();
-            const std::vector<BoundingBox> &layer_surface_bboxes = layer.lslices_bboxes;
-            // Traverse the slices in an increasing order of bounding box size, so that the islands inside another islands are tested first,
-            // so we can just test a point inside ExPolygon::contour and we may skip testing the holes.
-            std::vector<size_t> slices_test_order;
-            slices_test_order.reserve(n_slices);
-            for (size_t i = 0; i < n_slices; ++ i)
-                slices_test_order.emplace_back(i);
-            std::sort(slices_test_order.begin(), slices_test_order.end(), [&layer_surface_bboxes](size_t i, size_t j) {
-                const Vec2d s1 = layer_surface_bboxes[i].size().cast<double>();
-                const Vec2d s2 = layer_surface_bboxes[j].size().cast<double>();
-                return s1.x() * s1.y() < s2.x() * s2.y();
-            });
-            auto point_inside_surface = [&layer, &layer_surface_bboxes](const size_t i, const Point &point) {
-                const BoundingBox &bbox = layer_surface_bboxes[i];
-                return point(0) >= bbox.min(0) && point(0) < bbox.max(0) &&
-                       point(1) >= bbox.min(1) && point(1) < bbox.max(1) &&
-                       layer.lslices[i].contour.contains(point);
-            };
+            // Island containing each of the extrusion collections, usually prepared in parallel by GCode::prepare_layers().
+            LayerIslands        layer_islands_local;
+            const LayerIslands *layer_islands = this->layer_islands(&layer);
+            if (layer_islands == nullptr) {
+                layer_islands_local = assign_extrusions_to_islands(layer);
+                layer_islands       = &layer_islands_local;
+            }
 
             for (size_t region_id = 0; region_id < layer.regions().size(); ++ region_id) {
                 const LayerRegion *layerm = layer.regions()[region_id];
@@ -2013,10 +2106,12 @@ void GCode::process_layer(
                 // The process is almost the same for perimeters and infills - we will do it in a cycle that repeats twice:
                 std::vector<unsigned int> printing_extruders;
                 for (const ObjectByExtruder::Island::Region::Type entity_type : { ObjectByExtruder::Island::Region::INFILL, ObjectByExtruder::Island::Region::PERIMETERS }) {
-                    for (const ExtrusionEntity *ee : (entity_type == ObjectByExtruder::Island::Region::INFILL) ? layerm->fills.entities : layerm->perimeters.entities) {
+                    const bool                 perimeters = entity_type == ObjectByExtruder::Island::Region::PERIMETERS;
+                    const ExtrusionEntitiesPtr &entities  = perimeters ? layerm->perimeters.entities : layerm->fills.entities;
+                    for (size_t entity_idx = 0; entity_idx < entities.size(); ++ entity_idx) {
                         // extrusions represents infill or perimeter extrusions of a single island.
-                        assert(dynamic_cast<const ExtrusionEntityCollection*>(ee) != nullptr);
-                        const auto *extrusions = static_cast<const ExtrusionEntityCollection*>(ee);
+                        assert(dynamic_cast<const ExtrusionEntityCollection*>(entities[entity_idx]) != nullptr);
+                        const auto *extrusions = static_cast<const ExtrusionEntityCollection*>(entities[entity_idx]);
                         if (extrusions->entities.empty()) // This shouldn't happen but first_point() would fail.
                             continue;
 
@@ -2032,7 +2127,7 @@ void GCode::process_layer(
                         }
                         printing_extruders.clear();
                         if (is_anything_overridden) {
-                            entity_overrides = const_cast<LayerTools&>(layer_tools).wiping_extrusions().get_extruder_overrides(extrusions, correct_extruder_id, layer_to_print.object()->instances().size());
+                            entity_overrides = const_cast<LayerTools&>(layer_tools).wiping_extrusions().get_extruder_overrides(*layerm, perimeters, entity_idx, correct_extruder_id, layer_to_print.object()->instances().size());
                             if (entity_overrides == nullptr) {
                                 printing_extruders.emplace_back(correct_extruder_id);
                             } else {
@@ -2056,19 +2151,11 @@ void GCode::process_layer(
                                 extruder,
                                 &layer_to_print - layers.data(),
                                 layers.size(), n_slices+1);
-                            for (size_t i = 0; i <= n_slices; ++ i) {
-                                bool   last = i == n_slices;
-                                size_t island_idx = last ? n_slices : slices_test_order[i];
-                                if (// extrusions->first_point does not fit inside any slice
-                                    last ||
-                                    // extrusions->first_point fits inside ith slice
-                                    point_inside_surface(island_idx, extrusions->first_point())) {
-                                    if (islands[island_idx].by_region.empty())
-                                        islands[island_idx].by_region.assign(print.regions().size(), ObjectByExtruder::Island::Region());
-                                    islands[island_idx].by_region[region_id].append(entity_type, extrusions, entity_overrides);
-                                    break;
-                                }
-                            }
+                            // n_slices if extrusions->first_point does not fit inside any slice.
+                            size_t island_idx = layer_islands->island(region_id, perimeters, entity_idx);
+                            if (islands[island_idx].by_region.empty())
+                                islands[island_idx].by_region.assign(print.regions().size(), ObjectByExtruder::Island::Region());
+                            islands[island_idx].by_region[region_id].append(entity_type, extrusions, entity_overrides);
                         }
                     }
                 }
@@ -2141,7 +2228,7 @@ void GCode::process_layer(
                 m_config.apply(instance_to_print.print_object.config(), true);
                 m_layer = layers[instance_to_print.layer_id].layer();
                 if (m_config.avoid_crossing_perimeters)
-                    m_avoid_crossing_perimeters.init_layer_mp(union_ex(m_layer->lslices, true));
+                    m_avoid_crossing_perimeters.init_layer_mp(*m_layer);
 
                 if (this->config().gcode_label_objects)
                     gcode += std::string("; printing object ") + instance_to_print.print_object.model_object()->name + " id:" + std::to_string(instance_to_print.layer_id) + " copy " + std::to_string(instance_to_print.instance_id) + "\n";
@@ -2156,7 +2243,9 @@ void GCode::process_layer(
                     m_layer = layers[instance_to_print.layer_id].support_layer;
                     gcode += this->extrude_support(
                         // support_extrusion_role is erSupportMaterial, erSupportMaterialInterface or erMixed for all extrusion paths.
-                        instance_to_print.object_by_extruder.support->chained_path_from(m_last_pos, instance_to_print.object_by_extruder.support_extrusion_role));
+                        // The support islands are small and scattered, the travels between them are worth shortening.
+                        // The refinement runs here on the serial export of the layer, it only kicks in for the longer chains.
+                        instance_to_print.object_by_extruder.support->chained_path_from(m_last_pos, instance_to_print.object_by_extruder.support_extrusion_role, true));
                     m_layer = layers[instance_to_print.layer_id].layer();
                 }
                 for (ObjectByExtruder::Island &island : instance_to_print.object_by_extruder.islands) {
@@ -2178,29 +2267,9 @@ void GCode::process_layer(
         }
     }
 
-    // Apply spiral vase post-processing if this layer contains suitable geometry
-    // (we must feed all the G-code into the post-processor, including the first
-    // bottom non-spiral layers otherwise it will mess with positions)
-    // we apply spiral vase at this stage because it requires a full layer.
-    // Just a reminder: A spiral vase mode is allowed for a single object per layer, single material print only.
-    if (m_spiral_vase)
-        gcode = m_spiral_vase->process_layer(gcode);
-
-    // Apply cooling logic; this may alter speeds.
-    if (m_cooling_buffer)
-        gcode = m_cooling_buffer->process_layer(gcode, layer.id());
-
-#ifdef HAS_PRESSURE_EQUALIZER
-    // Apply pressure equalization if enabled;
-    // printf("G-code before filter:\n%s\n", gcode.c_str());
-    if (m_pressure_equalizer)
-        gcode = m_pressure_equalizer->process(gcode.c_str(), false);
-    // printf("G-code after filter:\n%s\n", out.c_str());
-#endif /* HAS_PRESSURE_EQUALIZER */
-
-    _write(file, gcode);
-    BOOST_LOG_TRIVIAL(trace) << "Exported layer " << layer.id() << " print_z " << print_z <<
+    BOOST_LOG_TRIVIAL(trace) << "Generated layer " << layer.id() << " print_z " << print_z <<
         log_memory_info();
+    return result;
 }
 
 void GCode::apply_print_config(const PrintConfig &print_config)
@@ -2298,13 +2367,13 @@ std::string GCode::extrude_loop(ExtrusionLoop loop, std::string description, dou
     // get a copy; don't modify the orientation of the original loop object otherwise
     // next copies (if any) would not detect the correct orientation
 
+    const EdgeGrid::Grid *edge_grid_ptr = nullptr;
     if (m_layer->lower_layer != nullptr && lower_layer_edge_grid != nullptr) {
-        if (! *lower_layer_edge_grid) {
+        // The distance fields are usually prepared in parallel by GCode::prepare_seams().
+        edge_grid_ptr = m_seam_placer.lower_layer_edge_grid(m_layer);
+        if (edge_grid_ptr == nullptr && ! *lower_layer_edge_grid) {
             // Create the distance field for a layer below.
-            const coord_t distance_field_resolution = coord_t(scale_(1.) + 0.5);
-            *lower_layer_edge_grid = make_unique<EdgeGrid::Grid>();
-            (*lower_layer_edge_grid)->create(m_layer->lower_layer->lslices, distance_field_resolution);
-            (*lower_layer_edge_grid)->calculate_sdf();
+            *lower_layer_edge_grid = SeamPlacer::create_lower_layer_edge_grid(*m_layer);
             #if 0
             {
                 static int iRun = 0;
@@ -2317,6 +2386,8 @@ std::string GCode::extrude_loop(ExtrusionLoop loop, std::string description, dou
             }
             #endif
         }
+        if (edge_grid_ptr == nullptr)
+            edge_grid_ptr = lower_layer_edge_grid->get();
     }
 
     // extrude all loops ccw
@@ -2332,9 +2403,6 @@ std::string GCode::extrude_loop(ExtrusionLoop loop, std::string description, dou
     if (m_config.spiral_vase) {
         loop.split_at(last_pos, false);
     } else {
-        const EdgeGrid::Grid* edge_grid_ptr = (lower_layer_edge_grid && *lower_layer_edge_grid)
-                                                ? lower_layer_edge_grid->get()
-                                                : nullptr;
         Point seam = m_seam_placer.get_seam(m_layer->id(), seam_position, loop,
                          last_pos, EXTRUDER_CONFIG(nozzle_diameter),
                          (m_layer == NULL ? nullptr : m_layer->object()),
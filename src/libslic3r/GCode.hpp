@@ -14,6 +14,7 @@
 #include "GCode/ToolOrdering.hpp"
 #include "GCode/WipeTower.hpp"
 #include "GCode/SeamPlacer.hpp"
+#include "GCode/IslandLocator.hpp"
 #include "GCode/GCodeProcessor.hpp"
 #include "EdgeGrid.hpp"
 #include "GCode/ThumbnailData.hpp"
@@ -48,9 +49,16 @@ public:
     AvoidCrossingPerimeters() : use_external_mp(false), use_external_mp_once(false), disable_once(true) {}
     ~AvoidCrossingPerimeters() {}
 
-    void reset() { m_external_mp.reset(); m_layer_mp.reset(); }
+    void reset() { m_external_mp.reset(); m_layer_mp.reset(); m_layer_mp_layer = nullptr; }
 	void init_external_mp(const Print &print);
-    void init_layer_mp(const ExPolygons &islands) { m_layer_mp = Slic3r::make_unique<MotionPlanner>(islands); }
+    // The islands of a layer are in the object coordinate system, therefore the motion planner and its lazily
+    // built graphs are reused for the other instances of the object and for the next extruders printing the same layer.
+    void init_layer_mp(const Layer &layer) {
+        if (m_layer_mp_layer != &layer) {
+            m_layer_mp = Slic3r::make_unique<MotionPlanner>(union_ex(layer.lslices, true));
+            m_layer_mp_layer = &layer;
+        }
+    }
 
     Polyline travel_to(const GCode &gcodegen, const Point &point);
 
@@ -60,6 +68,8 @@ private:
 
     std::unique_ptr<MotionPlanner> m_external_mp;
     std::unique_ptr<MotionPlanner> m_layer_mp;
+    // Layer m_layer_mp was created for.
+    const Layer                   *m_layer_mp_layer = nullptr;
 };
 
 
@@ -184,6 +194,7 @@ public:
     const FullPrintConfig &config() const { return m_config; }
     const Layer*    layer() const { return m_layer; }
     GCodeWriter&    writer() { return m_writer; }
+    const GCodeWriter& writer() const { return m_writer; }
     PlaceholderParser& placeholder_parser() { return m_placeholder_parser; }
     const PlaceholderParser& placeholder_parser() const { return m_placeholder_parser; }
     // Process a template through the placeholder parser, collect error messages to be reported
@@ -216,9 +227,28 @@ private:
 
     static std::vector<LayerToPrint>        		                   collect_layers_to_print(const PrintObject &object);
     static std::vector<std::pair<coordf_t, std::vector<LayerToPrint>>> collect_layers_to_print(const Print &print);
-    void            process_layer(
-        // Write into the output file.
-        FILE                            *file,
+    // Number of layers to print, for which prepare_layers() is called at once.
+    static constexpr size_t LayerBatchSize = 32;
+    // Prepare the purely geometric inputs of the seam placement and of the island assignment of the given layers in parallel.
+    void            prepare_layers(const std::vector<const Layer*> &layers);
+    // Island assignment prepared by prepare_layers(), nullptr if not prepared.
+    const LayerIslands* layer_islands(const Layer *layer) const;
+
+    // G-code of a single layer produced by process_layer(), not yet passed through the post-processors.
+    struct LayerResult {
+        std::string gcode;
+        size_t      layer_id = 0;
+        // Is spiral vase post-processing enabled for this layer?
+        bool        spiral_vase_enable = false;
+    };
+    // Number of layers in flight between the G-code generator and the output file.
+    static constexpr size_t LayerPipelineSize = 8;
+    // Generate the G-code of num_layers layers by calling layer_generator(layer_idx) in order, pass it through
+    // the spiral vase, cooling buffer and pressure equalizer post-processors and write it into the output file.
+    // The generator, the post-processors and the output are the ordered stages of a pipeline.
+    template<typename LayerGenerator>
+    void            process_layers(const Print &print, FILE *file, size_t num_layers, LayerGenerator &&layer_generator);
+    LayerResult     process_layer(
         const Print                     &print,
         // Set of object & print layers of the same PrintObject and with the same print_z.
         const std::vector<LayerToPrint> &layers,
@@ -314,6 +344,8 @@ private:
 
     // Cache for custom seam enforcers/blockers for each layer.
     SeamPlacer                          m_seam_placer;
+    // Island assignment of the extrusions of the layers of the current batch, sorted by layer.
+    std::vector<LayerIslands>           m_layer_islands;
 
     /* Origin of print coordinates expressed in unscaled G-code coordinates.
        This affects the input arguments supplied to the extrude*() and travel_to()
@@ -2,6 +2,8 @@
 #define slic3r_CoolingBuffer_hpp_
 
 #include "../libslic3r.h"
+#include "../Point.hpp"
+#include "../PrintConfig.hpp"
 #include <map>
 #include <string>
 
@@ -20,13 +22,20 @@ struct PerExtruderAdjustments;
 // For example, some materials may not like to print too slowly, while with some materials 
 // we may slow down significantly.
 //
+// The layers are processed by a stage of the G-code export pipeline, while GCode generates the following layers,
+// see GCode::process_layers(). Therefore the CoolingBuffer keeps its own copy of the configuration and of the extruder IDs
+// taken from GCode at construction, and it tracks the fan speed on its own instead of through the GCodeWriter of GCode.
+//
 class CoolingBuffer {
 public:
-    CoolingBuffer(GCode &gcodegen);
-    void        reset();
+    // Construct after the print configuration and the extruders are set to gcodegen.
+    CoolingBuffer(const GCode &gcodegen);
+    void        reset(const Vec3d &position);
     void        set_current_extruder(unsigned int extruder_id) { m_current_extruder = extruder_id; }
     std::string process_layer(const std::string &gcode, size_t layer_id);
-    GCode* 	    gcodegen() { return &m_gcodegen; }
+    // Fan control with the semantic of GCodeWriter::set_fan(). The fan is controlled by the CoolingBuffer
+    // while the layers are exported, thus the fan is to be turned off at the end of the print through this method.
+    std::string set_fan(unsigned int speed, bool dont_save = false);
 
 private:
 	CoolingBuffer& operator=(const CoolingBuffer&) = delete;
@@ -36,13 +45,21 @@ private:
     // Returns the adjusted G-code.
     std::string apply_layer_cooldown(const std::string &gcode, size_t layer_id, float layer_time, std::vector<PerExtruderAdjustments> &per_extruder_adjustments);
 
-    GCode&              m_gcodegen;
+    // Copies of the GCode state, not to be modified while the layers are exported.
+    FullPrintConfig             m_config;
+    std::string                 m_toolchange_prefix;
+    std::vector<unsigned int>   m_extruder_ids;
+    // Highest extruder ID + 1.
+    unsigned int                m_num_extruders = 0;
+
     std::string         m_gcode;
     // Internal data.
     // X,Y,Z,E,F
     std::vector<char>   m_axis;
     std::vector<float>  m_current_pos;
     unsigned int        m_current_extruder;
+    // Last fan speed set, see GCodeWriter::set_fan().
+    unsigned int        m_fan_speed = 0;
 
     // Old logic: proportional.
     bool                m_cooling_logic_proportional = false;
@@ -0,0 +1,115 @@
+#include "IslandLocator.hpp"
+
+#include "libslic3r/Layer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace Slic3r {
+
+IslandLocator::IslandLocator(const ExPolygons &islands, const std::vector<BoundingBox> &bboxes) :
+    m_islands(&islands), m_bboxes(&bboxes)
+{
+    assert(islands.size() == bboxes.size());
+    const size_t n_islands = islands.size();
+    if (n_islands == 0)
+        return;
+
+    // Traverse the islands in an increasing order of bounding box size, so that the islands inside another islands are tested first.
+    std::vector<size_t> test_order(n_islands);
+    std::iota(test_order.begin(), test_order.end(), 0);
+    std::stable_sort(test_order.begin(), test_order.end(), [&bboxes](size_t i, size_t j) {
+        const Vec2d s1 = bboxes[i].size().cast<double>();
+        const Vec2d s2 = bboxes[j].size().cast<double>();
+        return s1.x() * s1.y() < s2.x() * s2.y();
+    });
+
+    for (const BoundingBox &bbox : bboxes)
+        m_bbox.merge(bbox);
+
+    // Roughly a single cell per island, but at most n_islands + 1 cells along each axis.
+    const Vec2d  size      = m_bbox.size().cast<double>();
+    const double cell_size = std::max(std::sqrt(size.x() * size.y() / double(n_islands)), std::max(size.x(), size.y()) / double(n_islands));
+    m_cell_size = std::max<coord_t>(1, coord_t(std::ceil(cell_size)));
+    m_cols      = size_t(m_bbox.size().x() / m_cell_size) + 1;
+    m_rows      = size_t(m_bbox.size().y() / m_cell_size) + 1;
+
+    auto for_each_cell = [this](const BoundingBox &bbox, auto fn) {
+        const size_t col_min = size_t((bbox.min.x() - m_bbox.min.x()) / m_cell_size);
+        const size_t col_max = size_t((bbox.max.x() - m_bbox.min.x()) / m_cell_size);
+        const size_t row_min = size_t((bbox.min.y() - m_bbox.min.y()) / m_cell_size);
+        const size_t row_max = size_t((bbox.max.y() - m_bbox.min.y()) / m_cell_size);
+        for (size_t row = row_min; row <= row_max; ++ row)
+            for (size_t col = col_min; col <= col_max; ++ col)
+                fn(row * m_cols + col);
+    };
+
+    // Counting sort of the islands into the cells, keeping the test order inside each cell.
+    m_cell_begin.assign(m_cols * m_rows + 1, 0);
+    for (size_t island_idx : test_order)
+        if (bboxes[island_idx].defined)
+            for_each_cell(bboxes[island_idx], [this](size_t cell) { ++ m_cell_begin[cell + 1]; });
+    for (size_t cell = 1; cell < m_cell_begin.size(); ++ cell)
+        m_cell_begin[cell] += m_cell_begin[cell - 1];
+    m_cell_islands.assign(m_cell_begin.back(), 0);
+    std::vector<size_t> cell_end(m_cell_begin.begin(), m_cell_begin.end() - 1);
+    for (size_t island_idx : test_order)
+        if (bboxes[island_idx].defined)
+            for_each_cell(bboxes[island_idx], [this, island_idx, &cell_end](size_t cell) { m_cell_islands[cell_end[cell] ++] = island_idx; });
+}
+
+size_t IslandLocator::locate(const Point &pt) const
+{
+    if (m_islands == nullptr || m_cell_islands.empty())
+        return m_islands == nullptr ? 0 : m_islands->size();
+    const size_t n_islands = m_islands->size();
+    if (pt.x() < m_bbox.min.x() || pt.x() > m_bbox.max.x() || pt.y() < m_bbox.min.y() || pt.y() > m_bbox.max.y())
+        return n_islands;
+    const size_t cell = size_t((pt.y() - m_bbox.min.y()) / m_cell_size) * m_cols + size_t((pt.x() - m_bbox.min.x()) / m_cell_size);
+    for (size_t i = m_cell_begin[cell]; i < m_cell_begin[cell + 1]; ++ i) {
+        const size_t       island_idx = m_cell_islands[i];
+        const BoundingBox &bbox       = (*m_bboxes)[island_idx];
+        if (pt.x() >= bbox.min.x() && pt.x() < bbox.max.x() &&
+            pt.y() >= bbox.min.y() && pt.y() < bbox.max.y() &&
+            (*m_islands)[island_idx].contour.contains(pt))
+            return island_idx;
+    }
+    return n_islands;
+}
+
+LayerIslands assign_extrusions_to_islands(const Layer &layer)
+{
+    LayerIslands out;
+    out.layer = &layer;
+    out.region_begin.reserve(2 * layer.regions().size());
+    size_t num_entities = 0;
+    for (const LayerRegion *layerm : layer.regions()) {
+        out.region_begin.emplace_back(num_entities);
+        num_entities += layerm ? layerm->fills.entities.size() : 0;
+        out.region_begin.emplace_back(num_entities);
+        num_entities += layerm ? layerm->perimeters.entities.size() : 0;
+    }
+    out.islands.assign(num_entities, layer.lslices.size());
+    if (num_entities == 0 || layer.lslices.empty())
+        return out;
+
+    IslandLocator locator(layer.lslices, layer.lslices_bboxes);
+    auto assign = [&locator, &out](const ExtrusionEntitiesPtr &entities, size_t begin) {
+        for (size_t i = 0; i < entities.size(); ++ i) {
+            assert(dynamic_cast<const ExtrusionEntityCollection*>(entities[i]) != nullptr);
+            const auto *extrusions = static_cast<const ExtrusionEntityCollection*>(entities[i]);
+            // first_point() would fail on an empty collection.
+            if (! extrusions->entities.empty())
+                out.islands[begin + i] = locator.locate(extrusions->first_point());
+        }
+    };
+    for (size_t region_id = 0; region_id < layer.regions().size(); ++ region_id)
+        if (const LayerRegion *layerm = layer.regions()[region_id]; layerm != nullptr) {
+            assign(layerm->fills.entities,      out.region_begin[2 * region_id]);
+            assign(layerm->perimeters.entities, out.region_begin[2 * region_id + 1]);
+        }
+    return out;
+}
+
+} // namespace Slic3r
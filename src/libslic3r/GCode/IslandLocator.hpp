@@ -0,0 +1,57 @@
+#ifndef slic3r_IslandLocator_hpp_
+#define slic3r_IslandLocator_hpp_
+
+#include <vector>
+
+#include "libslic3r/ExPolygon.hpp"
+#include "libslic3r/BoundingBox.hpp"
+
+namespace Slic3r {
+
+class Layer;
+
+// Finds the island (Layer::lslices) containing a point the same way GCode::process_layer() used to:
+// The islands are tested in an increasing order of their bounding box area, so that the islands inside
+// holes of another islands are tested first, and only their contours are tested, not their holes.
+// The islands are bucketed into a regular grid by their bounding boxes, so that only the few islands
+// overlapping the cell of the point are tested.
+class IslandLocator
+{
+public:
+    IslandLocator() = default;
+    IslandLocator(const ExPolygons &islands, const std::vector<BoundingBox> &bboxes);
+
+    // Index of the first island in the test order containing the point, islands.size() if none.
+    size_t locate(const Point &pt) const;
+
+private:
+    const ExPolygons                *m_islands = nullptr;
+    const std::vector<BoundingBox>  *m_bboxes  = nullptr;
+    BoundingBox                      m_bbox;
+    coord_t                          m_cell_size = 1;
+    size_t                           m_cols = 0;
+    size_t                           m_rows = 0;
+    // Islands overlapping each cell are stored in m_cell_islands[m_cell_begin[cell] .. m_cell_begin[cell + 1]),
+    // sorted by the test order.
+    std::vector<size_t>              m_cell_begin;
+    std::vector<size_t>              m_cell_islands;
+};
+
+// Island containing the first point of each fill and perimeter collection of a layer.
+struct LayerIslands
+{
+    const Layer         *layer = nullptr;
+    // Index of the first fill and of the first perimeter collection of each region into islands.
+    std::vector<size_t>  region_begin;
+    // Index into layer->lslices, layer->lslices.size() if the collection does not fit any island.
+    std::vector<size_t>  islands;
+
+    size_t island(size_t region_id, bool perimeters, size_t entity_idx) const
+        { return islands[region_begin[2 * region_id + (perimeters ? 1 : 0)] + entity_idx]; }
+};
+
+LayerIslands assign_extrusions_to_islands(const Layer &layer);
+
+} // namespace Slic3r
+
+#endif // slic3r_IslandLocator_hpp_
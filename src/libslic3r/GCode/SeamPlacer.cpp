@@ -6,6 +6,9 @@
 #include "libslic3r/EdgeGrid.hpp"
 #include "libslic3r/ClipperUtils.hpp"
 #include "libslic3r/SVG.hpp"
+#include "libslic3r/Layer.hpp"
+
+#include <tbb/parallel_for.h>
 
 namespace Slic3r {
 
@@ -204,6 +207,49 @@ void SeamPlacer::init(const Print& print)
        explgs = Slic3r::offset_ex(explgs, scale_(max_nozzle_dmr));
    for (ExPolygons& explgs : m_blockers)
        explgs = Slic3r::offset_ex(explgs, scale_(max_nozzle_dmr));
+   m_lower_layer_edge_grids.clear();
+}
+
+
+
+std::unique_ptr<EdgeGrid::Grid> SeamPlacer::create_lower_layer_edge_grid(const Layer &layer)
+{
+    assert(layer.lower_layer != nullptr);
+    const coord_t distance_field_resolution = coord_t(scale_(1.) + 0.5);
+    auto grid = std::make_unique<EdgeGrid::Grid>();
+    grid->create(layer.lower_layer->lslices, distance_field_resolution);
+    grid->calculate_sdf();
+    return grid;
+}
+
+
+
+void SeamPlacer::prepare_lower_layer_edge_grids(const std::vector<const Layer*> &layers)
+{
+    m_lower_layer_edge_grids.clear();
+    for (const Layer *layer : layers)
+        if (layer != nullptr && layer->lower_layer != nullptr &&
+            // Only the perimeters query the distance field.
+            std::any_of(layer->regions().begin(), layer->regions().end(), [](const LayerRegion *layerm) { return ! layerm->perimeters.entities.empty(); }))
+            m_lower_layer_edge_grids.emplace_back(layer, nullptr);
+    std::sort(m_lower_layer_edge_grids.begin(), m_lower_layer_edge_grids.end(),
+        [](const auto &l, const auto &r) { return l.first < r.first; });
+    m_lower_layer_edge_grids.erase(std::unique(m_lower_layer_edge_grids.begin(), m_lower_layer_edge_grids.end(),
+        [](const auto &l, const auto &r) { return l.first == r.first; }), m_lower_layer_edge_grids.end());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, m_lower_layer_edge_grids.size()),
+        [this](const tbb::blocked_range<size_t> &range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i)
+                m_lower_layer_edge_grids[i].second = create_lower_layer_edge_grid(*m_lower_layer_edge_grids[i].first);
+        });
+}
+
+
+
+const EdgeGrid::Grid* SeamPlacer::lower_layer_edge_grid(const Layer *layer) const
+{
+    auto it = std::lower_bound(m_lower_layer_edge_grids.begin(), m_lower_layer_edge_grids.end(), layer,
+        [](const auto &l, const Layer *layer) { return l.first < layer; });
+    return (it != m_lower_layer_edge_grids.end() && it->first == layer) ? it->second.get() : nullptr;
 }
 
 
@@ -297,17 +343,15 @@ Point SeamPlacer::get_seam(const size_t layer_idx, const SeamPosition seam_posit
             // Use the edge grid distance field structure over the lower layer to calculate overhangs.
             coord_t nozzle_r = coord_t(std::floor(scale_(0.5 * nozzle_dmr) + 0.5));
             coord_t search_r = coord_t(std::floor(scale_(0.8 * nozzle_dmr) + 0.5));
+            // Signed distance is positive outside the object, negative inside the object.
+            // The point is considered at an overhang, if it is more than nozzle radius
+            // outside of the lower layer contour.
+            std::vector<coordf_t> dists = lower_layer_edge_grid->signed_distances(polygon.points, search_r);
             for (size_t i = 0; i < polygon.points.size(); ++ i) {
-                const Point &p = polygon.points[i];
-                coordf_t dist;
-                // Signed distance is positive outside the object, negative inside the object.
-                // The point is considered at an overhang, if it is more than nozzle radius
-                // outside of the lower layer contour.
-                [[maybe_unused]] bool found = lower_layer_edge_grid->signed_distance(p, search_r, dist);
                 // If the approximate Signed Distance Field was initialized over lower_layer_edge_grid,
                 // then the signed distnace shall always be known.
-                assert(found);
-                penalties[i] += extrudate_overlap_penalty(float(nozzle_r), penaltyOverhangHalf, float(dist));
+                assert(! std::isnan(dists[i]));
+                penalties[i] += extrudate_overlap_penalty(float(nozzle_r), penaltyOverhangHalf, float(dists[i]));
             }
         }
 
@@ -1,6 +1,7 @@
 #ifndef libslic3r_SeamPlacer_hpp_
 #define libslic3r_SeamPlacer_hpp_
 
+#include <memory>
 #include <optional>
 
 #include "libslic3r/ExPolygon.hpp"
@@ -12,6 +13,7 @@ namespace Slic3r {
 class PrintObject;
 class ExtrusionLoop;
 class Print;
+class Layer;
 namespace EdgeGrid { class Grid; }
 
 
@@ -44,10 +46,21 @@ public:
                    coordf_t nozzle_diameter, const PrintObject* po,
                    bool was_clockwise, const EdgeGrid::Grid* lower_layer_edge_grid);
 
+    // Distance field of the layer below the given layer, used to penalize seams at overhangs.
+    static std::unique_ptr<EdgeGrid::Grid> create_lower_layer_edge_grid(const Layer &layer);
+    // Create the distance fields below the given layers in parallel ahead of the G-code export,
+    // releasing the distance fields prepared by the previous call.
+    void prepare_lower_layer_edge_grids(const std::vector<const Layer*> &layers);
+    // Distance field prepared for the given layer, nullptr if it was not prepared.
+    const EdgeGrid::Grid* lower_layer_edge_grid(const Layer *layer) const;
+
 private:
     std::vector<ExPolygons> m_enforcers;
     std::vector<ExPolygons> m_blockers;
 
+    // Sorted by the layer, which the distance field of its lower layer belongs to.
+    std::vector<std::pair<const Layer*, std::unique_ptr<EdgeGrid::Grid>>> m_lower_layer_edge_grids;
+
     //std::map<const PrintObject*, Point>  m_last_seam_position;
     SeamHistory  m_seam_history;
 
@@ -14,6 +14,12 @@
 #include <cassert>
 #include <limits>
 
+#include <boost/log/trivial.hpp>
+
+#include <tbb/parallel_for.h>
+
+#include <Shiny/Shiny.h>
+
 #include <libslic3r.h>
 
 
@@ -74,6 +80,8 @@ unsigned int LayerTools::extruder(const ExtrusionEntityCollection &extrusions, c
 // (print.config().complete_objects is true).
 ToolOrdering::ToolOrdering(const PrintObject &object, unsigned int first_extruder, bool prime_multi_material)
 {
+    PROFILE_FUNC();
+
     if (object.layers().empty())
         return;
 
@@ -103,6 +111,8 @@ ToolOrdering::ToolOrdering(const PrintObject &object, unsigned int first_extrude
 // (print.config().complete_objects is false).
 ToolOrdering::ToolOrdering(const Print &print, unsigned int first_extruder, bool prime_multi_material)
 {
+    PROFILE_FUNC();
+
     m_print_config_ptr = &print.config();
 
     // Initialize the print layers for all objects and all layers.
@@ -141,8 +151,10 @@ ToolOrdering::ToolOrdering(const Print &print, unsigned int first_extruder, bool
 	}
 
     // Collect extruders reuqired to print the layers.
+    BOOST_LOG_TRIVIAL(debug) << "Collecting extruders of object layers in parallel - start";
     for (auto object : print.objects())
         this->collect_extruders(*object, per_layer_extruder_switches);
+    BOOST_LOG_TRIVIAL(debug) << "Collecting extruders of object layers in parallel - end";
 
     // Reorder the extruders to minimize tool switches.
     this->reorder_extruders(first_extruder);
@@ -186,84 +198,99 @@ void ToolOrdering::collect_extruders(const PrintObject &object, const std::vecto
             layer_tools.has_support = true;
     }
 
-    // Extruder overrides are ordered by print_z.
-    std::vector<std::pair<double, unsigned int>>::const_iterator it_per_layer_extruder_override;
-	it_per_layer_extruder_override = per_layer_extruder_switches.begin();
-    unsigned int extruder_override = 0;
+    // Object layers sharing a single LayerTools are consecutive, as both are sorted by print_z.
+    // Split the object layers into spans of layers sharing a LayerTools, so that each LayerTools is modified by a single thread.
+    std::vector<size_t> layer_spans;
+    for (size_t i = 0; i < object.layers().size(); ++ i)
+        if (i == 0 || &this->tools_for_layer(object.layers()[i]->print_z) != &this->tools_for_layer(object.layers()[i - 1]->print_z))
+            layer_spans.emplace_back(i);
+    layer_spans.emplace_back(object.layers().size());
 
     // Collect the object extruders.
-    for (auto layer : object.layers()) {
-        LayerTools &layer_tools = this->tools_for_layer(layer->print_z);
-
-        // Override extruder with the next 
-    	for (; it_per_layer_extruder_override != per_layer_extruder_switches.end() && it_per_layer_extruder_override->first < layer->print_z + EPSILON; ++ it_per_layer_extruder_override)
-    		extruder_override = (int)it_per_layer_extruder_override->second;
-
-        // Store the current extruder override (set to zero if no overriden), so that layer_tools.wiping_extrusions().is_overridable_and_mark() will use it.
-        layer_tools.extruder_override = extruder_override;
-
-        // What extruders are required to print this object layer?
-        for (size_t region_id = 0; region_id < object.region_volumes.size(); ++ region_id) {
-            const LayerRegion *layerm = (region_id < layer->regions().size()) ? layer->regions()[region_id] : nullptr;
-            if (layerm == nullptr)
-                continue;
-            const PrintRegion &region = *object.print()->regions()[region_id];
-
-            if (! layerm->perimeters.entities.empty()) {
-                bool something_nonoverriddable = true;
-
-                if (m_print_config_ptr) { // in this case complete_objects is false (see ToolOrdering constructors)
-                    something_nonoverriddable = false;
-                    for (const auto& eec : layerm->perimeters.entities) // let's check if there are nonoverriddable entities
-                        if (!layer_tools.wiping_extrusions().is_overriddable_and_mark(dynamic_cast<const ExtrusionEntityCollection&>(*eec), *m_print_config_ptr, object, region))
-                            something_nonoverriddable = true;
-                }
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, layer_spans.size() - 1),
+        [this, &object, &per_layer_extruder_switches, &layer_spans](const tbb::blocked_range<size_t>& range) {
+            for (size_t span_idx = range.begin(); span_idx < range.end(); ++ span_idx)
+                for (size_t layer_idx = layer_spans[span_idx]; layer_idx < layer_spans[span_idx + 1]; ++ layer_idx)
+                    this->collect_extruders(object, *object.layers()[layer_idx], per_layer_extruder_switches);
+        });
 
-                if (something_nonoverriddable)
-               		layer_tools.extruders.emplace_back((extruder_override == 0) ? region.config().perimeter_extruder.value : extruder_override);
+    for (auto& layer : m_layer_tools) {
+        // Sort and remove duplicates
+        sort_remove_duplicates(layer.extruders);
 
-                layer_tools.has_object = true;
-            }
+        // make sure that there are some tools for each object layer (e.g. tall wiping object will result in empty extruders vector)
+        if (layer.extruders.empty() && layer.has_object)
+            layer.extruders.emplace_back(0); // 0="dontcare" extruder - it will be taken care of in reorder_extruders
+    }
+}
+
+// Collect extruders reuqired to print a single object layer.
+void ToolOrdering::collect_extruders(const PrintObject &object, const Layer &layer, const std::vector<std::pair<double, unsigned int>> &per_layer_extruder_switches)
+{
+    LayerTools &layer_tools = this->tools_for_layer(layer.print_z);
+
+    // Extruder overrides are ordered by print_z. Override extruder with the last switch below this layer.
+    auto it_per_layer_extruder_override = std::lower_bound(per_layer_extruder_switches.begin(), per_layer_extruder_switches.end(), layer.print_z + EPSILON,
+        [](const std::pair<double, unsigned int> &extruder_switch, double print_z) { return extruder_switch.first < print_z; });
+    unsigned int extruder_override = it_per_layer_extruder_override == per_layer_extruder_switches.begin() ? 0 :
+        (unsigned int)std::prev(it_per_layer_extruder_override)->second;
 
-            bool has_infill       = false;
-            bool has_solid_infill = false;
-            bool something_nonoverriddable = false;
-            for (const ExtrusionEntity *ee : layerm->fills.entities) {
-                // fill represents infill extrusions of a single island.
-                const auto *fill = dynamic_cast<const ExtrusionEntityCollection*>(ee);
-                ExtrusionRole role = fill->entities.empty() ? erNone : fill->entities.front()->role();
-                if (is_solid_infill(role))
-                    has_solid_infill = true;
-                else if (role != erNone)
-                    has_infill = true;
-
-                if (m_print_config_ptr) {
-                    if (! layer_tools.wiping_extrusions().is_overriddable_and_mark(*fill, *m_print_config_ptr, object, region))
+    // Store the current extruder override (set to zero if no overriden), so that layer_tools.wiping_extrusions().is_overridable_and_mark() will use it.
+    layer_tools.extruder_override = extruder_override;
+
+    // What extruders are required to print this object layer?
+    for (size_t region_id = 0; region_id < object.region_volumes.size(); ++ region_id) {
+        const LayerRegion *layerm = (region_id < layer.regions().size()) ? layer.regions()[region_id] : nullptr;
+        if (layerm == nullptr)
+            continue;
+        const PrintRegion &region = *object.print()->regions()[region_id];
+
+        if (! layerm->perimeters.entities.empty()) {
+            bool something_nonoverriddable = true;
+
+            if (m_print_config_ptr) { // in this case complete_objects is false (see ToolOrdering constructors)
+                something_nonoverriddable = false;
+                for (const auto& eec : layerm->perimeters.entities) // let's check if there are nonoverriddable entities
+                    if (!layer_tools.wiping_extrusions().is_overriddable_and_mark(dynamic_cast<const ExtrusionEntityCollection&>(*eec), *m_print_config_ptr, object, region))
                         something_nonoverriddable = true;
-                }
             }
 
-            if (something_nonoverriddable || !m_print_config_ptr) {
-            	if (extruder_override == 0) {
+            if (something_nonoverriddable)
+           		layer_tools.extruders.emplace_back((extruder_override == 0) ? region.config().perimeter_extruder.value : extruder_override);
+
+            layer_tools.has_object = true;
+        }
+
+        bool has_infill       = false;
+        bool has_solid_infill = false;
+        bool something_nonoverriddable = false;
+        for (const ExtrusionEntity *ee : layerm->fills.entities) {
+            // fill represents infill extrusions of a single island.
+            const auto *fill = dynamic_cast<const ExtrusionEntityCollection*>(ee);
+            ExtrusionRole role = fill->entities.empty() ? erNone : fill->entities.front()->role();
+            if (is_solid_infill(role))
+                has_solid_infill = true;
+            else if (role != erNone)
+                has_infill = true;
+
+            if (m_print_config_ptr) {
+                if (! layer_tools.wiping_extrusions().is_overriddable_and_mark(*fill, *m_print_config_ptr, object, region))
+                    something_nonoverriddable = true;
+            }
+        }
+
+        if (something_nonoverriddable || !m_print_config_ptr) {
+        	if (extruder_override == 0) {
 	                if (has_solid_infill)
 	                    layer_tools.extruders.emplace_back(region.config().solid_infill_extruder);
 	                if (has_infill)
 	                    layer_tools.extruders.emplace_back(region.config().infill_extruder);
-            	} else if (has_solid_infill || has_infill)
-            		layer_tools.extruders.emplace_back(extruder_override);
-            }
-            if (has_solid_infill || has_infill)
-                layer_tools.has_object = true;
+        	} else if (has_solid_infill || has_infill)
+        		layer_tools.extruders.emplace_back(extruder_override);
         }
-    }
-
-    for (auto& layer : m_layer_tools) {
-        // Sort and remove duplicates
-        sort_remove_duplicates(layer.extruders);
-
-        // make sure that there are some tools for each object layer (e.g. tall wiping object will result in empty extruders vector)
-        if (layer.extruders.empty() && layer.has_object)
-            layer.extruders.emplace_back(0); // 0="dontcare" extruder - it will be taken care of in reorder_extruders
+        if (has_solid_infill || has_infill)
+            layer_tools.has_object = true;
     }
 }
 
@@ -538,12 +565,15 @@ const LayerTools& ToolOrdering::tools_for_layer(coordf_t print_z) const
 }
 
 // This function is called from Print::mark_wiping_extrusions and sets extruder this entity should be printed with (-1 .. as usual)
-void WipingExtrusions::set_extruder_override(const ExtrusionEntity* entity, size_t copy_id, int extruder, size_t num_of_copies)
+void WipingExtrusions::set_extruder_override(const Print& print, const LayerRegion &layerm, bool perimeters, size_t entity_idx, size_t copy_id, int extruder, size_t num_of_copies)
 {
     something_overridden = true;
 
-    auto entity_map_it = (entity_map.emplace(entity, ExtruderPerCopy())).first; // (add and) return iterator
-    ExtruderPerCopy& copies_vector = entity_map_it->second;
+    if (! m_entity_index_valid)
+        this->init_entity_index(print);
+    ExtruderPerCopy *overrides = this->entity_overrides(layerm, perimeters, entity_idx);
+    assert(overrides != nullptr);
+    ExtruderPerCopy& copies_vector = *overrides;
     copies_vector.resize(num_of_copies, -1);
 
     if (copies_vector[copy_id] != -1)
@@ -552,6 +582,34 @@ void WipingExtrusions::set_extruder_override(const ExtrusionEntity* entity, size
     copies_vector[copy_id] = extruder;
 }
 
+void WipingExtrusions::init_entity_index(const Print& print)
+{
+    const LayerTools& lt = *m_layer_tools;
+    m_entity_index.clear();
+    size_t num_entities = 0;
+    for (const PrintObject* object : print.objects())
+        if (const Layer* this_layer = object->get_layer_at_printz(lt.print_z, EPSILON); this_layer != nullptr)
+            for (const LayerRegion *layerm : this_layer->regions())
+                if (layerm != nullptr) {
+                    m_entity_index.push_back({ layerm, num_entities, num_entities + layerm->fills.entities.size() });
+                    num_entities += layerm->fills.entities.size() + layerm->perimeters.entities.size();
+                }
+    std::sort(m_entity_index.begin(), m_entity_index.end(), [](const LayerRegionEntities &l, const LayerRegionEntities &r) { return l.layerm < r.layerm; });
+    // Allocated at once, as GCode::process_layer() keeps pointers to the overrides.
+    m_entity_overrides.assign(num_entities, ExtruderPerCopy());
+    m_entity_index_valid = true;
+}
+
+const WipingExtrusions::ExtruderPerCopy* WipingExtrusions::entity_overrides(const LayerRegion &layerm, bool perimeters, size_t entity_idx) const
+{
+    auto it = std::lower_bound(m_entity_index.begin(), m_entity_index.end(), &layerm,
+        [](const LayerRegionEntities &l, const LayerRegion *layerm) { return l.layerm < layerm; });
+    if (it == m_entity_index.end() || it->layerm != &layerm)
+        return nullptr;
+    assert(entity_idx < (perimeters ? layerm.perimeters.entities.size() : layerm.fills.entities.size()));
+    return &m_entity_overrides[(perimeters ? it->perimeters_begin : it->fills_begin) + entity_idx];
+}
+
 // Finds first non-soluble extruder on the layer
 int WipingExtrusions::first_nonsoluble_extruder_on_layer(const PrintConfig& print_config) const
 {
@@ -635,9 +693,10 @@ float WipingExtrusions::mark_wiping_extrusions(const Print& print, unsigned int
                     continue;
 
                 bool wipe_into_infill_only = ! object->config().wipe_into_objects && region.config().wipe_into_infill;
+                const LayerRegion &layerm = *this_layer->regions()[region_id];
                 if (print.config().infill_first != perimeters_done || wipe_into_infill_only) {
-                    for (const ExtrusionEntity* ee : this_layer->regions()[region_id]->fills.entities) {                      // iterate through all infill Collections
-                        auto* fill = dynamic_cast<const ExtrusionEntityCollection*>(ee);
+                    for (size_t fill_idx = 0; fill_idx < layerm.fills.entities.size(); ++ fill_idx) {                      // iterate through all infill Collections
+                        auto* fill = dynamic_cast<const ExtrusionEntityCollection*>(layerm.fills.entities[fill_idx]);
 
                         if (!is_overriddable(*fill, print.config(), *object, region))
                             continue;
@@ -648,8 +707,8 @@ float WipingExtrusions::mark_wiping_extrusions(const Print& print, unsigned int
                             if (!lt.is_extruder_order(lt.perimeter_extruder(region), new_extruder))
                                 continue;
 
-                        if ((!is_entity_overridden(fill, copy) && fill->total_volume() > min_infill_volume)) {     // this infill will be used to wipe this extruder
-                            set_extruder_override(fill, copy, new_extruder, num_of_copies);
+                        if ((!is_entity_overridden(layerm, false, fill_idx, copy) && fill->total_volume() > min_infill_volume)) {     // this infill will be used to wipe this extruder
+                            set_extruder_override(print, layerm, false, fill_idx, copy, new_extruder, num_of_copies);
                             if ((volume_to_wipe -= float(fill->total_volume())) <= 0.f)
                             	// More material was purged already than asked for.
 	                            return 0.f;
@@ -660,10 +719,10 @@ float WipingExtrusions::mark_wiping_extrusions(const Print& print, unsigned int
                 // Now the same for perimeters - see comments above for explanation:
                 if (object->config().wipe_into_objects && print.config().infill_first == perimeters_done)
                 {
-                    for (const ExtrusionEntity* ee : this_layer->regions()[region_id]->perimeters.entities) {
-                        auto* fill = dynamic_cast<const ExtrusionEntityCollection*>(ee);
-                        if (is_overriddable(*fill, print.config(), *object, region) && !is_entity_overridden(fill, copy) && fill->total_volume() > min_infill_volume) {
-                            set_extruder_override(fill, copy, new_extruder, num_of_copies);
+                    for (size_t perimeter_idx = 0; perimeter_idx < layerm.perimeters.entities.size(); ++ perimeter_idx) {
+                        auto* fill = dynamic_cast<const ExtrusionEntityCollection*>(layerm.perimeters.entities[perimeter_idx]);
+                        if (is_overriddable(*fill, print.config(), *object, region) && !is_entity_overridden(layerm, true, perimeter_idx, copy) && fill->total_volume() > min_infill_volume) {
+                            set_extruder_override(print, layerm, true, perimeter_idx, copy, new_extruder, num_of_copies);
                             if ((volume_to_wipe -= float(fill->total_volume())) <= 0.f)
                             	// More material was purged already than asked for.
 	                            return 0.f;
@@ -707,11 +766,12 @@ void WipingExtrusions::ensure_perimeters_infills_order(const Print& print)
                 if (!region.config().wipe_into_infill && !object->config().wipe_into_objects)
                     continue;
 
-                for (const ExtrusionEntity* ee : this_layer->regions()[region_id]->fills.entities) {                      // iterate through all infill Collections
-                    auto* fill = dynamic_cast<const ExtrusionEntityCollection*>(ee);
+                const LayerRegion &layerm = *this_layer->regions()[region_id];
+                for (size_t fill_idx = 0; fill_idx < layerm.fills.entities.size(); ++ fill_idx) {                      // iterate through all infill Collections
+                    auto* fill = dynamic_cast<const ExtrusionEntityCollection*>(layerm.fills.entities[fill_idx]);
 
                     if (!is_overriddable(*fill, print.config(), *object, region)
-                     || is_entity_overridden(fill, copy) )
+                     || is_entity_overridden(layerm, false, fill_idx, copy) )
                         continue;
 
                     // This infill could have been overridden but was not - unless we do something, it could be
@@ -722,7 +782,7 @@ void WipingExtrusions::ensure_perimeters_infills_order(const Print& print)
                     || object->config().wipe_into_objects  // in this case the perimeter is overridden, so we can override by the last one safely
                     || lt.is_extruder_order(lt.perimeter_extruder(region), last_nonsoluble_extruder    // !infill_first, but perimeter is already printed when last extruder prints
                     || ! lt.has_extruder(lt.infill_extruder(region)))) // we have to force override - this could violate infill_first (FIXME)
-                        set_extruder_override(fill, copy, (print.config().infill_first ? first_nonsoluble_extruder : last_nonsoluble_extruder), num_of_copies);
+                        set_extruder_override(print, layerm, false, fill_idx, copy, (print.config().infill_first ? first_nonsoluble_extruder : last_nonsoluble_extruder), num_of_copies);
                     else {
                         // In this case we can (and should) leave it to be printed normally.
                         // Force overriding would mean it gets printed before its perimeter.
@@ -730,10 +790,10 @@ void WipingExtrusions::ensure_perimeters_infills_order(const Print& print)
                 }
 
                 // Now the same for perimeters - see comments above for explanation:
-                for (const ExtrusionEntity* ee : this_layer->regions()[region_id]->perimeters.entities) {                      // iterate through all perimeter Collections
-                    auto* fill = dynamic_cast<const ExtrusionEntityCollection*>(ee);
-                    if (is_overriddable(*fill, print.config(), *object, region) && ! is_entity_overridden(fill, copy))
-                        set_extruder_override(fill, copy, (print.config().infill_first ? last_nonsoluble_extruder : first_nonsoluble_extruder), num_of_copies);
+                for (size_t perimeter_idx = 0; perimeter_idx < layerm.perimeters.entities.size(); ++ perimeter_idx) {                      // iterate through all perimeter Collections
+                    auto* fill = dynamic_cast<const ExtrusionEntityCollection*>(layerm.perimeters.entities[perimeter_idx]);
+                    if (is_overriddable(*fill, print.config(), *object, region) && ! is_entity_overridden(layerm, true, perimeter_idx, copy))
+                        set_extruder_override(print, layerm, true, perimeter_idx, copy, (print.config().infill_first ? last_nonsoluble_extruder : first_nonsoluble_extruder), num_of_copies);
                 }
             }
         }
@@ -746,12 +806,13 @@ void WipingExtrusions::ensure_perimeters_infills_order(const Print& print)
 // so -1 was used as "print as usual").
 // The resulting vector therefore keeps track of which extrusions are the ones that were overridden and which were not. If the extruder used is overridden,
 // its number is saved as is (zero-based index). Regular extrusions are saved as -number-1 (unfortunately there is no negative zero).
-const WipingExtrusions::ExtruderPerCopy* WipingExtrusions::get_extruder_overrides(const ExtrusionEntity* entity, int correct_extruder_id, size_t num_of_copies)
+const WipingExtrusions::ExtruderPerCopy* WipingExtrusions::get_extruder_overrides(const LayerRegion &layerm, bool perimeters, size_t entity_idx, int correct_extruder_id, size_t num_of_copies)
 {
-	ExtruderPerCopy *overrides = nullptr;
-    auto entity_map_it = entity_map.find(entity);
-    if (entity_map_it != entity_map.end()) {
-        overrides = &entity_map_it->second;
+	ExtruderPerCopy *overrides = this->entity_overrides(layerm, perimeters, entity_idx);
+    if (overrides != nullptr && overrides->empty())
+        // Numbered, but not overridden.
+        overrides = nullptr;
+    if (overrides != nullptr) {
     	overrides->resize(num_of_copies, -1);
 	    // Each -1 now means "print as usual" - we will replace it with actual extruder id (shifted it so we don't lose that information):
 	    std::replace(overrides->begin(), overrides->end(), -1, -correct_extruder_id-1);
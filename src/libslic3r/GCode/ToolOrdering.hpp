@@ -13,7 +13,9 @@ namespace Slic3r {
 
 class Print;
 class PrintObject;
+class Layer;
 class LayerTools;
+class LayerRegion;
 namespace CustomGCode { struct Item; }
 class PrintRegion;
 
@@ -32,8 +34,9 @@ public:
     // When allocating extruder overrides of an object's ExtrusionEntity, overrides for maximum 3 copies are allocated in place.
     typedef boost::container::small_vector<int32_t, 3> ExtruderPerCopy;
 
-    // This is called from GCode::process_layer - see implementation for further comments:
-    const ExtruderPerCopy* get_extruder_overrides(const ExtrusionEntity* entity, int correct_extruder_id, size_t num_of_copies);
+    // This is called from GCode::process_layer - see implementation for further comments.
+    // The entity is identified by its layer region and its index in layerm.fills resp. layerm.perimeters:
+    const ExtruderPerCopy* get_extruder_overrides(const LayerRegion &layerm, bool perimeters, size_t entity_idx, int correct_extruder_id, size_t num_of_copies);
 
     // This function goes through all infill entities, decides which ones will be used for wiping and
     // marks them by the extruder id. Returns volume that remains to be wiped on the wipe tower:
@@ -55,15 +58,33 @@ private:
     int last_nonsoluble_extruder_on_layer(const PrintConfig& print_config) const;
 
     // This function is called from mark_wiping_extrusions and sets extruder that it should be printed with (-1 .. as usual)
-    void set_extruder_override(const ExtrusionEntity* entity, size_t copy_id, int extruder, size_t num_of_copies);
+    void set_extruder_override(const Print& print, const LayerRegion &layerm, bool perimeters, size_t entity_idx, size_t copy_id, int extruder, size_t num_of_copies);
 
     // Returns true in case that entity is not printed with its usual extruder for a given copy:
-    bool is_entity_overridden(const ExtrusionEntity* entity, size_t copy_id) const {
-        auto it = entity_map.find(entity);
-        return it == entity_map.end() ? false : it->second[copy_id] != -1;
+    bool is_entity_overridden(const LayerRegion &layerm, bool perimeters, size_t entity_idx, size_t copy_id) const {
+        const ExtruderPerCopy *overrides = this->entity_overrides(layerm, perimeters, entity_idx);
+        return overrides != nullptr && ! overrides->empty() && (*overrides)[copy_id] != -1;
     }
 
-    std::map<const ExtrusionEntity*, ExtruderPerCopy> entity_map;  // to keep track of who prints what
+    // Number the fill and perimeter collections of all layer regions printed on this layer, so that their overrides
+    // are stored in a flat table. Done once the first override is set.
+    void init_entity_index(const Print& print);
+    // Overrides of an entity, empty if not overridden, nullptr if the entity was not numbered.
+    const ExtruderPerCopy* entity_overrides(const LayerRegion &layerm, bool perimeters, size_t entity_idx) const;
+    ExtruderPerCopy*       entity_overrides(const LayerRegion &layerm, bool perimeters, size_t entity_idx)
+        { return const_cast<ExtruderPerCopy*>(static_cast<const WipingExtrusions*>(this)->entity_overrides(layerm, perimeters, entity_idx)); }
+
+    struct LayerRegionEntities {
+        const LayerRegion *layerm;
+        // Index of the overrides of the first fill resp. perimeter collection of layerm in m_entity_overrides.
+        size_t             fills_begin;
+        size_t             perimeters_begin;
+    };
+    // Sorted by layerm.
+    std::vector<LayerRegionEntities> m_entity_index;
+    bool                             m_entity_index_valid = false;
+    // Overrides of the numbered entities, to keep track of who prints what.
+    std::vector<ExtruderPerCopy>     m_entity_overrides;
     bool something_overridable = false;
     bool something_overridden = false;
     const LayerTools* m_layer_tools = nullptr;    // so we know which LayerTools object this belongs to
@@ -167,6 +188,7 @@ public:
 private:
     void				initialize_layers(std::vector<coordf_t> &zs);
     void 				collect_extruders(const PrintObject &object, const std::vector<std::pair<double, unsigned int>> &per_layer_extruder_switches);
+    void 				collect_extruders(const PrintObject &object, const Layer &layer, const std::vector<std::pair<double, unsigned int>> &per_layer_extruder_switches);
     void				reorder_extruders(unsigned int last_extruder_id);
     void 				fill_wipe_tower_partitions(const PrintConfig &config, coordf_t object_bottom_z, coordf_t max_layer_height);
     void 				collect_extruder_statistics(bool prime_multi_material);
@@ -1,10 +1,10 @@
 #include "GCodeReader.hpp"
+#include "GCodeWriter.hpp"
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
 #include <boost/nowide/fstream.hpp>
 #include <fstream>
 #include <iostream>
-#include <iomanip>
 
 #include <Shiny/Shiny.h>
 
@@ -22,6 +22,42 @@ void GCodeReader::apply_config(const DynamicPrintConfig &config)
     m_extrusion_axis = m_config.get_extrusion_axis()[0];
 }
 
+double GCodeReader::parse_double(const char *c, char **pend)
+{
+    static constexpr double pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    // [+-]digits[.digits] with up to 15 significant digits: Both the mantissa and the power of ten are exact doubles,
+    // thus their quotient is correctly rounded, which is what strtod() returns. Anything else is left to strtod().
+    const char *p        = c;
+    const bool  negative = *p == '-';
+    if (*p == '-' || *p == '+')
+        ++ p;
+    uint64_t mantissa    = 0;
+    int      num_chars   = 0;
+    int      num_digits  = 0;
+    int      num_decimal = 0;
+    auto     parse_digits = [&p, &mantissa, &num_chars, &num_digits]() {
+        for (; *p >= '0' && *p <= '9'; ++ p, ++ num_chars)
+            if ((mantissa = 10 * mantissa + uint64_t(*p - '0')) != 0)
+                ++ num_digits;
+    };
+    parse_digits();
+    if (*p == '.') {
+        ++ p;
+        const int num_integer = num_chars;
+        parse_digits();
+        num_decimal = num_chars - num_integer;
+    }
+    if (num_chars > 0 && num_digits <= 15 && num_decimal <= 22 && is_end_of_word(*p)) {
+        if (pend != nullptr)
+            *pend = const_cast<char*>(p);
+        const double v = double(mantissa) / pow10[num_decimal];
+        return negative ? - v : v;
+    }
+    return strtod(c, pend);
+}
+
 const char* GCodeReader::parse_line_internal(const char *ptr, GCodeLine &gline, std::pair<const char*, const char*> &command)
 {
     PROFILE_FUNC();
@@ -58,7 +94,7 @@ const char* GCodeReader::parse_line_internal(const char *ptr, GCodeLine &gline,
             if (axis != NUM_AXES_WITH_UNKNOWN) {
                 // Try to parse the numeric value.
                 char   *pend = nullptr;
-                double  v = strtod(++ c, &pend);
+                double  v = parse_double(++ c, &pend);
                 if (pend != nullptr && is_end_of_word(*pend)) {
                     // The axis value has been parsed correctly.
                     if (axis != UNKNOWN_AXIS)
@@ -160,7 +196,7 @@ bool GCodeReader::GCodeLine::has_value(char axis, float &value) const
         if (*c == axis) {
             // Try to parse the numeric value.
             char   *pend = nullptr;
-            double  v = strtod(++ c, &pend);
+            double  v = parse_double(++ c, &pend);
             if (pend != nullptr && is_end_of_word(*pend)) {
                 // The axis value has been parsed correctly.
                 value = float(v);
@@ -175,8 +211,9 @@ bool GCodeReader::GCodeLine::has_value(char axis, float &value) const
 
 void GCodeReader::GCodeLine::set(const GCodeReader &reader, const Axis axis, const float new_value, const int decimal_digits)
 {
-    std::ostringstream ss;
-    ss << std::fixed << std::setprecision(decimal_digits) << new_value;
+    // Formatted the same way as by GCodeWriter, without a stream.
+    std::string str;
+    GCodeWriter::append_fixed(str, new_value, decimal_digits);
 
     char match[3] = " X";
     if (int(axis) < 3)
@@ -191,13 +228,13 @@ void GCodeReader::GCodeLine::set(const GCodeReader &reader, const Axis axis, con
     if (this->has(axis)) {
         size_t pos = m_raw.find(match)+2;
         size_t end = m_raw.find(' ', pos+1);
-        m_raw = m_raw.replace(pos, end-pos, ss.str());
+        m_raw = m_raw.replace(pos, end-pos, str);
     } else {
         size_t pos = m_raw.find(' ');
         if (pos == std::string::npos)
-            m_raw += std::string(match) + ss.str();
+            m_raw += std::string(match) + str;
         else
-            m_raw = m_raw.replace(pos, 0, std::string(match) + ss.str());
+            m_raw = m_raw.replace(pos, 0, std::string(match) + str);
     }
     m_axis[axis] = new_value;
     m_mask |= 1 << int(axis);
@@ -1,6 +1,7 @@
 #include "GCodeWriter.hpp"
 #include "CustomGCode.hpp"
 #include <algorithm>
+#include <cmath>
 #include <iomanip>
 #include <iostream>
 #include <map>
@@ -15,6 +16,60 @@
 
 namespace Slic3r {
 
+namespace {
+
+inline void append_xyzf(std::string &out, const char *axis, double v) { out += axis; GCodeWriter::append_fixed(out, v, 3); }
+
+void append_comment(std::string &out, const GCodeConfig &config, const std::string &comment)
+{
+    if (config.gcode_comments && ! comment.empty()) {
+        out += " ; ";
+        out += comment;
+    }
+}
+
+} // namespace
+
+void GCodeWriter::append_fixed(std::string &out, double v, int digits)
+{
+    static constexpr double pow10[] = { 1., 10., 100., 1000., 10000., 100000., 1000000. };
+    assert(digits >= 0 && digits <= 6);
+    const double scaled = std::abs(v) * pow10[digits];
+    if (! (scaled < 1e15)) {
+        // Huge values and NaNs.
+        std::ostringstream ss;
+        ss << PRECISION(v, digits);
+        out += ss.str();
+        return;
+    }
+    // The fractional part is exact, the rounding error of the scaling is smaller than its ulp,
+    // thus it only decides the rounding if the fractional part is exactly one half.
+    const double ip   = std::floor(scaled);
+    const double frac = scaled - ip;
+    uint64_t     n    = uint64_t(ip);
+    if (frac > 0.5)
+        ++ n;
+    else if (frac == 0.5) {
+        const double err = std::fma(std::abs(v), pow10[digits], - scaled);
+        if (err > 0. || (err == 0. && (n & 1) == 1))
+            ++ n;
+    }
+    if (std::signbit(v))
+        out += '-';
+    char  buf[32];
+    char *end = buf + sizeof(buf);
+    char *p   = end;
+    for (int i = 0; i < digits; ++ i, n /= 10)
+        *(-- p) = char('0' + n % 10);
+    if (digits > 0)
+        *(-- p) = '.';
+    do {
+        *(-- p) = char('0' + n % 10);
+        n /= 10;
+    } while (n > 0);
+    out.append(p, end);
+}
+
 void GCodeWriter::apply_print_config(const PrintConfig &print_config)
 {
     this->config.apply(print_config, true);
@@ -152,35 +207,41 @@ std::string GCodeWriter::set_bed_temperature(unsigned int temperature, bool wait
 
 std::string GCodeWriter::set_fan(unsigned int speed, bool dont_save)
 {
-    std::ostringstream gcode;
+    std::string gcode;
     if (m_last_fan_speed != speed || dont_save) {
         if (!dont_save) m_last_fan_speed = speed;
-        
-        if (speed == 0) {
-            if (FLAVOR_IS(gcfTeacup)) {
-                gcode << "M106 S0";
-            } else if (FLAVOR_IS(gcfMakerWare) || FLAVOR_IS(gcfSailfish)) {
-                gcode << "M127";
-            } else {
-                gcode << "M107";
-            }
-            if (this->config.gcode_comments) gcode << " ; disable fan";
-            gcode << "\n";
+        gcode = GCodeWriter::set_fan(this->config.gcode_flavor.value, this->config.gcode_comments.value, speed);
+    }
+    return gcode;
+}
+
+std::string GCodeWriter::set_fan(const GCodeFlavor gcode_flavor, bool gcode_comments, unsigned int speed)
+{
+    std::ostringstream gcode;
+    if (speed == 0) {
+        if (gcode_flavor == gcfTeacup) {
+            gcode << "M106 S0";
+        } else if (gcode_flavor == gcfMakerWare || gcode_flavor == gcfSailfish) {
+            gcode << "M127";
         } else {
-            if (FLAVOR_IS(gcfMakerWare) || FLAVOR_IS(gcfSailfish)) {
-                gcode << "M126";
+            gcode << "M107";
+        }
+        if (gcode_comments) gcode << " ; disable fan";
+        gcode << "\n";
+    } else {
+        if (gcode_flavor == gcfMakerWare || gcode_flavor == gcfSailfish) {
+            gcode << "M126";
+        } else {
+            gcode << "M106 ";
+            if (gcode_flavor == gcfMach3 || gcode_flavor == gcfMachinekit) {
+                gcode << "P";
             } else {
-                gcode << "M106 ";
-                if (FLAVOR_IS(gcfMach3) || FLAVOR_IS(gcfMachinekit)) {
-                    gcode << "P";
-                } else {
-                    gcode << "S";
-                }
-                gcode << (255.0 * speed / 100.0);
+                gcode << "S";
             }
-            if (this->config.gcode_comments) gcode << " ; enable fan";
-            gcode << "\n";
+            gcode << (255.0 * speed / 100.0);
         }
+        if (gcode_comments) gcode << " ; enable fan";
+        gcode << "\n";
     }
     return gcode.str();
 }
@@ -283,12 +344,12 @@ std::string GCodeWriter::set_speed(double F, const std::string &comment, const s
 {
     assert(F > 0.);
     assert(F < 100000.);
-    std::ostringstream gcode;
-    gcode << "G1 F" << XYZF_NUM(F);
-    COMMENT(comment);
-    gcode << cooling_marker;
-    gcode << "\n";
-    return gcode.str();
+    std::string gcode;
+    append_xyzf(gcode, "G1 F", F);
+    append_comment(gcode, this->config, comment);
+    gcode += cooling_marker;
+    gcode += '\n';
+    return gcode;
 }
 
 std::string GCodeWriter::travel_to_xy(const Vec2d &point, const std::string &comment)
@@ -296,13 +357,13 @@ std::string GCodeWriter::travel_to_xy(const Vec2d &point, const std::string &com
     m_pos(0) = point(0);
     m_pos(1) = point(1);
     
-    std::ostringstream gcode;
-    gcode << "G1 X" << XYZF_NUM(point(0))
-          <<   " Y" << XYZF_NUM(point(1))
-          <<   " F" << XYZF_NUM(this->config.travel_speed.value * 60.0);
-    COMMENT(comment);
-    gcode << "\n";
-    return gcode.str();
+    std::string gcode;
+    append_xyzf(gcode, "G1 X", point(0));
+    append_xyzf(gcode,   " Y", point(1));
+    append_xyzf(gcode,   " F", this->config.travel_speed.value * 60.0);
+    append_comment(gcode, this->config, comment);
+    gcode += '\n';
+    return gcode;
 }
 
 std::string GCodeWriter::travel_to_xyz(const Vec3d &point, const std::string &comment)
@@ -326,14 +387,14 @@ std::string GCodeWriter::travel_to_xyz(const Vec3d &point, const std::string &co
     m_lifted = 0;
     m_pos = point;
     
-    std::ostringstream gcode;
-    gcode << "G1 X" << XYZF_NUM(point(0))
-          <<   " Y" << XYZF_NUM(point(1))
-          <<   " Z" << XYZF_NUM(point(2))
-          <<   " F" << XYZF_NUM(this->config.travel_speed.value * 60.0);
-    COMMENT(comment);
-    gcode << "\n";
-    return gcode.str();
+    std::string gcode;
+    append_xyzf(gcode, "G1 X", point(0));
+    append_xyzf(gcode,   " Y", point(1));
+    append_xyzf(gcode,   " Z", point(2));
+    append_xyzf(gcode,   " F", this->config.travel_speed.value * 60.0);
+    append_comment(gcode, this->config, comment);
+    gcode += '\n';
+    return gcode;
 }
 
 std::string GCodeWriter::travel_to_z(double z, const std::string &comment)
@@ -359,12 +420,12 @@ std::string GCodeWriter::_travel_to_z(double z, const std::string &comment)
 {
     m_pos(2) = z;
     
-    std::ostringstream gcode;
-    gcode << "G1 Z" << XYZF_NUM(z)
-          <<   " F" << XYZF_NUM(this->config.travel_speed.value * 60.0);
-    COMMENT(comment);
-    gcode << "\n";
-    return gcode.str();
+    std::string gcode;
+    append_xyzf(gcode, "G1 Z", z);
+    append_xyzf(gcode,   " F", this->config.travel_speed.value * 60.0);
+    append_comment(gcode, this->config, comment);
+    gcode += '\n';
+    return gcode;
 }
 
 bool GCodeWriter::will_move_z(double z) const
@@ -385,13 +446,15 @@ std::string GCodeWriter::extrude_to_xy(const Vec2d &point, double dE, const std:
     m_pos(1) = point(1);
     m_extruder->extrude(dE);
     
-    std::ostringstream gcode;
-    gcode << "G1 X" << XYZF_NUM(point(0))
-          <<   " Y" << XYZF_NUM(point(1))
-          <<    " " << m_extrusion_axis << E_NUM(m_extruder->E());
-    COMMENT(comment);
-    gcode << "\n";
-    return gcode.str();
+    std::string gcode;
+    append_xyzf(gcode, "G1 X", point(0));
+    append_xyzf(gcode,   " Y", point(1));
+    gcode += ' ';
+    gcode += m_extrusion_axis;
+    GCodeWriter::append_fixed(gcode, m_extruder->E(), 5);
+    append_comment(gcode, this->config, comment);
+    gcode += '\n';
+    return gcode;
 }
 
 std::string GCodeWriter::extrude_to_xyz(const Vec3d &point, double dE, const std::string &comment)
@@ -400,14 +463,16 @@ std::string GCodeWriter::extrude_to_xyz(const Vec3d &point, double dE, const std
     m_lifted = 0;
     m_extruder->extrude(dE);
     
-    std::ostringstream gcode;
-    gcode << "G1 X" << XYZF_NUM(point(0))
-          <<   " Y" << XYZF_NUM(point(1))
-          <<   " Z" << XYZF_NUM(point(2))
-          <<    " " << m_extrusion_axis << E_NUM(m_extruder->E());
-    COMMENT(comment);
-    gcode << "\n";
-    return gcode.str();
+    std::string gcode;
+    append_xyzf(gcode, "G1 X", point(0));
+    append_xyzf(gcode,   " Y", point(1));
+    append_xyzf(gcode,   " Z", point(2));
+    gcode += ' ';
+    gcode += m_extrusion_axis;
+    GCodeWriter::append_fixed(gcode, m_extruder->E(), 5);
+    append_comment(gcode, this->config, comment);
+    gcode += '\n';
+    return gcode;
 }
 
 std::string GCodeWriter::retract(bool before_wipe)
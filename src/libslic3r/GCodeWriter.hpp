@@ -42,6 +42,12 @@ public:
     std::string set_temperature(unsigned int temperature, bool wait = false, int tool = -1) const;
     std::string set_bed_temperature(unsigned int temperature, bool wait = false);
     std::string set_fan(unsigned int speed, bool dont_save = false);
+    // Fan control command for a given G-code flavor. Also used by the CoolingBuffer, which keeps its own fan state.
+    static std::string set_fan(const GCodeFlavor gcode_flavor, bool gcode_comments, unsigned int speed);
+    // Appends the value formatted the same way as std::fixed << std::setprecision(digits) does, that is correctly rounded
+    // to the nearest with ties to even, without the overhead of std::ostringstream. The axis values of G0 / G1 moves
+    // are formatted this way, these make up most of the G-code. The number of digits is at most 6.
+    static void append_fixed(std::string &out, double v, int digits);
     std::string set_acceleration(unsigned int acceleration);
     std::string reset_e(bool force = false);
     std::string update_progress(unsigned int num, unsigned int tot, bool allow_100 = false) const;
@@ -4,6 +4,7 @@
 #define slic3r_KDTreeIndirect_hpp_
 
 #include <algorithm>
+#include <array>
 #include <limits>
 #include <vector>
 
@@ -58,6 +59,8 @@ public:
 		CONTINUE_LEFT   = 1,
 		CONTINUE_RIGHT  = 2,
 		STOP 			= 4,
+		// Descend into the right subtree first, if both subtrees are to be visited.
+		RIGHT_FIRST 	= 8,
 	};
 	template<typename CoordType> 
 	unsigned int descent_mask(const CoordType &point_coord, const CoordType &search_radius, size_t idx, size_t dimension) const
@@ -180,9 +183,15 @@ private:
 		unsigned int mask = visitor(m_nodes[node], dimension);
 		if ((mask & (unsigned int)VisitorReturnMask::STOP) == 0) {
 			size_t next_dimension = (++ dimension == NumDimensions) ? 0 : dimension;
-			if (mask & (unsigned int)VisitorReturnMask::CONTINUE_LEFT)
+			bool visit_left  = (mask & (unsigned int)VisitorReturnMask::CONTINUE_LEFT) != 0;
+			bool visit_right = (mask & (unsigned int)VisitorReturnMask::CONTINUE_RIGHT) != 0;
+			if (visit_right && (mask & (unsigned int)VisitorReturnMask::RIGHT_FIRST) != 0) {
+				visit_recursive(right, next_dimension, visitor);
+				visit_right = false;
+			}
+			if (visit_left)
 				visit_recursive(left,  next_dimension, visitor);
-			if (mask & (unsigned int)VisitorReturnMask::CONTINUE_RIGHT)
+			if (visit_right)
 				visit_recursive(right, next_dimension, visitor);
 		}
 	}
@@ -230,6 +239,59 @@ size_t find_closest_point(const KDTreeIndirectType& kdtree, const PointType& poi
 	return find_closest_point(kdtree, point, [](size_t) { return true; });
 }
 
+// Find up to NumClosest closest points using Euclidian metrics.
+// The indices are written to out sorted by an increasing distance, out has to hold NumClosest indices.
+// Returns the number of the points found. Nothing is allocated, so that it may be called for many points.
+template<size_t NumClosest, typename KDTreeIndirectType, typename PointType, typename FilterFn>
+size_t find_closest_points(const KDTreeIndirectType &kdtree, const PointType &point, FilterFn filter, size_t *out)
+{
+	struct Visitor {
+		using CoordType         = typename KDTreeIndirectType::CoordType;
+		using VisitorReturnMask = typename KDTreeIndirectType::VisitorReturnMask;
+		const KDTreeIndirectType   &kdtree;
+		const PointType    		   &point;
+		const FilterFn				filter;
+		// Squared distances of the points found so far, sorted.
+		std::array<CoordType, NumClosest> dists;
+		size_t 					   *out;
+		size_t 						size = 0;
+
+		Visitor(const KDTreeIndirectType &kdtree, const PointType &point, FilterFn filter, size_t *out) : 
+			kdtree(kdtree), point(point), filter(filter), out(out) {}
+		unsigned int operator()(size_t idx, size_t dimension) {
+			if (this->filter(idx)) {
+				auto dist = CoordType(0);
+				for (size_t i = 0; i < KDTreeIndirectType::NumDimensions; ++ i) {
+					CoordType d = point[i] - kdtree.coordinate(idx, i);
+					dist += d * d;
+				}
+				if (size < NumClosest || dist < dists[size - 1]) {
+					// Insertion sort, dropping the farthest point if full.
+					size_t k = std::min(size, NumClosest - 1);
+					for (; k > 0 && dist < dists[k - 1]; -- k) {
+						dists[k] = dists[k - 1];
+						out[k]   = out[k - 1];
+					}
+					dists[k] = dist;
+					out[k]   = idx;
+					size     = std::min(size + 1, NumClosest);
+				}
+			}
+			unsigned int mask = kdtree.descent_mask(point[dimension], 
+				size < NumClosest ? std::numeric_limits<CoordType>::max() : dists[size - 1], idx, dimension);
+			// Visit the half space containing the point first to shrink the search radius early.
+			if ((mask & (unsigned int)(VisitorReturnMask::CONTINUE_LEFT)) && (mask & (unsigned int)(VisitorReturnMask::CONTINUE_RIGHT)) &&
+				point[dimension] > kdtree.coordinate(idx, dimension))
+				mask |= (unsigned int)(VisitorReturnMask::RIGHT_FIRST);
+			return mask;
+		}
+	} visitor(kdtree, point, filter, out);
+
+	if (NumClosest > 0)
+		kdtree.visit(visitor);
+	return visitor.size;
+}
+
 } // namespace Slic3r
 
 #endif /* slic3r_KDTreeIndirect_hpp_ */
@@ -7,6 +7,8 @@
 
 #include <boost/log/trivial.hpp>
 
+#include <tbb/parallel_for.h>
+
 namespace Slic3r {
 
 Layer::~Layer()
@@ -108,9 +110,14 @@ ExPolygons Layer::merged(float offset_scaled) const
 void Layer::make_perimeters()
 {
     BOOST_LOG_TRIVIAL(trace) << "Generating perimeters for layer " << this->id();
+
+    for (LayerRegion *layerm : m_regions)
+        ++ layerm->perimeters_generation;
     
     // keep track of regions whose perimeters we have already generated
     std::vector<unsigned char> done(m_regions.size(), false);
+    // groups of compatible regions, sharing their perimeters
+    std::vector<LayerRegionPtrs> groups;
     
     for (LayerRegionPtrs::iterator layerm = m_regions.begin(); layerm != m_regions.end(); ++ layerm) 
     	if ((*layerm)->slices.empty()) {
@@ -150,44 +157,57 @@ void Layer::make_perimeters()
 		                done[it - m_regions.begin()] = true;
 		            }
 		        }
-	        
-	        if (layerms.size() == 1) {  // optimization
-	            (*layerm)->fill_surfaces.surfaces.clear();
-	            (*layerm)->make_perimeters((*layerm)->slices, &(*layerm)->fill_surfaces);
-	            (*layerm)->fill_expolygons = to_expolygons((*layerm)->fill_surfaces.surfaces);
-	        } else {
-	            SurfaceCollection new_slices;
-	            // Use the region with highest infill rate, as the make_perimeters() function below decides on the gap fill based on the infill existence.
-	            LayerRegion *layerm_config = layerms.front();
-	            {
-	                // group slices (surfaces) according to number of extra perimeters
-	                std::map<unsigned short, Surfaces> slices;  // extra_perimeters => [ surface, surface... ]
-	                for (LayerRegion *layerm : layerms) {
-	                    for (Surface &surface : layerm->slices.surfaces)
-	                        slices[surface.extra_perimeters].emplace_back(surface);
-	                    if (layerm->region()->config().fill_density > layerm_config->region()->config().fill_density)
-	                    	layerm_config = layerm;
-	                }
-	                // merge the surfaces assigned to each group
-	                for (std::pair<const unsigned short,Surfaces> &surfaces_with_extra_perimeters : slices)
-	                    new_slices.append(union_ex(surfaces_with_extra_perimeters.second, true), surfaces_with_extra_perimeters.second.front());
-	            }
-	            
-	            // make perimeters
-	            SurfaceCollection fill_surfaces;
-	            layerm_config->make_perimeters(new_slices, &fill_surfaces);
-
-	            // assign fill_surfaces to each layer
-	            if (!fill_surfaces.surfaces.empty()) { 
-	                for (LayerRegionPtrs::iterator l = layerms.begin(); l != layerms.end(); ++l) {
-	                    // Separate the fill surfaces.
-	                    ExPolygons expp = intersection_ex(to_polygons(fill_surfaces), (*l)->slices);
-	                    (*l)->fill_expolygons = expp;
-	                    (*l)->fill_surfaces.set(std::move(expp), fill_surfaces.surfaces.front());
-	                }
-	            }
-	        }
+	        groups.emplace_back(std::move(layerms));
 	    }
+
+    // The groups write to disjoint regions, generate their perimeters in parallel.
+    auto make_group_perimeters = [](const LayerRegionPtrs &layerms) {
+        if (layerms.size() == 1) {  // optimization
+            LayerRegion *layerm = layerms.front();
+            layerm->fill_surfaces.surfaces.clear();
+            layerm->make_perimeters(layerm->slices, &layerm->fill_surfaces);
+            layerm->fill_expolygons = to_expolygons(layerm->fill_surfaces.surfaces);
+        } else {
+            SurfaceCollection new_slices;
+            // Use the region with highest infill rate, as the make_perimeters() function below decides on the gap fill based on the infill existence.
+            LayerRegion *layerm_config = layerms.front();
+            {
+                // group slices (surfaces) according to number of extra perimeters
+                std::map<unsigned short, Surfaces> slices;  // extra_perimeters => [ surface, surface... ]
+                for (LayerRegion *layerm : layerms) {
+                    for (Surface &surface : layerm->slices.surfaces)
+                        slices[surface.extra_perimeters].emplace_back(surface);
+                    if (layerm->region()->config().fill_density > layerm_config->region()->config().fill_density)
+                    	layerm_config = layerm;
+                }
+                // merge the surfaces assigned to each group
+                for (std::pair<const unsigned short,Surfaces> &surfaces_with_extra_perimeters : slices)
+                    new_slices.append(union_ex(surfaces_with_extra_perimeters.second, true), surfaces_with_extra_perimeters.second.front());
+            }
+            
+            // make perimeters
+            SurfaceCollection fill_surfaces;
+            layerm_config->make_perimeters(new_slices, &fill_surfaces);
+
+            // assign fill_surfaces to each layer
+            if (!fill_surfaces.surfaces.empty()) { 
+                for (LayerRegionPtrs::const_iterator l = layerms.begin(); l != layerms.end(); ++l) {
+                    // Separate the fill surfaces.
+                    ExPolygons expp = intersection_ex(to_polygons(fill_surfaces), (*l)->slices);
+                    (*l)->fill_expolygons = expp;
+                    (*l)->fill_surfaces.set(std::move(expp), fill_surfaces.surfaces.front());
+                }
+            }
+        }
+    };
+    if (groups.size() == 1)
+        make_group_perimeters(groups.front());
+    else
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, groups.size()),
+            [&groups, &make_group_perimeters](const tbb::blocked_range<size_t> &range) {
+                for (size_t group_idx = range.begin(); group_idx < range.end(); ++ group_idx)
+                    make_group_perimeters(groups[group_idx]);
+            });
     BOOST_LOG_TRIVIAL(trace) << "Generating perimeters for layer " << this->id() << " - Done";
 }
 
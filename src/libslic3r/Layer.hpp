@@ -54,6 +54,11 @@ public:
     // ordered collection of extrusion paths to fill surfaces
     // (this collection contains only ExtrusionEntityCollection objects)
     ExtrusionEntityCollection   fills;
+
+    // Number of times the perimeters and the fills of this region were generated by Layer::make_perimeters() and Layer::make_fills().
+    // PrintObject recalculates a span of layers only if the configuration of a region limited to these layers changed.
+    size_t                      perimeters_generation = 0;
+    size_t                      fills_generation      = 0;
     
     Flow    flow(FlowRole role, bool bridge = false, double width = -1) const;
     void    slices_to_fill_surfaces_clipped();
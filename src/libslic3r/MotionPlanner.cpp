@@ -1,9 +1,9 @@
 #include "BoundingBox.hpp"
 #include "MotionPlanner.hpp"
-#include "MutablePriorityQueue.hpp"
 #include "Utils.hpp"
 
 #include <limits> // for numeric_limits
+#include <queue>
 #include <assert.h>
 
 #define BOOST_VORONOI_USE_GMP 1
@@ -193,40 +193,36 @@ const MotionPlannerGraph& MotionPlanner::init_graph(int island_idx)
         
         typedef voronoi_diagram<double> VD;
         VD vd;
-        // Mapping between Voronoi vertices and graph nodes.
-        std::map<const VD::vertex_type*, size_t> vd_vertices;
         // get boundaries as lines
         const MotionPlannerEnv &env = this->get_env(island_idx);
         Lines lines = env.m_env.lines();
         boost::polygon::construct_voronoi(lines.begin(), lines.end(), &vd);
+        // Mapping between Voronoi vertices (indexed by their position in vd.vertices()) and graph nodes.
+        // A vertex is shared by several edges, its containment in the island is tested just once.
+        static constexpr size_t NodeUnknown = size_t(-1);
+        static constexpr size_t NodeOutside = size_t(-2);
+        std::vector<size_t> vd_vertices(vd.num_vertices(), NodeUnknown);
+        auto vertex_node = [&vd, &vd_vertices, &env, graph](const VD::vertex_type *v) {
+            size_t &node = vd_vertices[v - &vd.vertices().front()];
+            if (node == NodeUnknown) {
+                Point p(v->x(), v->y());
+                node = env.island_contains_b(p) ? graph->add_node(p) : NodeOutside;
+            }
+            return node;
+        };
         // traverse the Voronoi diagram and generate graph nodes and edges
         for (const VD::edge_type &edge : vd.edges()) {
             if (edge.is_infinite())
                 continue;
-            const VD::vertex_type* v0 = edge.vertex0();
-            const VD::vertex_type* v1 = edge.vertex1();
-            Point p0(v0->x(), v0->y());
-            Point p1(v1->x(), v1->y());
             // Insert only Voronoi edges fully contained in the island.
-            //FIXME This test has a terrible O(n^2) time complexity.
-            if (env.island_contains_b(p0) && env.island_contains_b(p1)) {
-                // Find v0 in the graph, allocate a new node if v0 does not exist in the graph yet.
-                auto i_v0 = vd_vertices.find(v0);
-                size_t v0_idx;
-                if (i_v0 == vd_vertices.end())
-                    vd_vertices[v0] = v0_idx = graph->add_node(p0);
-                else
-                    v0_idx = i_v0->second;
-                // Find v1 in the graph, allocate a new node if v0 does not exist in the graph yet.
-                auto i_v1 = vd_vertices.find(v1);
-                size_t v1_idx;
-                if (i_v1 == vd_vertices.end())
-                    vd_vertices[v1] = v1_idx = graph->add_node(p1);
-                else
-                    v1_idx = i_v1->second;
-                // Euclidean distance is used as weight for the graph edge
-                graph->add_edge(v0_idx, v1_idx, (p1 - p0).cast<double>().norm());
-            }
+            size_t v0_idx = vertex_node(edge.vertex0());
+            if (v0_idx == NodeOutside)
+                continue;
+            size_t v1_idx = vertex_node(edge.vertex1());
+            if (v1_idx == NodeOutside)
+                continue;
+            // Euclidean distance is used as weight for the graph edge
+            graph->add_edge(v0_idx, v1_idx, (graph->node(v1_idx) - graph->node(v0_idx)).cast<double>().norm());
         }
     }
 
@@ -305,7 +301,7 @@ void MotionPlannerGraph::add_edge(size_t from, size_t to, double weight)
     m_adjacency_list[from].emplace_back(Neighbor(node_t(to), weight));
 }
 
-// Dijkstra's shortest path in a weighted graph from node_start to node_end.
+// A* shortest path in a weighted graph from node_start to node_end, guided by the Euclidean distance to node_end.
 // The returned path contains the end points.
 // If no path exists from node_start to node_end, a straight segment is returned.
 Polyline MotionPlannerGraph::shortest_path(size_t node_start, size_t node_end) const
@@ -314,37 +310,44 @@ Polyline MotionPlannerGraph::shortest_path(size_t node_start, size_t node_end) c
     if (this->empty())
         return Polyline();
 
-    // Dijkstra algorithm, previous node of the current node 'u' in the shortest path towards node_start.
-    std::vector<node_t>   previous(m_adjacency_list.size(), -1);
-    std::vector<weight_t> distance(m_adjacency_list.size(), std::numeric_limits<weight_t>::infinity());
-    std::vector<size_t>   map_node_to_queue_id(m_adjacency_list.size(), size_t(-1));
+    // Previous node of the current node 'u' in the shortest path towards node_start.
+    std::vector<node_t>   previous(m_nodes.size(), -1);
+    std::vector<weight_t> distance(m_nodes.size(), std::numeric_limits<weight_t>::infinity());
+    std::vector<char>     closed(m_nodes.size(), false);
     distance[node_start] = 0.;
 
-    auto queue = make_mutable_priority_queue<node_t, false>(
-        [&map_node_to_queue_id](const node_t node, size_t idx) { map_node_to_queue_id[node] = idx; },
-        [&distance](const node_t node1, const node_t node2) { return distance[node1] < distance[node2]; });
-    queue.reserve(m_adjacency_list.size());
-    for (size_t i = 0; i < m_adjacency_list.size(); ++ i)
-        queue.push(node_t(i));
+    // As the edge weights are Euclidean lengths, the Euclidean distance to node_end never overestimates
+    // the remaining path length, thus the first time node_end is taken from the queue, its path is the shortest.
+    const Vec2d target = m_nodes[node_end].cast<double>();
+    auto        heuristic = [this, &target](node_t node) { return (m_nodes[node].cast<double>() - target).norm(); };
+    // Only the nodes reached so far are queued. A node is queued again whenever a shorter path to it is found,
+    // the outdated queue entries are skipped.
+    typedef std::pair<weight_t, node_t> QueueItem;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+    queue.emplace(heuristic(node_t(node_start)), node_t(node_start));
 
     while (! queue.empty()) {
-        // Get the next node with the lowest distance to node_start.
-        node_t u = node_t(queue.top());
+        // Get the next node with the lowest estimate of the path length from node_start to node_end.
+        node_t u = queue.top().second;
         queue.pop();
-        map_node_to_queue_id[u] = size_t(-1);
+        if (closed[u])
+            continue;
+        closed[u] = true;
         // Stop searching if we reached our destination.
         if (size_t(u) == node_end)
             break;
+        if (size_t(u) >= m_adjacency_list.size())
+            continue;
         // Visit each edge starting at node u.
         for (const Neighbor& neighbor : m_adjacency_list[u])
-            if (map_node_to_queue_id[neighbor.target] != size_t(-1)) {
+            if (! closed[neighbor.target]) {
                 weight_t alt = distance[u] + neighbor.weight;
                 // If total distance through u is shorter than the previous
                 // distance (if any) between node_start and neighbor.target, replace it.
                 if (alt < distance[neighbor.target]) {
                     distance[neighbor.target] = alt;
                     previous[neighbor.target] = u;
-                    queue.update(map_node_to_queue_id[neighbor.target]);
+                    queue.emplace(alt + heuristic(neighbor.target), neighbor.target);
                 }
             }
     }
@@ -352,7 +355,6 @@ Polyline MotionPlannerGraph::shortest_path(size_t node_start, size_t node_end) c
     // In case the end point was not reached, previous[node_end] contains -1
     // and a straight line from node_start to node_end is returned.
     Polyline polyline;
-    polyline.points.reserve(m_adjacency_list.size());
     for (node_t vertex = node_t(node_end); vertex != -1; vertex = previous[vertex])
         polyline.points.emplace_back(m_nodes[vertex]);
     polyline.points.emplace_back(m_nodes[node_start]);
@@ -360,4 +362,64 @@ Polyline MotionPlannerGraph::shortest_path(size_t node_start, size_t node_end) c
     return polyline;
 }
 
+void MotionPlannerEnv::build_index()
+{
+    m_slab_start.clear();
+    m_slab_lines.clear();
+    Lines lines = m_island.lines();
+    if (lines.empty())
+        return;
+
+    // An edge closer than SCALED_EPSILON to a point is considered by island_contains_b().
+    const coord_t margin    = coord_t(std::ceil(SCALED_EPSILON));
+    const coord_t height    = m_island_bbox.max.y() - m_island_bbox.min.y();
+    // A few edges per slab on average.
+    size_t        num_slabs = std::clamp<size_t>(lines.size() / 4, 1, 4096);
+    m_slab_height = std::max<coord_t>(1, height / coord_t(num_slabs) + 1);
+    num_slabs     = size_t(height / m_slab_height) + 1;
+    m_slab_start.assign(num_slabs + 1, 0);
+    // Counting sort of the edges into the slabs.
+    auto slab_range = [this, margin](const Line &line) {
+        return std::make_pair(this->slab_index(std::min(line.a.y(), line.b.y()) - margin), this->slab_index(std::max(line.a.y(), line.b.y()) + margin));
+    };
+    for (const Line &line : lines) {
+        auto range = slab_range(line);
+        for (size_t i = range.first; i <= range.second; ++ i)
+            ++ m_slab_start[i + 1];
+    }
+    for (size_t i = 0; i < num_slabs; ++ i)
+        m_slab_start[i + 1] += m_slab_start[i];
+    m_slab_lines.assign(m_slab_start.back(), Line());
+    std::vector<size_t> next(m_slab_start.begin(), m_slab_start.end() - 1);
+    for (const Line &line : lines) {
+        auto range = slab_range(line);
+        for (size_t i = range.first; i <= range.second; ++ i)
+            m_slab_lines[next[i] ++] = line;
+    }
+}
+
+size_t MotionPlannerEnv::slab_index(coord_t y) const
+{
+    return size_t(std::clamp<coord_t>((y - m_island_bbox.min.y()) / m_slab_height, 0, coord_t(m_slab_start.size() - 2)));
+}
+
+bool MotionPlannerEnv::island_contains_indexed(const Point &pt, bool include_boundary) const
+{
+    if (m_slab_start.empty())
+        return false;
+    // Crossing number test of the contour and the holes at once, the same as Polygon::contains() calculates it.
+    // A point inside a hole crosses both the hole and the contour.
+    bool   inside = false;
+    size_t slab   = this->slab_index(pt.y());
+    for (size_t i = m_slab_start[slab]; i < m_slab_start[slab + 1]; ++ i) {
+        const Line &line = m_slab_lines[i];
+        if (include_boundary && line.distance_to(pt) < SCALED_EPSILON)
+            return true;
+        if ((line.b.y() > pt.y()) != (line.a.y() > pt.y()) &&
+            double(pt.x()) < double(line.a.x() - line.b.x()) * double(pt.y() - line.b.y()) / double(line.a.y() - line.b.y()) + double(line.b.x()))
+            inside = ! inside;
+    }
+    return inside;
+}
+
 }
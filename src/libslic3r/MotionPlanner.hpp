@@ -24,26 +24,40 @@ class MotionPlannerEnv
     
 public:
     MotionPlannerEnv() {};
-    MotionPlannerEnv(const ExPolygon &island) : m_island(island), m_island_bbox(get_extents(island)) {};
+    MotionPlannerEnv(const ExPolygon &island) : m_island(island), m_island_bbox(get_extents(island)) { this->build_index(); };
     Point nearest_env_point(const Point &from, const Point &to) const;
     bool  island_contains(const Point &pt) const
-        { return m_island_bbox.contains(pt) && m_island.contains(pt); }
+        { return m_island_bbox.contains(pt) && this->island_contains_indexed(pt, false); }
     bool  island_contains_b(const Point &pt) const
-        { return m_island_bbox.contains(pt) && m_island.contains_b(pt); }
+        { return m_island_bbox.contains(pt) && this->island_contains_indexed(pt, true); }
 
 private:
     ExPolygon           m_island;
     BoundingBox         m_island_bbox;
     // Region, where the travel is allowed.
     ExPolygonCollection m_env;
+
+    // Edges of m_island sorted into horizontal slabs, so that the containment tests only visit the edges
+    // crossing the slab of the tested point. An edge is listed in all the slabs its Y span extended by
+    // SCALED_EPSILON touches. The edges of the i-th slab are m_slab_lines[m_slab_start[i] .. m_slab_start[i + 1]).
+    coord_t             m_slab_height = 1;
+    std::vector<size_t> m_slab_start;
+    Lines               m_slab_lines;
+
+    void   build_index();
+    size_t slab_index(coord_t y) const;
+    // Same as m_island.contains(pt), or m_island.contains_b(pt) if include_boundary.
+    bool   island_contains_indexed(const Point &pt, bool include_boundary) const;
 };
 
-// A 2D directed graph for searching a shortest path using the famous Dijkstra algorithm.
+// A 2D directed graph for searching a shortest path using the A* algorithm.
+// The edge weights shall be Euclidean lengths of the edges, as the search is guided by the Euclidean distance to the target.
 class MotionPlannerGraph
 {    
 public:
     // Add a directed edge into the graph.
     size_t   add_node(const Point &p) { m_nodes.emplace_back(p); return m_nodes.size() - 1; }
+    const Point& node(size_t idx) const { return m_nodes[idx]; }
     void     add_edge(size_t from, size_t to, double weight);
     size_t   find_closest_node(const Point &point) const { return point.nearest_point_index(m_nodes); }
 
@@ -3,6 +3,7 @@
 
 #include "libslic3r.h"
 #include <vector>
+#include "ExtrusionEntityCollection.hpp"
 #include "Flow.hpp"
 #include "Polygon.hpp"
 #include "PrintConfig.hpp"
@@ -60,6 +61,15 @@ public:
     Polygons    lower_slices_polygons() const { return m_lower_slices_polygons; }
 
 private:
+    // Outputs of a single island, collected into loops, gap_fill and fill_surfaces in the order of the islands.
+    struct Island {
+        ExtrusionEntityCollection   loops;
+        ExtrusionEntityCollection   gap_fill;
+        ExPolygons                  fill_expolygons;
+    };
+    // Thread safe, called for the islands in parallel.
+    void        process_island(const Surface &surface, Island &out) const;
+
     double      m_ext_mm3_per_mm;
     double      m_mm3_per_mm;
     double      m_mm3_per_mm_overhang;
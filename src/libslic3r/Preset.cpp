@@ -594,6 +594,7 @@ const std::vector<std::string>& Preset::sla_printer_options()
             "elefant_foot_compensation",
             "elefant_foot_min_width",
             "gamma_correction",
+            "layer_encoding", "fast_rasterization",
             "min_exposure_time", "max_exposure_time",
             "min_initial_exposure_time", "max_initial_exposure_time",
             //FIXME the print host keys are left here just for conversion from the Printer preset to Physical Printer preset.
@@ -26,6 +26,10 @@
 #include <boost/format.hpp>
 #include <boost/log/trivial.hpp>
 
+#include <tbb/parallel_for.h>
+
+#include <Shiny/Shiny.h>
+
 // Mark string for localization and translate.
 #define L(s) Slic3r::I18N::translate(s)
 
@@ -1089,7 +1093,7 @@ Print::ApplyStatus Print::apply(const Model &model, DynamicPrintConfig new_full_
                 region.config_apply_only(this_region_config, diff, false);
                 for (PrintObject *print_object : m_objects)
                     if (region_id < print_object->region_volumes.size() && ! print_object->region_volumes[region_id].empty())
-                        update_apply_status(print_object->invalidate_state_by_config_options(diff));
+                        update_apply_status(print_object->invalidate_region_state_by_config_options(region_id, diff));
             }
         }
     }
@@ -2060,6 +2064,8 @@ const WipeTowerData& Print::wipe_tower_data(size_t extruders_cnt, double first_l
 
 void Print::_make_wipe_tower()
 {
+    PROFILE_FUNC();
+
     m_wipe_tower_data.clear();
     if (! this->has_wipe_tower())
         return;
@@ -2134,38 +2140,84 @@ void Print::_make_wipe_tower()
     // Lets go through the wipe tower layers and determine pairs of extruder changes for each
     // to pass to wipe_tower (so that it can use it for planning the layout of the tower)
     {
-        unsigned int current_extruder_id = m_wipe_tower_data.tool_ordering.all_extruders().back();
-        for (auto &layer_tools : m_wipe_tower_data.tool_ordering.layer_tools()) { // for all layers
-            if (!layer_tools.has_wipe_tower) continue;
-            bool first_layer = &layer_tools == &m_wipe_tower_data.tool_ordering.front();
-            wipe_tower.plan_toolchange((float)layer_tools.print_z, (float)layer_tools.wipe_tower_layer_height, current_extruder_id, current_extruder_id, false);
-            for (const auto extruder_id : layer_tools.extruders) {
-                if ((first_layer && extruder_id == m_wipe_tower_data.tool_ordering.all_extruders().back()) || extruder_id != current_extruder_id) {
-                    float volume_to_wipe = wipe_volumes[current_extruder_id][extruder_id];             // total volume to wipe after this toolchange
-                    // Not all of that can be used for infill purging:
-                    volume_to_wipe -= (float)m_config.filament_minimal_purge_on_wipe_tower.get_at(extruder_id);
-
-                    // try to assign some infills/objects for the wiping:
-                    volume_to_wipe = layer_tools.wiping_extrusions().mark_wiping_extrusions(*this, current_extruder_id, extruder_id, volume_to_wipe);
-
-                    // add back the minimal amount toforce on the wipe tower:
-                    volume_to_wipe += (float)m_config.filament_minimal_purge_on_wipe_tower.get_at(extruder_id);
-
-                    // request a toolchange at the wipe tower with at least volume_to_wipe purging amount
-                    wipe_tower.plan_toolchange((float)layer_tools.print_z, (float)layer_tools.wipe_tower_layer_height, current_extruder_id, extruder_id,
-                                               first_layer && extruder_id == m_wipe_tower_data.tool_ordering.all_extruders().back(), volume_to_wipe);
-                    current_extruder_id = extruder_id;
-                }
+        std::vector<LayerTools> &layer_tools    = m_wipe_tower_data.tool_ordering.layer_tools();
+        const unsigned int       first_extruder = m_wipe_tower_data.tool_ordering.all_extruders().back();
+
+        // A layer only depends on its predecessors through the extruder active when the layer starts, which is the last extruder
+        // of the previous wipe tower layer. Find it for each layer serially, together with the last layer of the wipe tower.
+        std::vector<unsigned int> start_extruder;
+        start_extruder.reserve(layer_tools.size());
+        {
+            unsigned int current_extruder_id = first_extruder;
+            for (const LayerTools &lt : layer_tools) {
+                start_extruder.emplace_back(current_extruder_id);
+                if (! lt.has_wipe_tower)
+                    continue;
+                if (! lt.extruders.empty())
+                    current_extruder_id = lt.extruders.back();
+                if (&lt == &layer_tools.back() || (&lt + 1)->wipe_tower_partitions == 0)
+                    break;
             }
-            layer_tools.wiping_extrusions().ensure_perimeters_infills_order(*this);
-            if (&layer_tools == &m_wipe_tower_data.tool_ordering.back() || (&layer_tools + 1)->wipe_tower_partitions == 0)
-                break;
+        }
+
+        // Assign the infills / objects to be wiped into and calculate the volumes left to be purged on the wipe tower.
+        // Each layer keeps its own WipingExtrusions, thus the layers are processed in parallel.
+        struct ToolChange {
+            unsigned int old_tool;
+            unsigned int new_tool;
+            bool         brim;
+            float        wipe_volume;
+        };
+        std::vector<std::vector<ToolChange>> tool_changes(start_extruder.size());
+        BOOST_LOG_TRIVIAL(debug) << "Marking wiping extrusions in parallel - start";
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(0, start_extruder.size()),
+            [this, &layer_tools, first_extruder, &start_extruder, &wipe_volumes, &tool_changes](const tbb::blocked_range<size_t>& range) {
+                for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
+                    LayerTools &lt = layer_tools[layer_idx];
+                    if (! lt.has_wipe_tower)
+                        continue;
+                    this->throw_if_canceled();
+                    bool first_layer = layer_idx == 0;
+                    unsigned int current_extruder_id = start_extruder[layer_idx];
+                    for (const auto extruder_id : lt.extruders) {
+                        if ((first_layer && extruder_id == first_extruder) || extruder_id != current_extruder_id) {
+                            float volume_to_wipe = wipe_volumes[current_extruder_id][extruder_id];             // total volume to wipe after this toolchange
+                            // Not all of that can be used for infill purging:
+                            volume_to_wipe -= (float)m_config.filament_minimal_purge_on_wipe_tower.get_at(extruder_id);
+
+                            // try to assign some infills/objects for the wiping:
+                            volume_to_wipe = lt.wiping_extrusions().mark_wiping_extrusions(*this, current_extruder_id, extruder_id, volume_to_wipe);
+
+                            // add back the minimal amount toforce on the wipe tower:
+                            volume_to_wipe += (float)m_config.filament_minimal_purge_on_wipe_tower.get_at(extruder_id);
+
+                            tool_changes[layer_idx].push_back({ current_extruder_id, extruder_id, first_layer && extruder_id == first_extruder, volume_to_wipe });
+                            current_extruder_id = extruder_id;
+                        }
+                    }
+                    lt.wiping_extrusions().ensure_perimeters_infills_order(*this);
+                }
+            });
+        BOOST_LOG_TRIVIAL(debug) << "Marking wiping extrusions in parallel - end";
+
+        for (size_t layer_idx = 0; layer_idx < start_extruder.size(); ++ layer_idx) {
+            const LayerTools &lt = layer_tools[layer_idx];
+            if (! lt.has_wipe_tower)
+                continue;
+            wipe_tower.plan_toolchange((float)lt.print_z, (float)lt.wipe_tower_layer_height, start_extruder[layer_idx], start_extruder[layer_idx], false);
+            // request a toolchange at the wipe tower with at least volume_to_wipe purging amount
+            for (const ToolChange &tool_change : tool_changes[layer_idx])
+                wipe_tower.plan_toolchange((float)lt.print_z, (float)lt.wipe_tower_layer_height, tool_change.old_tool, tool_change.new_tool,
+                                           tool_change.brim, tool_change.wipe_volume);
         }
     }
 
     // Generate the wipe tower layers.
+    BOOST_LOG_TRIVIAL(debug) << "Generating wipe tower layers - start";
     m_wipe_tower_data.tool_changes.reserve(m_wipe_tower_data.tool_ordering.layer_tools().size());
     wipe_tower.generate(m_wipe_tower_data.tool_changes);
+    BOOST_LOG_TRIVIAL(debug) << "Generating wipe tower layers - end";
     m_wipe_tower_data.depth = wipe_tower.get_depth();
     m_wipe_tower_data.brim_width = wipe_tower.get_brim_width();
 
@@ -15,6 +15,8 @@
 
 #include "libslic3r.h"
 
+#include <limits>
+
 namespace Slic3r {
 
 class Print;
@@ -124,6 +126,10 @@ public:
     // vector of (layer height ranges and vectors of volume ids), indexed by region_id
     std::vector<std::vector<std::pair<t_layer_height_range, int>>> region_volumes;
 
+    // Span of layers [first, second).
+    using LayerSpan = std::pair<size_t, size_t>;
+    static constexpr LayerSpan AllLayers { 0, std::numeric_limits<size_t>::max() };
+
     // Size of an object: XYZ in scaled coordinates. The size might not be quite snug in XY plane.
     const Vec3crd&          size() const			{ return m_size; }
     const PrintObjectConfig& config() const         { return m_config; }    
@@ -208,11 +214,15 @@ private:
     void                    config_apply_only(const ConfigBase &other, const t_config_option_keys &keys, bool ignore_nonexistent = false) { this->m_config.apply_only(other, keys, ignore_nonexistent); }
     PrintBase::ApplyStatus  set_instances(PrintInstances &&instances);
     // Invalidates the step, and its depending steps in PrintObject and Print.
-    bool                    invalidate_step(PrintObjectStep step);
+    // The perimeters and the infill may be invalidated for a span of layers only, the other steps are always invalidated as a whole.
+    bool                    invalidate_step(PrintObjectStep step, const LayerSpan &layers = AllLayers);
     // Invalidates all PrintObject and Print steps.
     bool                    invalidate_all_steps();
     // Invalidate steps based on a set of parameters changed.
-    bool                    invalidate_state_by_config_options(const std::vector<t_config_option_key> &opt_keys);
+    bool                    invalidate_state_by_config_options(const std::vector<t_config_option_key> &opt_keys, const LayerSpan &layers = AllLayers);
+    // Invalidate steps based on a set of parameters of a single region changed.
+    // Only the layers containing the region are invalidated, if the region is limited to a span of layers (layer_config_ranges, modifiers).
+    bool                    invalidate_region_state_by_config_options(size_t region_id, const std::vector<t_config_option_key> &opt_keys);
     // If ! m_slicing_params.valid, recalculate.
     void                    update_slicing_parameters();
 
@@ -259,6 +269,15 @@ private:
     // so that next call to make_perimeters() performs a union() before computing loops
     bool                    				m_typed_slices = false;
 
+    // Span of layers containing slices of a region, indexed by region_id. Filled in by slice().
+    std::vector<LayerSpan>                  m_region_layers;
+    // Layers of which the perimeters or the infill are to be recalculated by the next make_perimeters() or infill().
+    LayerSpan                               m_perimeters_invalid_layers = AllLayers;
+    LayerSpan                               m_infill_invalid_layers     = AllLayers;
+    // Hash of the fill surfaces of each layer the infill was last generated from. Layers of which the fill surfaces
+    // were modified by prepare_infill() are re-filled, even if they are outside of m_infill_invalid_layers.
+    std::vector<uint64_t>                   m_infill_fill_surfaces_hash;
+
     std::vector<ExPolygons> slice_region(size_t region_id, const std::vector<float> &z, SlicingMode mode) const;
     std::vector<ExPolygons> slice_modifiers(size_t region_id, const std::vector<float> &z) const;
     std::vector<ExPolygons> slice_volumes(const std::vector<float> &z, SlicingMode mode, const std::vector<const ModelVolume*> &volumes) const;
@@ -2598,6 +2598,32 @@ void PrintConfigDef::init_sla_params()
     def->mode = comExpert;
     def->set_default_value(new ConfigOptionFloat(1.0));
 
+    def = this->add("layer_encoding", coEnum);
+    def->label = L("Layer image encoding");
+    def->tooltip = L("Encoding of the layer images stored in the exported archive. "
+                     "Prusa printers only accept PNG images. The run-length encodings "
+                     "are faster to export, encoding only the difference to the previous "
+                     "layer also gives much smaller archives of tall prints.");
+    def->enum_keys_map = &ConfigOptionEnum<SLALayerEncoding>::get_enum_values();
+    def->enum_values.push_back("png");
+    def->enum_values.push_back("png_fast");
+    def->enum_values.push_back("rle");
+    def->enum_values.push_back("delta_rle");
+    def->enum_labels.push_back(L("PNG"));
+    def->enum_labels.push_back(L("PNG, fast compression"));
+    def->enum_labels.push_back(L("Run-length encoded"));
+    def->enum_labels.push_back(L("Run-length encoded layer difference"));
+    def->mode = comExpert;
+    def->set_default_value(new ConfigOptionEnum<SLALayerEncoding>(slalePNG));
+
+    def = this->add("fast_rasterization", coBool);
+    def->label = L("Fast rasterization");
+    def->tooltip = L("Rasterize the layers in a single pass over their edges. It is faster, "
+                     "but the anti-aliased pixels along the edges may differ slightly "
+                     "from the default rasterization.");
+    def->mode = comExpert;
+    def->set_default_value(new ConfigOptionBool(false));
+
 
     // SLA Material settings.
     def = this->add("material_type", coString);
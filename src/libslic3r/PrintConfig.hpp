@@ -76,6 +76,13 @@ enum SLADisplayOrientation {
     sladoPortrait
 };
 
+enum SLALayerEncoding {
+    slalePNG,
+    slaleFastPNG,
+    slaleRLE,
+    slaleDeltaRLE
+};
+
 enum SLAPillarConnectionMode {
     slapcmZigZag,
     slapcmCross,
@@ -203,6 +210,17 @@ template<> inline const t_config_enum_values& ConfigOptionEnum<SLADisplayOrienta
     return keys_map;
 }
 
+template<> inline const t_config_enum_values& ConfigOptionEnum<SLALayerEncoding>::get_enum_values() {
+    static const t_config_enum_values keys_map = {
+        { "png",       slalePNG },
+        { "png_fast",  slaleFastPNG },
+        { "rle",       slaleRLE },
+        { "delta_rle", slaleDeltaRLE }
+    };
+
+    return keys_map;
+}
+
 template<> inline const t_config_enum_values& ConfigOptionEnum<SLAPillarConnectionMode>::get_enum_values() {
     static const t_config_enum_values keys_map = {
         {"zigzag", slapcmZigZag},
@@ -1232,6 +1250,8 @@ public:
     ConfigOptionFloat                       elefant_foot_compensation;
     ConfigOptionFloat                       elefant_foot_min_width;
     ConfigOptionFloat                       gamma_correction;
+    ConfigOptionEnum<SLALayerEncoding>      layer_encoding;
+    ConfigOptionBool                        fast_rasterization;
     ConfigOptionFloat                       fast_tilt_time;
     ConfigOptionFloat                       slow_tilt_time;
     ConfigOptionFloat                       area_fill;
@@ -1257,6 +1277,8 @@ protected:
         OPT_PTR(elefant_foot_compensation);
         OPT_PTR(elefant_foot_min_width);
         OPT_PTR(gamma_correction);
+        OPT_PTR(layer_encoding);
+        OPT_PTR(fast_rasterization);
         OPT_PTR(fast_tilt_time);
         OPT_PTR(slow_tilt_time);
         OPT_PTR(area_fill);
@@ -139,6 +139,16 @@ void PrintObject::slice()
                 	layer.lslices_bboxes.emplace_back(get_extents(expoly));
             }
         });
+    // Span of layers containing each region, so that a change of the region configuration invalidates just these layers.
+    m_region_layers.assign(this->region_volumes.size(), LayerSpan(0, 0));
+    for (size_t layer_idx = 0; layer_idx < m_layers.size(); ++ layer_idx)
+        for (size_t region_id = 0; region_id < m_region_layers.size(); ++ region_id)
+            if (! m_layers[layer_idx]->m_regions[region_id]->slices.empty()) {
+                LayerSpan &span = m_region_layers[region_id];
+                if (span.first == span.second)
+                    span.first = layer_idx;
+                span.second = layer_idx + 1;
+            }
     if (m_layers.empty())
         throw Slic3r::SlicingError("No layers were detected. You might want to repair your STL file(s) or check their size or thickness and retry.\n");    
     this->set_done(posSlice);
@@ -157,14 +167,19 @@ void PrintObject::make_perimeters()
 
     m_print->set_status(20, L("Generating perimeters"));
     BOOST_LOG_TRIVIAL(info) << "Generating perimeters..." << log_memory_info();
+
+    // Only a span of layers is recalculated if just the configuration of a region limited to these layers changed.
+    const size_t first_layer = std::min(m_perimeters_invalid_layers.first,  m_layers.size());
+    const size_t last_layer  = std::min(m_perimeters_invalid_layers.second, m_layers.size());
     
     // merge slices if they were split into types
     if (m_typed_slices) {
-        for (Layer *layer : m_layers) {
-            layer->merge_slices();
+        for (size_t layer_idx = first_layer; layer_idx < last_layer; ++ layer_idx) {
+            m_layers[layer_idx]->merge_slices();
             m_print->throw_if_canceled();
         }
-        m_typed_slices = false;
+        // The slices of the layers out of the span stay typed until they are classified again by detect_surfaces_type().
+        m_typed_slices = first_layer > 0 || last_layer < m_layers.size();
     }
     
     // compare each layer to the one below, and mark those slices needing
@@ -176,12 +191,13 @@ void PrintObject::make_perimeters()
     // hollow objects
     for (size_t region_id = 0; region_id < this->region_volumes.size(); ++ region_id) {
         const PrintRegion &region = *m_print->regions()[region_id];
-        if (! region.config().extra_perimeters || region.config().perimeters == 0 || region.config().fill_density == 0 || this->layer_count() < 2)
+        if (! region.config().extra_perimeters || region.config().perimeters == 0 || region.config().fill_density == 0 || this->layer_count() < 2 ||
+            first_layer >= std::min(last_layer, m_layers.size() - 1))
             continue;
 
         BOOST_LOG_TRIVIAL(debug) << "Generating extra perimeters for region " << region_id << " in parallel - start";
         tbb::parallel_for(
-            tbb::blocked_range<size_t>(0, m_layers.size() - 1),
+            tbb::blocked_range<size_t>(first_layer, std::min(last_layer, m_layers.size() - 1)),
             [this, &region, region_id](const tbb::blocked_range<size_t>& range) {
                 for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
                     m_print->throw_if_canceled();
@@ -239,7 +255,7 @@ void PrintObject::make_perimeters()
 
     BOOST_LOG_TRIVIAL(debug) << "Generating perimeters in parallel - start";
     tbb::parallel_for(
-        tbb::blocked_range<size_t>(0, m_layers.size()),
+        tbb::blocked_range<size_t>(first_layer, last_layer),
         [this](const tbb::blocked_range<size_t>& range) {
             for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
                 m_print->throw_if_canceled();
@@ -250,6 +266,12 @@ void PrintObject::make_perimeters()
     m_print->throw_if_canceled();
     BOOST_LOG_TRIVIAL(debug) << "Generating perimeters in parallel - end";
 
+    {
+        // Reset the span before the step is marked as done. If the step is invalidated in between, set_done() throws
+        // and the span contains the newly invalidated layers only.
+        tbb::mutex::scoped_lock lock(PrintObjectBase::state_mutex(m_print));
+        m_perimeters_invalid_layers = LayerSpan(0, 0);
+    }
     this->set_done(posPerimeters);
 }
 
@@ -368,6 +390,34 @@ void PrintObject::prepare_infill()
     this->set_done(posPrepareInfill);
 }
 
+// Hash of the fill surfaces of all regions of a layer, to find out whether prepare_infill() modified them.
+static uint64_t fill_surfaces_hash(const Layer &layer)
+{
+    uint64_t seed = 0;
+    auto combine = [&seed](uint64_t v) { seed ^= v + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2); };
+    auto combine_polygon = [&combine](const Polygon &polygon) {
+        combine(polygon.points.size());
+        for (const Point &pt : polygon.points) {
+            combine(uint64_t(pt.x()));
+            combine(uint64_t(pt.y()));
+        }
+    };
+    for (const LayerRegion *layerm : layer.regions()) {
+        combine(layerm->fill_surfaces.surfaces.size());
+        for (const Surface &surface : layerm->fill_surfaces.surfaces) {
+            combine(uint64_t(surface.surface_type));
+            combine(std::hash<double>()(surface.thickness));
+            combine(surface.thickness_layers);
+            combine(std::hash<double>()(surface.bridge_angle));
+            combine_polygon(surface.expolygon.contour);
+            combine(surface.expolygon.holes.size());
+            for (const Polygon &hole : surface.expolygon.holes)
+                combine_polygon(hole);
+        }
+    }
+    return seed;
+}
+
 void PrintObject::infill()
 {
     // prerequisites
@@ -376,13 +426,25 @@ void PrintObject::infill()
     if (this->set_started(posInfill)) {
         auto [adaptive_fill_octree, support_fill_octree] = this->prepare_adaptive_infill_data();
 
+        // Only the layers of an invalidated span and the layers with modified fill surfaces are re-filled.
+        // The adaptive infill octrees are built over the whole object, all layers are re-filled if they are used.
+        LayerSpan layers_invalid = m_infill_invalid_layers;
+        if (adaptive_fill_octree || support_fill_octree || m_infill_fill_surfaces_hash.size() != m_layers.size()) {
+            layers_invalid = AllLayers;
+            m_infill_fill_surfaces_hash.assign(m_layers.size(), 0);
+        }
+
         BOOST_LOG_TRIVIAL(debug) << "Filling layers in parallel - start";
         tbb::parallel_for(
             tbb::blocked_range<size_t>(0, m_layers.size()),
-            [this, &adaptive_fill_octree = adaptive_fill_octree, &support_fill_octree = support_fill_octree](const tbb::blocked_range<size_t>& range) {
+            [this, &layers_invalid, &adaptive_fill_octree = adaptive_fill_octree, &support_fill_octree = support_fill_octree](const tbb::blocked_range<size_t>& range) {
                 for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
                     m_print->throw_if_canceled();
-                    m_layers[layer_idx]->make_fills(adaptive_fill_octree.get(), support_fill_octree.get());
+                    uint64_t hash = fill_surfaces_hash(*m_layers[layer_idx]);
+                    if ((layer_idx >= layers_invalid.first && layer_idx < layers_invalid.second) || hash != m_infill_fill_surfaces_hash[layer_idx]) {
+                        m_layers[layer_idx]->make_fills(adaptive_fill_octree.get(), support_fill_octree.get());
+                        m_infill_fill_surfaces_hash[layer_idx] = hash;
+                    }
                 }
             }
         );
@@ -391,6 +453,11 @@ void PrintObject::infill()
         /*  we could free memory now, but this would make this step not idempotent
         ### $_->fill_surfaces->clear for map @{$_->regions}, @{$object->layers};
         */
+        {
+            // See make_perimeters().
+            tbb::mutex::scoped_lock lock(PrintObjectBase::state_mutex(m_print));
+            m_infill_invalid_layers = LayerSpan(0, 0);
+        }
         this->set_done(posInfill);
     }
 }
@@ -509,7 +576,7 @@ SupportLayerPtrs::const_iterator PrintObject::insert_support_layer(SupportLayerP
 
 // Called by Print::apply().
 // This method only accepts PrintObjectConfig and PrintRegionConfig option keys.
-bool PrintObject::invalidate_state_by_config_options(const std::vector<t_config_option_key> &opt_keys)
+bool PrintObject::invalidate_state_by_config_options(const std::vector<t_config_option_key> &opt_keys, const LayerSpan &layers)
 {
     if (opt_keys.empty())
         return false;
@@ -640,26 +707,54 @@ bool PrintObject::invalidate_state_by_config_options(const std::vector<t_config_
 
     sort_remove_duplicates(steps);
     for (PrintObjectStep step : steps)
-        invalidated |= this->invalidate_step(step);
+        invalidated |= this->invalidate_step(step, layers);
     return invalidated;
 }
 
-bool PrintObject::invalidate_step(PrintObjectStep step)
+bool PrintObject::invalidate_region_state_by_config_options(size_t region_id, const std::vector<t_config_option_key> &opt_keys)
+{
+    // Called by Print::apply() with the state mutex locked.
+    return this->invalidate_state_by_config_options(opt_keys,
+        this->is_step_done_unguarded(posSlice) && region_id < m_region_layers.size() ? m_region_layers[region_id] : AllLayers);
+}
+
+// Extend the span of invalid layers by another span of layers.
+static inline void extend_layer_span(PrintObject::LayerSpan &span, const PrintObject::LayerSpan &layers)
+{
+    if (layers.first >= layers.second)
+        return;
+    if (span.first >= span.second)
+        span = layers;
+    else {
+        span.first  = std::min(span.first,  layers.first);
+        span.second = std::max(span.second, layers.second);
+    }
+}
+
+bool PrintObject::invalidate_step(PrintObjectStep step, const LayerSpan &layers)
 {
 	bool invalidated = Inherited::invalidate_step(step);
     
     // propagate to dependent steps
+    // The spans of invalid layers are extended after the background processing was canceled by the invalidation.
     if (step == posPerimeters) {
 		invalidated |= this->invalidate_steps({ posPrepareInfill, posInfill, posIroning });
         invalidated |= m_print->invalidate_steps({ psSkirt, psBrim });
+        // The gap fill generated with the perimeters is copied into the infill, thus the infill is regenerated, too.
+        extend_layer_span(m_perimeters_invalid_layers, layers);
+        extend_layer_span(m_infill_invalid_layers, layers);
     } else if (step == posPrepareInfill) {
         invalidated |= this->invalidate_steps({ posInfill, posIroning });
+        extend_layer_span(m_infill_invalid_layers, layers);
     } else if (step == posInfill) {
         invalidated |= m_print->invalidate_steps({ psSkirt, psBrim });
+        extend_layer_span(m_infill_invalid_layers, layers);
     } else if (step == posSlice) {
 		invalidated |= this->invalidate_steps({ posPerimeters, posPrepareInfill, posInfill, posIroning, posSupportMaterial });
 		invalidated |= m_print->invalidate_steps({ psSkirt, psBrim });
         this->m_slicing_params.valid = false;
+        m_perimeters_invalid_layers = AllLayers;
+        m_infill_invalid_layers     = AllLayers;
     } else if (step == posSupportMaterial) {
         invalidated |= m_print->invalidate_steps({ psSkirt, psBrim });
         this->m_slicing_params.valid = false;
@@ -681,6 +776,8 @@ bool PrintObject::invalidate_all_steps()
 	// Then reset some of the depending values.
 	this->m_slicing_params.valid = false;
 	this->region_volumes.clear();
+    m_perimeters_invalid_layers = AllLayers;
+    m_infill_invalid_layers     = AllLayers;
 	return result;
 }
 
@@ -2123,38 +2220,47 @@ std::vector<ExPolygons> PrintObject::slice_support_volumes(const ModelVolumeType
 
 std::vector<ExPolygons> PrintObject::slice_volumes(const std::vector<float> &z, SlicingMode mode, const std::vector<const ModelVolume*> &volumes) const
 {
-    std::vector<ExPolygons> layers;
-    if (! volumes.empty()) {
-        // Compose mesh.
-        //FIXME better to perform slicing over each volume separately and then to use a Boolean operation to merge them.
-		TriangleMesh mesh(volumes.front()->mesh());
-        mesh.transform(volumes.front()->get_matrix(), true);
-		assert(mesh.repaired);
-		if (volumes.size() == 1 && mesh.repaired) {
-			//FIXME The admesh repair function may break the face connectivity, rather refresh it here as the slicing code relies on it.
-			stl_check_facets_exact(&mesh.stl);
-		}
-        for (size_t idx_volume = 1; idx_volume < volumes.size(); ++ idx_volume) {
-            const ModelVolume &model_volume = *volumes[idx_volume];
-            TriangleMesh vol_mesh(model_volume.mesh());
-            vol_mesh.transform(model_volume.get_matrix(), true);
-            mesh.merge(vol_mesh);
-        }
-        if (mesh.stl.stats.number_of_facets > 0) {
-            mesh.transform(m_trafo, true);
-            // apply XY shift
-            mesh.translate(- unscale<float>(m_center_offset.x()), - unscale<float>(m_center_offset.y()), 0);
-            // perform actual slicing
-            const Print *print = this->print();
-            auto callback = TriangleMeshSlicer::throw_on_cancel_callback_type([print](){print->throw_if_canceled();});
-            // TriangleMeshSlicer needs shared vertices, also this calls the repair() function.
-            mesh.require_shared_vertices();
-            TriangleMeshSlicer mslicer;
-            mslicer.init(&mesh, callback);
-			mslicer.slice(z, mode, float(m_config.slice_closing_radius.value), &layers, callback);
-            m_print->throw_if_canceled();
-        }
-    }
+    if (volumes.empty())
+        return std::vector<ExPolygons>();
+    if (volumes.size() == 1)
+        return this->slice_volume(z, mode, *volumes.front());
+
+    // Slice each volume separately, the volumes in parallel. The largest contour may only be chosen after the merge.
+    SlicingMode volume_mode = (mode == SlicingMode::PositiveLargestContour) ? SlicingMode::Positive : mode;
+    std::vector<std::vector<ExPolygons>> volume_layers(volumes.size());
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, volumes.size()),
+        [this, &z, volume_mode, &volumes, &volume_layers](const tbb::blocked_range<size_t>& range) {
+            for (size_t idx_volume = range.begin(); idx_volume < range.end(); ++ idx_volume)
+                volume_layers[idx_volume] = this->slice_volume(z, volume_mode, *volumes[idx_volume]);
+        });
+    m_print->throw_if_canceled();
+
+    // Merge the slices of the volumes with a Boolean union, the layers in parallel.
+    std::vector<ExPolygons> layers(z.size());
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, z.size()),
+        [this, mode, &volume_layers, &layers](const tbb::blocked_range<size_t>& range) {
+            for (size_t layer_id = range.begin(); layer_id < range.end(); ++ layer_id) {
+                m_print->throw_if_canceled();
+                ExPolygons &expolygons = layers[layer_id];
+                bool        merge      = false;
+                for (std::vector<ExPolygons> &this_layers : volume_layers)
+                    if (layer_id < this_layers.size() && ! this_layers[layer_id].empty()) {
+                        if (expolygons.empty())
+                            expolygons = std::move(this_layers[layer_id]);
+                        else {
+                            append(expolygons, std::move(this_layers[layer_id]));
+                            merge = true;
+                        }
+                    }
+                if (merge)
+                    expolygons = union_ex(expolygons);
+                if (mode == SlicingMode::PositiveLargestContour)
+                    keep_largest_contour_only(expolygons);
+            }
+        });
+    m_print->throw_if_canceled();
     return layers;
 }
 
@@ -2162,25 +2268,27 @@ std::vector<ExPolygons> PrintObject::slice_volume(const std::vector<float> &z, S
 {
     std::vector<ExPolygons> layers;
     if (! z.empty()) {
-	    // Compose mesh.
 	    //FIXME better to split the mesh into separate shells, perform slicing over each shell separately and then to use a Boolean operation to merge them.
-	    TriangleMesh mesh(volume.mesh());
-	    mesh.transform(volume.get_matrix(), true);
-		if (mesh.repaired) {
-			//FIXME The admesh repair function may break the face connectivity, rather refresh it here as the slicing code relies on it.
-			stl_check_facets_exact(&mesh.stl);
-		}
-	    if (mesh.stl.stats.number_of_facets > 0) {
-	        mesh.transform(m_trafo, true);
-	        // apply XY shift
-	        mesh.translate(- unscale<float>(m_center_offset.x()), - unscale<float>(m_center_offset.y()), 0);
+	    const TriangleMesh *mesh = &volume.mesh();
+	    if (mesh->stl.stats.number_of_facets > 0) {
+	        // The mesh is shared with the Model, it is sliced through the volume, object and XY shift transformation
+	        // without making a transformed copy. Only if the shared vertices are missing, a copy has to be made.
+	        TriangleMesh mesh_shared;
+	        if (! mesh->has_shared_vertices()) {
+	            mesh_shared = *mesh;
+	            if (mesh_shared.repaired) {
+	                //FIXME The admesh repair function may break the face connectivity, rather refresh it here as the slicing code relies on it.
+	                stl_check_facets_exact(&mesh_shared.stl);
+	            }
+	            mesh_shared.require_shared_vertices();
+	            mesh = &mesh_shared;
+	        }
+	        Transform3d trafo = Eigen::Translation3d(- unscale<double>(m_center_offset.x()), - unscale<double>(m_center_offset.y()), 0.) * m_trafo * volume.get_matrix();
 	        // perform actual slicing
 	        TriangleMeshSlicer mslicer;
 	        const Print *print = this->print();
 	        auto callback = TriangleMeshSlicer::throw_on_cancel_callback_type([print](){print->throw_if_canceled();});
-	        // TriangleMeshSlicer needs the shared vertices.
-	        mesh.require_shared_vertices();
-	        mslicer.init(&mesh, callback);
+	        mslicer.init(mesh, trafo, callback);
 	        mslicer.slice(z, mode, float(m_config.slice_closing_radius.value), &layers, callback);
 	        m_print->throw_if_canceled();
 	    }
@@ -5,9 +5,12 @@
 #include <tbb/mutex.h>
 #include <tbb/parallel_for.h>
 #include <tbb/parallel_reduce.h>
+#include <tbb/pipeline.h>
 
 #include <algorithm>
 #include <numeric>
+#include <type_traits>
+#include <utility>
 
 #include <libslic3r/libslic3r.h>
 
@@ -76,6 +79,52 @@ template<> struct _ccr<true>
             from, to, init, std::forward<MergeFn>(mergefn),
             [](typename I::value_type &i) { return i; }, granularity);
     }
+
+    // Compute fn(i) for every index in [from, to) in parallel and hand the
+    // results over to outfn(result, i) serially, in ascending index order.
+    // At most max_inflight results are alive at any given time, so the
+    // memory consumption does not depend on the size of the range.
+    // No more indices are started once stopfn() returns true, the results
+    // of the ones already started are still handed over to outfn.
+    template<class I, class Fn, class OutFn, class StopFn>
+    static IntegerOnly<I, void> for_each_ordered(I        from,
+                                                 I        to,
+                                                 Fn     &&fn,
+                                                 OutFn  &&outfn,
+                                                 size_t   max_inflight,
+                                                 StopFn &&stopfn)
+    {
+        using T = std::decay_t<std::invoke_result_t<Fn, I>>;
+        using Item = std::pair<I, T>;
+
+        I next = from;
+        tbb::parallel_pipeline(
+            std::max(max_inflight, size_t(1)),
+            tbb::make_filter<void, I>(
+                tbb::filter::serial_in_order,
+                [&next, to, &stopfn](tbb::flow_control &fc) -> I {
+                    if (next >= to || stopfn()) { fc.stop(); return to; }
+                    return next++;
+                }) &
+            tbb::make_filter<I, Item>(
+                tbb::filter::parallel,
+                [&fn](I i) { return Item{i, fn(i)}; }) &
+            tbb::make_filter<Item, void>(
+                tbb::filter::serial_in_order,
+                [&outfn](Item item) { outfn(std::move(item.second), item.first); }));
+    }
+
+    template<class I, class Fn, class OutFn>
+    static IntegerOnly<I, void> for_each_ordered(I        from,
+                                                 I        to,
+                                                 Fn     &&fn,
+                                                 OutFn  &&outfn,
+                                                 size_t   max_inflight)
+    {
+        for_each_ordered(from, to, std::forward<Fn>(fn),
+                         std::forward<OutFn>(outfn), max_inflight,
+                         [] { return false; });
+    }
 };
 
 template<> struct _ccr<false>
@@ -133,6 +182,27 @@ public:
         return reduce(from, to, init, std::forward<MergeFn>(mergefn),
                       [](typename I::value_type &i) { return i; });
     }
+
+    template<class I, class Fn, class OutFn, class StopFn>
+    static IntegerOnly<I, void> for_each_ordered(I        from,
+                                                 I        to,
+                                                 Fn     &&fn,
+                                                 OutFn  &&outfn,
+                                                 size_t   /*max_inflight*/,
+                                                 StopFn &&stopfn)
+    {
+        for (I i = from; i < to && !stopfn(); ++i) outfn(fn(i), i);
+    }
+
+    template<class I, class Fn, class OutFn>
+    static IntegerOnly<I, void> for_each_ordered(I       from,
+                                                 I       to,
+                                                 Fn    &&fn,
+                                                 OutFn &&outfn,
+                                                 size_t  /*max_inflight*/)
+    {
+        for (I i = from; i < to; ++i) outfn(fn(i), i);
+    }
 };
 
 using ccr = _ccr<USE_FULL_CONCURRENCY>;
@@ -16,11 +16,15 @@ class IndexedMesh::AABBImpl {
 private:
     AABBTreeIndirect::Tree3f m_tree;
 
+    // Collapsed four way tree used for the ray casts
+    AABBTreeIndirect::WideTree m_wide_tree;
+
 public:
     void init(const TriangleMesh& tm)
     {
         m_tree = AABBTreeIndirect::build_aabb_tree_over_indexed_triangle_set(
             tm.its.vertices, tm.its.indices);
+        m_wide_tree.build(m_tree);
     }
 
     void intersect_ray(const TriangleMesh& tm,
@@ -28,16 +32,26 @@ public:
     {
         AABBTreeIndirect::intersect_ray_first_hit(tm.its.vertices,
                                                   tm.its.indices,
-                                                  m_tree,
+                                                  m_wide_tree,
                                                   s, dir, hit);
     }
 
+    // First hits of a packet of rays traversed together
+    void intersect_rays(const TriangleMesh& tm,
+                        const Vec3d* s, const Vec3d* dirs, size_t n, igl::Hit* hits)
+    {
+        AABBTreeIndirect::intersect_rays_first_hit(tm.its.vertices,
+                                                   tm.its.indices,
+                                                   m_wide_tree,
+                                                   s, dirs, n, hits);
+    }
+
     void intersect_ray(const TriangleMesh& tm,
                        const Vec3d& s, const Vec3d& dir, std::vector<igl::Hit>& hits)
     {
         AABBTreeIndirect::intersect_ray_all_hits(tm.its.vertices,
                                                  tm.its.indices,
-                                                 m_tree,
+                                                 m_wide_tree,
                                                  s, dir, hits);
     }
 
@@ -149,6 +163,54 @@ IndexedMesh::query_ray_hit(const Vec3d &s, const Vec3d &dir) const
     return ret;
 }
 
+std::vector<IndexedMesh::hit_result>
+IndexedMesh::query_ray_hit(const std::vector<Vec3d> &sources,
+                           const std::vector<Vec3d> &dirs) const
+{
+    assert(sources.size() == dirs.size());
+
+    // Neighbouring rays are cast together as a packet, the packets are
+    // distributed among the threads.
+    static const constexpr size_t PacketSize = 16;
+
+    std::vector<hit_result> outs(sources.size(), hit_result(*this));
+    size_t npackets = (sources.size() + PacketSize - 1) / PacketSize;
+
+    ccr::for_each(size_t(0), npackets,
+                  [this, &sources, &dirs, &outs](size_t packet) {
+        size_t from = packet * PacketSize;
+        size_t n    = std::min(PacketSize, sources.size() - from);
+
+#ifdef SLIC3R_HOLE_RAYCASTER
+        if (! m_holes.empty()) {
+            for (size_t i = from; i < from + n; ++i)
+                outs[i] = filter_hits(query_ray_hits(sources[i], dirs[i]));
+
+            return;
+        }
+#endif
+
+        std::array<igl::Hit, PacketSize> hits;
+        m_aabb->intersect_rays(*m_tm, sources.data() + from, dirs.data() + from,
+                               n, hits.data());
+
+        for (size_t i = 0; i < n; ++i) {
+            assert(is_approx(dirs[from + i].norm(), 1.));
+            hit_result &ret = outs[from + i];
+            const igl::Hit &hit = hits[i];
+            ret.m_t = double(hit.t);
+            ret.m_dir = dirs[from + i];
+            ret.m_source = sources[from + i];
+            if (hit.id >= 0) {
+                ret.m_normal = this->normal_by_face_id(hit.id);
+                ret.m_face_id = hit.id;
+            }
+        }
+    });
+
+    return outs;
+}
+
 std::vector<IndexedMesh::hit_result>
 IndexedMesh::query_ray_hits(const Vec3d &s, const Vec3d &dir) const
 {
@@ -117,6 +117,12 @@ public:
     // Casting a ray on the mesh, returns the distance where the hit occures.
     hit_result query_ray_hit(const Vec3d &s, const Vec3d &dir) const;
     
+    // Casting a batch of rays on the mesh. The result for each ray is the
+    // same as query_ray_hit would return, the rays are cast in parallel and
+    // coherent rays stored next to each other are traversed together.
+    std::vector<hit_result> query_ray_hit(const std::vector<Vec3d> &sources,
+                                          const std::vector<Vec3d> &dirs) const;
+
     // Casts a ray on the mesh and returns all hits
     std::vector<hit_result> query_ray_hits(const Vec3d &s, const Vec3d &dir) const;
 
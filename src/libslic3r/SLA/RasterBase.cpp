@@ -2,6 +2,7 @@
 #define SLARASTER_CPP
 
 #include <functional>
+#include <algorithm>
 
 #include <libslic3r/SLA/RasterBase.hpp>
 #include <libslic3r/SLA/AGGRaster.hpp>
@@ -22,8 +23,9 @@ EncodedRaster PNGRasterEncoder::operator()(const void *ptr, size_t w, size_t h,
     std::vector<uint8_t> buf;
     size_t s = 0;
     
-    void *rawdata = tdefl_write_image_to_png_file_in_memory(
-        ptr, int(w), int(h), int(num_components), &s);
+    void *rawdata = tdefl_write_image_to_png_file_in_memory_ex(
+        ptr, int(w), int(h), int(num_components), &s,
+        mz_uint(compression_level), MZ_FALSE);
     
     // On error, data() will return an empty vector. No other info can be
     // retrieved from miniz anyway...
@@ -67,6 +69,150 @@ EncodedRaster PPMRasterEncoder::operator()(const void *ptr, size_t w, size_t h,
     return EncodedRaster(std::move(buf), "ppm");
 }
 
+namespace {
+
+const constexpr size_t RLE_HEADER_SIZE = 12;
+
+void write_u32(std::vector<uint8_t> &buf, uint32_t v)
+{
+    for (int i = 0; i < 4; ++i) buf.emplace_back(uint8_t(v >> (8 * i)));
+}
+
+uint32_t read_u32(const uint8_t *p)
+{
+    return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 |
+           uint32_t(p[3]) << 24;
+}
+
+void write_run(std::vector<uint8_t> &buf, size_t len, uint8_t val)
+{
+    while (len >= 0x80) {
+        buf.emplace_back(uint8_t(len & 0x7f) | 0x80);
+        len >>= 7;
+    }
+    buf.emplace_back(uint8_t(len));
+    buf.emplace_back(val);
+}
+
+// pixel(i) gives the value of the i-th pixel of the image to encode
+template<class PixelFn>
+EncodedRaster encode_rle(PixelFn &&pixel, size_t w, size_t h, char type)
+{
+    std::vector<uint8_t> buf;
+    buf.reserve(RLE_HEADER_SIZE + 2 * h);
+
+    buf.insert(buf.end(), {'R', 'L', 'E', uint8_t(type)});
+    write_u32(buf, uint32_t(w));
+    write_u32(buf, uint32_t(h));
+
+    for (size_t row = 0; row < h; ++row) {
+        size_t rowstart = row * w, col = 0;
+        while (col < w) {
+            uint8_t val = pixel(rowstart + col);
+            size_t  end = col + 1;
+            while (end < w && pixel(rowstart + end) == val) ++end;
+
+            write_run(buf, end - col, val);
+            col = end;
+        }
+    }
+
+    return EncodedRaster(std::move(buf), "rle");
+}
+
+} // namespace
+
+EncodedRaster RLERasterEncoder::operator()(const void *ptr, size_t w, size_t h,
+                                           size_t      num_components)
+{
+    auto px = static_cast<const uint8_t *>(ptr);
+    return encode_rle([px](size_t i) { return px[i]; }, w * num_components, h, 'K');
+}
+
+DeltaRLERasterEncoder::DeltaRLERasterEncoder()
+    : m_reference{std::make_shared<Reference>()}
+{}
+
+EncodedRaster DeltaRLERasterEncoder::operator()(const void *ptr,
+                                                size_t      w,
+                                                size_t      h,
+                                                size_t      num_components)
+{
+    auto px = static_cast<const uint8_t *>(ptr);
+    w *= num_components;
+
+    Reference &ref = *m_reference;
+    const uint8_t *rpx = ref.buf.data();
+
+    EncodedRaster ret;
+    if (ref.w == w && ref.h == h && !ref.buf.empty())
+        ret = encode_rle([px, rpx](size_t i) { return uint8_t(px[i] ^ rpx[i]); },
+                         w, h, 'D');
+    else
+        ret = encode_rle([px](size_t i) { return px[i]; }, w, h, 'K');
+
+    ref.buf.assign(px, px + w * h);
+    ref.w = w; ref.h = h;
+
+    return ret;
+}
+
+bool is_delta_rle(const void *data, size_t size)
+{
+    auto p = static_cast<const uint8_t *>(data);
+    return size >= RLE_HEADER_SIZE && std::equal(p, p + 4, "RLED");
+}
+
+bool decode_rle(const void *data, size_t size, const RasterBase::Resolution &res,
+                std::vector<uint8_t> &out, size_t &w, size_t &h)
+{
+    auto p = static_cast<const uint8_t *>(data);
+
+    if (size < RLE_HEADER_SIZE || !std::equal(p, p + 3, "RLE"))
+        return false;
+
+    bool delta = p[3] == 'D';
+    if (!delta && p[3] != 'K') return false;
+
+    size_t dw = read_u32(p + 4), dh = read_u32(p + 8);
+
+    if (dw != res.width_px || dh != res.height_px)
+        return false;
+
+    if (delta && (dw != w || dh != h || out.size() != dw * dh))
+        return false;
+
+    w = dw; h = dh;
+    if (!delta) out.assign(w * h, 0);
+
+    const uint8_t *it = p + RLE_HEADER_SIZE, *end = p + size;
+    for (size_t row = 0; row < h; ++row) {
+        uint8_t *dst = out.data() + row * w, *dstend = dst + w;
+
+        while (dst < dstend) {
+            size_t len = 0;
+            for (int shift = 0;; shift += 7) {
+                if (it == end || shift > 56) return false;
+                uint8_t b = *it++;
+                len |= size_t(b & 0x7f) << shift;
+                if (!(b & 0x80)) break;
+            }
+
+            if (it == end || len > size_t(dstend - dst)) return false;
+            uint8_t val = *it++;
+
+            if (delta) {
+                if (val) for (size_t i = 0; i < len; ++i) dst[i] ^= val;
+            } else
+                std::fill(dst, dst + len, val);
+
+            dst += len;
+        }
+    }
+
+    return true;
+}
+
 std::unique_ptr<RasterBase> create_raster_grayscale_aa(
     const RasterBase::Resolution &res,
     const RasterBase::PixelDim &  pxdim,
@@ -103,9 +103,49 @@ public:
 };
 
 struct PNGRasterEncoder {
+    // Deflate level from 0 (no compression) to 10, miniz default is 6.
+    // Level 1 is considerably faster at the cost of a bigger output.
+    int compression_level = 6;
+
+    EncodedRaster operator()(const void *ptr, size_t w, size_t h, size_t num_components);
+};
+
+// Run-length encoding of the rows of a grayscale image. Every row starts
+// a new run. The output starts with the "RLEK" magic, followed by the width
+// and height as 32 bit little endian integers and the runs stored as
+// a LEB128 encoded run length and the pixel value.
+struct RLERasterEncoder {
+    EncodedRaster operator()(const void *ptr, size_t w, size_t h, size_t num_components);
+};
+
+// Encodes the XOR difference to the previously encoded image with the same
+// run-length encoding as RLERasterEncoder ("RLED" magic). Consecutive layers
+// of a print are nearly identical, their difference is mostly zero and
+// encodes into a few runs per row. The first image, or any image with
+// a different size than its predecessor, is encoded as RLERasterEncoder does.
+// The previous image is shared by the copies of the encoder, so a single
+// instance has to be used for a sequence of layers, and from one thread.
+class DeltaRLERasterEncoder {
+    struct Reference { std::vector<uint8_t> buf; size_t w = 0, h = 0; };
+    shptr<Reference> m_reference;
+
+public:
+    DeltaRLERasterEncoder();
+
     EncodedRaster operator()(const void *ptr, size_t w, size_t h, size_t num_components);
 };
 
+// Decode an image created by RLERasterEncoder or DeltaRLERasterEncoder. For
+// the delta encoded ones, out, w and h have to hold the previously decoded
+// image. Returns false for invalid data, also if the reference is missing or
+// if the image does not have the expected resolution res. The size is checked
+// before anything is allocated, the header of a corrupt archive may be bogus.
+bool decode_rle(const void *data, size_t size, const RasterBase::Resolution &res,
+                std::vector<uint8_t> &out, size_t &w, size_t &h);
+
+// Tells whether the data was encoded as a difference to the previous image.
+bool is_delta_rle(const void *data, size_t size);
+
 struct PPMRasterEncoder {
     EncodedRaster operator()(const void *ptr, size_t w, size_t h, size_t num_components);
 };
@@ -1,4 +1,5 @@
 #include <limits>
+#include <algorithm>
 
 #include <libslic3r/SLA/Rotfinder.hpp>
 #include <libslic3r/SLA/Concurrency.hpp>
@@ -37,7 +38,7 @@ double find_ground_level(const TriangleMesh &mesh,
     };
 
     double zmin = std::numeric_limits<double>::max();
-    size_t granularity = vsize / threads;
+    size_t granularity = std::max<size_t>(1, vsize / threads);
     return ccr_par::reduce(size_t(0), vsize, zmin, minfn, accessfn, granularity);
 }
 
@@ -51,14 +52,6 @@ std::array<Vec3d, 3> get_triangle_vertices(const TriangleMesh &mesh,
             Vec3d{mesh.its.vertices[face(2)].cast<double>()}};
 }
 
-std::array<Vec3d, 3> get_transformed_triangle(const TriangleMesh &mesh,
-                                              const Transform3d & tr,
-                                              size_t              faceidx)
-{
-    const auto &tri = get_triangle_vertices(mesh, faceidx);
-    return {tr * tri[0], tr * tri[1], tr * tri[2]};
-}
-
 // Get area and normal of a triangle
 struct Facestats {
     Vec3d  normal;
@@ -77,12 +70,12 @@ struct Facestats {
 inline const Vec3d DOWN = {0., 0., -1.};
 constexpr double POINTS_PER_UNIT_AREA = 1.;
 
-// The score function for a particular face
-inline double get_score(const Facestats &fc)
+// The score function for a face with the given (already rotated) normal
+inline double get_score(const Vec3d &normal, double area)
 {
     // Simply get the angle (acos of dot product) between the face normal and
     // the DOWN vector.
-    double phi = 1. - std::acos(fc.normal.dot(DOWN)) / PI;
+    double phi = 1. - std::acos(std::clamp(normal.dot(DOWN), -1., 1.)) / PI;
 
     // Only consider faces that have have slopes below 90 deg:
     phi = phi * (phi > 0.5);
@@ -91,36 +84,122 @@ inline double get_score(const Facestats &fc)
     phi = phi * phi * phi;
 
     // Multiply with the area of the current face
-    return fc.area * POINTS_PER_UNIT_AREA * phi;
+    return area * POINTS_PER_UNIT_AREA * phi;
 }
 
+inline double get_score(const Facestats &fc)
+{
+    return get_score(fc.normal, fc.area);
+}
+
+// Normals and areas of the faces do not change with the rotation, they are
+// computed only once for all the rotations examined.
+struct FaceCache {
+    std::vector<Vec3d>  normals;
+    std::vector<double> areas;
+
+    explicit FaceCache(const TriangleMesh &mesh)
+        : normals(mesh.its.indices.size()), areas(mesh.its.indices.size())
+    {
+        ccr_par::for_each(size_t(0), normals.size(), [this, &mesh](size_t fi) {
+            Facestats fc{get_triangle_vertices(mesh, fi)};
+            normals[fi] = fc.normal;
+            areas[fi]   = fc.area;
+        }, 1024);
+    }
+
+    size_t size() const { return normals.size(); }
+};
+
+// Area weighted histogram of the face normals. The bins are the cells of
+// a cube map: the normals are projected onto the sides of a cube, each side
+// divided into Res x Res cells. Each bin is represented by the area weighted
+// mean of its normals and the sum of their areas. The score of a rotation
+// can then be estimated by rotating the bins instead of every face of the mesh.
+class NormalHistogram {
+public:
+    static const constexpr size_t Res = 16;
+
+private:
+    std::vector<Vec3d>  m_normals;
+    std::vector<double> m_areas;
+
+    static size_t bin_index(const Vec3d &n)
+    {
+        int ax = 0;
+        n.cwiseAbs().maxCoeff(&ax);
+        double a = std::abs(n(ax));
+        double u = n((ax + 1) % 3) / a, v = n((ax + 2) % 3) / a;
+        auto cell = [](double c) {
+            return std::min(size_t((c + 1.) * 0.5 * Res), Res - 1);
+        };
+
+        size_t side = 2 * size_t(ax) + (n(ax) < 0.);
+        return (side * Res + cell(u)) * Res + cell(v);
+    }
+
+public:
+    explicit NormalHistogram(const FaceCache &faces)
+    {
+        std::vector<Vec3d>  sums(6 * Res * Res, Vec3d::Zero());
+        std::vector<double> areas(sums.size(), 0.);
+
+        for (size_t fi = 0; fi < faces.size(); ++fi) {
+            const Vec3d &n = faces.normals[fi];
+            if (!n.allFinite() || faces.areas[fi] <= 0.) continue;
+
+            size_t bin = bin_index(n);
+            sums[bin] += faces.areas[fi] * n;
+            areas[bin] += faces.areas[fi];
+        }
+
+        for (size_t bin = 0; bin < sums.size(); ++bin)
+            if (areas[bin] > 0. && sums[bin].squaredNorm() > 0.) {
+                m_normals.emplace_back(sums[bin].normalized());
+                m_areas.emplace_back(areas[bin]);
+            }
+    }
+
+    // Estimate of the sum of get_score for all the rotated faces.
+    double score(const Transform3d &tr) const
+    {
+        Eigen::Matrix3d rot = tr.linear();
+        double ret = 0.;
+        for (size_t bin = 0; bin < m_normals.size(); ++bin)
+            ret += get_score(rot * m_normals[bin], m_areas[bin]);
+
+        return ret;
+    }
+};
+
 template<class AccessFn>
 double sum_score(AccessFn &&accessfn, size_t facecount, size_t Nthreads)
 {
     double initv     = 0.;
     auto   mergefn   = std::plus<double>{};
-    size_t grainsize = facecount / Nthreads;
+    size_t grainsize = std::max<size_t>(1, facecount / Nthreads);
     size_t from = 0, to = facecount;
 
     return ccr_par::reduce(from, to, initv, mergefn, accessfn, grainsize);
 }
 
 // Try to guess the number of support points needed to support a mesh
-double get_model_supportedness(const TriangleMesh &mesh, const Transform3d &tr)
+double get_model_supportedness(const FaceCache &faces, const Transform3d &tr)
 {
-    if (mesh.its.vertices.empty()) return std::nan("");
+    if (faces.size() == 0) return std::nan("");
 
-    auto accessfn = [&mesh, &tr](size_t fi) {
-        Facestats fc{get_transformed_triangle(mesh, tr, fi)};
-        return get_score(fc);
+    Eigen::Matrix3d rot = tr.linear();
+    auto accessfn = [&faces, &rot](size_t fi) {
+        return get_score(rot * faces.normals[fi], faces.areas[fi]);
     };
 
-    size_t facecount = mesh.its.indices.size();
+    size_t facecount = faces.size();
     size_t Nthreads  = std::thread::hardware_concurrency();
     return sum_score(accessfn, facecount, Nthreads) / facecount;
 }
 
 double get_model_supportedness_onfloor(const TriangleMesh &mesh,
+                                       const FaceCache &   faces,
                                        const Transform3d & tr)
 {
     if (mesh.its.vertices.empty()) return std::nan("");
@@ -130,14 +209,21 @@ double get_model_supportedness_onfloor(const TriangleMesh &mesh,
     double zmin = find_ground_level(mesh, tr, Nthreads);
     double zlvl = zmin + 0.1; // Set up a slight tolerance from z level
 
-    auto accessfn = [&mesh, &tr, zlvl](size_t fi) {
-        std::array<Vec3d, 3> tri = get_transformed_triangle(mesh, tr, fi);
-        Facestats fc{tri};
+    // Only the z coordinates of the vertices are needed
+    Eigen::Matrix3d rot  = tr.linear();
+    Vec3d           zrow = tr.linear().row(Z).transpose();
+    double          zoff = tr.translation().z();
+
+    auto accessfn = [&mesh, &faces, &rot, &zrow, zoff, zlvl](size_t fi) {
+        const auto &face = mesh.its.indices[fi];
+        auto below = [&mesh, &zrow, zoff, zlvl](int vi) {
+            return zrow.dot(mesh.its.vertices[vi].cast<double>()) + zoff <= zlvl;
+        };
 
-        if (tri[0].z() <= zlvl && tri[1].z() <= zlvl && tri[2].z() <= zlvl)
-            return -fc.area * POINTS_PER_UNIT_AREA;
+        if (below(face(0)) && below(face(1)) && below(face(2)))
+            return -faces.areas[fi] * POINTS_PER_UNIT_AREA;
 
-        return get_score(fc);
+        return get_score(rot * faces.normals[fi], faces.areas[fi]);
     };
 
     size_t facecount = mesh.its.indices.size();
@@ -177,7 +263,7 @@ std::array<double, N> find_min_score(Fn &&fn, It from, It to, StopCond &&stopfn)
         if (stopfn()) return;
 
         scores[i] = fn(*(from + i));
-    }, dist / Nthreads);
+    }, std::max<size_t>(1, dist / Nthreads));
 
     auto it = std::min_element(scores.begin(), scores.end());
 
@@ -238,6 +324,88 @@ std::vector<XYRotation> get_chull_rotations(const TriangleMesh &mesh, size_t max
     return ret;
 }
 
+// Search the rotation of a model elevated on supports. The grid search is
+// done with the score estimated from the normal histogram, which does not
+// depend on the size of the mesh. The best few grid points are then scored
+// exactly and the best one of them is refined on a finer grid around it.
+// The exact scores are costly, their count is derived from max_tries as well,
+// so that a low max_tries bounds the run time.
+template<class StatusFn, class StopCond>
+XYRotation find_best_rotation_elevated(const FaceCache &faces,
+                                       unsigned         max_tries,
+                                       StatusFn &&      statusfn,
+                                       StopCond &&      stopcond)
+{
+    static const constexpr size_t MAX_CANDIDATES = 8;
+    static const constexpr size_t MAX_REFINE_GRIDSIZE = 9;
+
+    // About a tenth of the tries is scored exactly, which is the 8 candidates
+    // and the 9 x 9 refinement grid for 1000 tries.
+    const size_t candidates_max = std::clamp<size_t>(max_tries / 100, 1, MAX_CANDIDATES);
+    const size_t refine_gridsize = std::clamp<size_t>(size_t(std::sqrt(max_tries / 10)), 1, MAX_REFINE_GRIDSIZE);
+
+    XYRotation rot = {0., 0.};
+
+    NormalHistogram histogram{faces};
+    double facecount = double(faces.size());
+
+    auto exactfn = [&faces](const XYRotation &rot) {
+        return get_model_supportedness(faces, to_transform3d(rot));
+    };
+
+    // Preparing the optimizer.
+    size_t gridsize = std::sqrt(max_tries); // 2D grid has gridsize^2 calls
+    opt::Optimizer<opt::AlgBruteForce> solver(opt::StopCriteria{}
+                                                .max_iterations(max_tries)
+                                                .stop_condition(stopcond),
+                                              gridsize);
+
+    // We are searching rotations around only two axes x, y. Thus the
+    // problem becomes a 2 dimensional optimization task.
+    // We can specify the bounds for a dimension in the following way:
+    auto bounds = opt::bounds({ {-PI, PI}, {-PI, PI} });
+
+    // The grid search is sequential, the scores can be collected
+    std::vector<std::pair<double, XYRotation>> scores;
+    scores.reserve(max_tries);
+
+    solver.to_min().optimize(
+        [&histogram, &statusfn, &scores, facecount] (const XYRotation &rot)
+        {
+            statusfn();
+            double score = histogram.score(to_transform3d(rot)) / facecount;
+            scores.emplace_back(score, rot);
+            return score;
+        }, opt::initvals({0., 0.}), bounds);
+
+    auto ncand = std::min(candidates_max, scores.size());
+    std::partial_sort(scores.begin(), scores.begin() + ncand, scores.end(),
+                      [](const auto &a, const auto &b) { return a.first < b.first; });
+
+    std::vector<XYRotation> candidates;
+    for (size_t i = 0; i < ncand; ++i) candidates.emplace_back(scores[i].second);
+
+    if (candidates.empty()) return rot;
+
+    rot = find_min_score<2>(exactfn, candidates.begin(), candidates.end(), stopcond);
+
+    // Refine within one step of the coarse grid around the best candidate
+    if (gridsize > 1 && refine_gridsize > 1 && !stopcond()) {
+        double step = 2 * PI / (gridsize - 1);
+        opt::Optimizer<opt::AlgBruteForce> refiner(
+            opt::StopCriteria{}.stop_condition(stopcond), refine_gridsize);
+
+        auto result = refiner.to_min().optimize(
+            exactfn, opt::initvals({rot[0], rot[1]}),
+            opt::bounds({ {rot[0] - step, rot[0] + step},
+                          {rot[1] - step, rot[1] + step} }));
+
+        if (result.score < exactfn(rot)) rot = result.optimum;
+    }
+
+    return rot;
+}
+
 Vec2d find_best_rotation(const SLAPrintObject &        po,
                          float                         accuracy,
                          std::function<void(unsigned)> statuscb,
@@ -267,6 +435,8 @@ Vec2d find_best_rotation(const SLAPrintObject &        po,
         statuscb(unsigned(++status * 100.0/max_tries) );
     };
 
+    FaceCache faces{mesh};
+
     // Different search methods have to be used depending on the model elevation
     if (is_on_floor(po)) {
 
@@ -276,35 +446,15 @@ Vec2d find_best_rotation(const SLAPrintObject &        po,
         // If the model can be placed on the bed directly, we only need to
         // check the 3D convex hull face rotations.
 
-        auto objfn = [&mesh, &statusfn](const XYRotation &rot) {
+        auto objfn = [&mesh, &faces, &statusfn](const XYRotation &rot) {
             statusfn();
             Transform3d tr = to_transform3d(rot);
-            return get_model_supportedness_onfloor(mesh, tr);
+            return get_model_supportedness_onfloor(mesh, faces, tr);
         };
 
         rot = find_min_score<2>(objfn, inputs.begin(), inputs.end(), stopcond);
     } else {
-        // Preparing the optimizer.
-        size_t gridsize = std::sqrt(max_tries); // 2D grid has gridsize^2 calls
-        opt::Optimizer<opt::AlgBruteForce> solver(opt::StopCriteria{}
-                                                    .max_iterations(max_tries)
-                                                    .stop_condition(stopcond),
-                                                  gridsize);
-
-        // We are searching rotations around only two axes x, y. Thus the
-        // problem becomes a 2 dimensional optimization task.
-        // We can specify the bounds for a dimension in the following way:
-        auto bounds = opt::bounds({ {-PI, PI}, {-PI, PI} });
-
-        auto result = solver.to_min().optimize(
-            [&mesh, &statusfn] (const XYRotation &rot)
-            {
-                statusfn();
-                return get_model_supportedness(mesh, to_transform3d(rot));
-            }, opt::initvals({0., 0.}), bounds);
-
-        // Save the result and fck off
-        rot = result.optimum;
+        rot = find_best_rotation_elevated(faces, max_tries, statusfn, stopcond);
     }
 
     return {rot[0], rot[1]};
@@ -315,8 +465,30 @@ double get_model_supportedness(const SLAPrintObject &po, const Transform3d &tr)
     TriangleMesh mesh = po.model_object()->raw_mesh();
     mesh.require_shared_vertices();
 
-    return is_on_floor(po) ? get_model_supportedness_onfloor(mesh, tr) :
-                             get_model_supportedness(mesh, tr);
+    FaceCache faces{mesh};
+    return is_on_floor(po) ? get_model_supportedness_onfloor(mesh, faces, tr) :
+                             get_model_supportedness(faces, tr);
+}
+
+Vec2d find_best_rotation_elevated(const TriangleMesh &mesh,
+                                  unsigned            max_tries,
+                                  std::function<bool()> stopcond)
+{
+    TriangleMesh m = mesh;
+    m.require_shared_vertices();
+
+    FaceCache faces{m};
+    XYRotation rot = find_best_rotation_elevated(faces, max_tries, [] {}, stopcond);
+
+    return {rot[0], rot[1]};
+}
+
+double get_model_supportedness(const TriangleMesh &mesh, const Transform3d &tr)
+{
+    TriangleMesh m = mesh;
+    m.require_shared_vertices();
+
+    return get_model_supportedness(FaceCache{m}, tr);
 }
 
 }} // namespace Slic3r::sla
@@ -9,6 +9,7 @@
 namespace Slic3r {
 
 class SLAPrintObject;
+class TriangleMesh;
 
 namespace sla {
 
@@ -37,6 +38,25 @@ Vec2d find_best_rotation(
 double get_model_supportedness(const SLAPrintObject &mesh,
                                const Transform3d & tr);
 
+/**
+  * The search find_best_rotation() does for a model elevated on supports.
+  *
+  * The rotations of a grid of max_tries points are scored by the histogram
+  * of the face normals, only the best few of them exactly. The number of the
+  * exactly scored rotations is proportional to max_tries as well.
+  *
+  * @return Returns the rotations around the x and y axes.
+  */
+Vec2d find_best_rotation_elevated(
+        const TriangleMesh &mesh,
+        unsigned max_tries,
+        std::function<bool()> stopcond = [] () { return false; }
+        );
+
+// The score of a rotated mesh elevated on supports.
+double get_model_supportedness(const TriangleMesh &mesh,
+                               const Transform3d & tr);
+
 } // namespace sla
 } // namespace Slic3r
 
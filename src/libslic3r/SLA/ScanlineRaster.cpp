@@ -0,0 +1,318 @@
+#include <libslic3r/SLA/ScanlineRaster.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#include <libnest2d/backends/clipper/clipper_polygon.hpp>
+
+namespace Slic3r { namespace sla {
+
+namespace {
+
+inline Vec2d raw_coords(const Point &p) { return {double(p.x()), double(p.y())}; }
+inline Vec2d raw_coords(const ClipperLib::IntPoint &p) { return {double(p.X), double(p.Y)}; }
+
+} // namespace
+
+RasterGrayscaleScanline::RasterGrayscaleScanline(const Resolution &res,
+                                                 const PixelDim &  pd,
+                                                 const Trafo &     trafo,
+                                                 double            gamma)
+    : m_resolution(res)
+    , m_pxdim_scaled(SCALING_FACTOR / pd.w_mm, SCALING_FACTOR / pd.h_mm)
+    , m_trafo(trafo)
+    , m_buf(res.pixels(), 0)
+{
+    // Same mapping as agg::gamma_power and agg::gamma_threshold(.5) give for
+    // the 8 bit coverage values in the AGG based raster.
+    for (size_t i = 0; i < m_gamma_lut.size(); ++i) {
+        double v = double(i) / 255.;
+        double g = gamma > 0. ? std::pow(v, gamma) : (v < .5 ? 0. : 1.);
+        m_gamma_lut[i] = uint8_t(std::lround(g * 255.));
+    }
+}
+
+RasterBase::PixelDim RasterGrayscaleScanline::pixel_dimensions() const
+{
+    return {SCALING_FACTOR / m_pxdim_scaled.w_mm,
+            SCALING_FACTOR / m_pxdim_scaled.h_mm};
+}
+
+template<class PointVec>
+int RasterGrayscaleScanline::add_contour(const PointVec &pts, int orientation)
+{
+    if (pts.size() < 3) return orientation;
+
+    double w = double(m_resolution.width_px);
+    double h = double(m_resolution.height_px);
+
+    // The same transformation as the AGG based raster applies to its paths.
+    auto to_fixed = [this, w, h](const Vec2d &p) {
+        double px = p.x() * m_pxdim_scaled.w_mm;
+        double py = p.y() * m_pxdim_scaled.h_mm;
+
+        if (m_trafo.flipXY) {
+            px = p.y() * m_pxdim_scaled.h_mm;
+            py = p.x() * m_pxdim_scaled.w_mm;
+        }
+
+        px += m_trafo.center_x * m_pxdim_scaled.w_mm;
+        py += m_trafo.center_y * m_pxdim_scaled.h_mm;
+
+        if (m_trafo.mirror_x) px = w - px;
+        if (m_trafo.mirror_y) py = h - py;
+
+        return Vec2i64(std::llround(px * SubpixelScale),
+                       std::llround(py * SubpixelScale));
+    };
+
+    size_t  first = m_edges.size();
+    Vec2i64 prev  = to_fixed(raw_coords(pts.back()));
+    double  area  = 0.;
+
+    for (const auto &pt : pts) {
+        Vec2i64 p = to_fixed(raw_coords(pt));
+        area += double(prev.x()) * double(p.y()) - double(p.x()) * double(prev.y());
+
+        if (p.y() > prev.y())
+            m_edges.push_back({prev.x(), prev.y(), p.x(), p.y(), 1});
+        else if (p.y() < prev.y())
+            m_edges.push_back({p.x(), p.y(), prev.x(), prev.y(), -1});
+
+        prev = p;
+    }
+
+    // Make the contours of all the polygons wind the same way, so that
+    // overlapping polygons are united.
+    if (orientation == 0) orientation = area < 0. ? -1 : 1;
+
+    if (orientation < 0)
+        for (size_t i = first; i < m_edges.size(); ++i)
+            m_edges[i].winding = -m_edges[i].winding;
+
+    m_dirty = true;
+
+    return orientation;
+}
+
+void RasterGrayscaleScanline::draw(const ExPolygon &poly)
+{
+    int o = add_contour(poly.contour.points, 0);
+    for (const Polygon &hole : poly.holes) add_contour(hole.points, o);
+}
+
+void RasterGrayscaleScanline::draw(const ClipperLib::Polygon &poly)
+{
+    int o = add_contour(poly.Contour, 0);
+    for (const ClipperLib::Path &hole : poly.Holes) add_contour(hole, o);
+}
+
+void RasterGrayscaleScanline::clear()
+{
+    m_edges.clear();
+    if (!m_blank) std::fill(m_buf.begin(), m_buf.end(), uint8_t(0));
+    m_dirty = false;
+    m_blank = true;
+}
+
+const std::vector<uint8_t> &RasterGrayscaleScanline::pixels() const
+{
+    if (m_dirty) rasterize();
+    return m_buf;
+}
+
+EncodedRaster RasterGrayscaleScanline::encode(RasterEncoder encoder) const
+{
+    return encoder(pixels().data(), m_resolution.width_px,
+                   m_resolution.height_px, 1);
+}
+
+uint8_t RasterGrayscaleScanline::read_pixel(size_t col, size_t row) const
+{
+    return pixels()[row * m_resolution.width_px + col];
+}
+
+void RasterGrayscaleScanline::accumulate_row(int32_t *cover,
+                                             int64_t  xa,
+                                             int64_t  ya,
+                                             int64_t  xb,
+                                             int64_t  yb,
+                                             int      winding) const
+{
+    const int64_t W = int64_t(m_resolution.width_px) << SubpixelShift;
+
+    if (ya == yb || (xa >= W && xb >= W)) return;
+
+    // Whatever is left of the raster covers the row from its first pixel.
+    if (xa <= 0 && xb <= 0) {
+        cover[0] += int32_t(winding * (yb - ya) * 2 * SubpixelScale);
+        return;
+    }
+
+    // Split the segment at the borders of the raster.
+    for (int64_t bx : {int64_t(0), W}) {
+        if ((xa < bx && xb > bx) || (xa > bx && xb < bx)) {
+            int64_t ym = ya + (yb - ya) * (bx - xa) / (xb - xa);
+            accumulate_row(cover, xa, ya, bx, ym, winding);
+            accumulate_row(cover, bx, ym, xb, yb, winding);
+            return;
+        }
+    }
+
+    // Walk the columns from left to right, the area is symmetric in the
+    // x coordinates of a piece, only the sign of its height matters.
+    int64_t xl = xa, yl = ya, xr = xb, yr = yb;
+    int64_t w  = winding;
+    if (xl > xr) { std::swap(xl, xr); std::swap(yl, yr); w = -w; }
+
+    if (xl == xr) {
+        int64_t c  = xl >> SubpixelShift;
+        int64_t fx = xl - (c << SubpixelShift);
+        int64_t d  = w * (yr - yl);
+        cover[c]     += int32_t(d * (2 * (SubpixelScale - fx)));
+        cover[c + 1] += int32_t(d * 2 * fx);
+        return;
+    }
+
+    int64_t x = xl, y = yl;
+    int64_t clast = (xr - 1) >> SubpixelShift;
+    for (int64_t c = xl >> SubpixelShift; c <= clast; ++c) {
+        int64_t nx  = std::min(xr, (c + 1) << SubpixelShift);
+        int64_t ny  = nx == xr ? yr : yl + (yr - yl) * (nx - xl) / (xr - xl);
+        int64_t fx0 = x - (c << SubpixelShift), fx1 = nx - (c << SubpixelShift);
+        int64_t d   = w * (ny - y);
+
+        cover[c]     += int32_t(d * (2 * SubpixelScale - fx0 - fx1));
+        cover[c + 1] += int32_t(d * (fx0 + fx1));
+
+        x = nx; y = ny;
+    }
+}
+
+void RasterGrayscaleScanline::rasterize() const
+{
+    const auto W = int64_t(m_resolution.width_px);
+    const auto H = int64_t(m_resolution.height_px);
+    const auto B = int64_t(BandHeight);
+
+    if (!m_blank) std::fill(m_buf.begin(), m_buf.end(), uint8_t(0));
+    m_dirty = false;
+    m_blank = m_edges.empty();
+
+    if (m_edges.empty() || W == 0 || H == 0) return;
+
+    // The edge table, sorted by the top end of the edges.
+    std::vector<const Edge *> sorted;
+    sorted.reserve(m_edges.size());
+    for (const Edge &e : m_edges) sorted.emplace_back(&e);
+    std::sort(sorted.begin(), sorted.end(),
+              [](const Edge *a, const Edge *b) { return a->y0 < b->y0; });
+
+    // Area of a fully covered pixel in the units of the cover buffer.
+    const int32_t full_cover = 2 * SubpixelScale * SubpixelScale;
+
+    // Each row of the band holds the differences of the pixel coverage,
+    // the prefix sum along the row gives the covered area of the pixels.
+    // The range of the modified cells is tracked for every row of the band.
+    const int64_t stride = W + 2;
+    std::vector<int32_t>      band(size_t(stride * B), 0);
+    std::vector<int64_t>      rowmin(size_t(B), stride), rowmax(size_t(B), -1);
+    std::vector<const Edge *> active;
+
+    size_t next = 0;
+    for (int64_t brow = 0; brow < H; brow += B) {
+        const int64_t bend = std::min(brow + B, H);
+        const int64_t ytop = brow << SubpixelShift;
+        const int64_t ybot = bend << SubpixelShift;
+
+        active.erase(std::remove_if(active.begin(), active.end(),
+                                    [ytop](const Edge *e) { return e->y1 <= ytop; }),
+                     active.end());
+
+        while (next < sorted.size() && sorted[next]->y0 < ybot) {
+            if (sorted[next]->y1 > ytop) active.emplace_back(sorted[next]);
+            ++next;
+        }
+
+        if (active.empty()) {
+            if (next == sorted.size()) break;
+            continue;
+        }
+
+        for (const Edge *e : active) {
+            int64_t ys = std::max(e->y0, ytop), ye = std::min(e->y1, ybot);
+            if (ys >= ye) continue;
+
+            auto x_at = [e](int64_t y) {
+                if (y == e->y0) return e->x0;
+                if (y == e->y1) return e->x1;
+                return e->x0 + (e->x1 - e->x0) * (y - e->y0) / (e->y1 - e->y0);
+            };
+
+            int64_t y = ys, x = x_at(ys);
+            while (y < ye) {
+                int64_t row = y >> SubpixelShift;
+                int64_t ny  = std::min(ye, (row + 1) << SubpixelShift);
+                int64_t nx  = x_at(ny);
+
+                accumulate_row(band.data() + (row - brow) * stride, x, y, nx, ny,
+                               e->winding);
+
+                auto r = size_t(row - brow);
+                int64_t cmin = std::min(x, nx) >> SubpixelShift;
+                int64_t cmax = (std::max(x, nx) >> SubpixelShift) + 1;
+                rowmin[r] = std::min(rowmin[r], std::clamp(cmin, int64_t(0), W));
+                rowmax[r] = std::max(rowmax[r], std::clamp(cmax, int64_t(0), W + 1));
+
+                x = nx; y = ny;
+            }
+        }
+
+        for (int64_t row = brow; row < bend; ++row) {
+            auto r = size_t(row - brow);
+            if (rowmin[r] > rowmax[r]) continue;
+
+            int32_t *cover = band.data() + r * stride;
+            uint8_t *out   = m_buf.data() + row * W;
+            int32_t  acc   = 0;
+            int64_t  end   = std::min(rowmax[r] + 1, W);
+
+            auto px = [this, full_cover](int32_t acc) {
+                int32_t v = std::min(std::abs(acc), full_cover);
+                return m_gamma_lut[(v * 255 + full_cover / 2) / full_cover];
+            };
+
+            // Left of the first modified cell the coverage is zero. Runs of
+            // cells not modified by any edge, like the interior of polygons
+            // and everything right of the last edge, have constant coverage
+            // and are filled at once.
+            for (int64_t x = rowmin[r]; x < W;) {
+                acc += cover[x];
+                out[x] = px(acc);
+                ++x;
+
+                int64_t nx = std::find_if(cover + x, cover + end,
+                                          [](int32_t c) { return c != 0; }) - cover;
+                if (nx == end) nx = W;
+
+                if (acc != 0) std::fill(out + x, out + nx, px(acc));
+                x = nx;
+            }
+
+            std::fill(cover + rowmin[r], cover + std::min(rowmax[r] + 1, stride), 0);
+            rowmin[r] = stride;
+            rowmax[r] = -1;
+        }
+    }
+}
+
+uqptr<RasterBase> create_raster_grayscale_scanline(
+    const RasterBase::Resolution &res,
+    const RasterBase::PixelDim &  pxdim,
+    double                        gamma,
+    const RasterBase::Trafo &     tr)
+{
+    return std::make_unique<RasterGrayscaleScanline>(res, pxdim, tr, gamma);
+}
+
+}} // namespace Slic3r::sla
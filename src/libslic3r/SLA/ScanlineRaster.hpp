@@ -0,0 +1,97 @@
+#ifndef SLA_SCANLINERASTER_HPP
+#define SLA_SCANLINERASTER_HPP
+
+#include <libslic3r/SLA/RasterBase.hpp>
+
+namespace Slic3r { namespace sla {
+
+/*
+ * Grayscale raster specialised for SLA layers. The drawn polygons are only
+ * converted to a list of edges, the whole layer is rasterized in a single
+ * pass once the pixels are needed (encode or read_pixel). The edges are
+ * activated in bands of rows from a table sorted by their top end, and each
+ * active edge accumulates its exact signed area coverage into a dense band
+ * buffer with integer fixed-point arithmetic. A prefix sum along the rows of
+ * the band then gives the pixel coverage. There is no per polygon path
+ * building, cell sorting or scanline blending as in the AGG based raster.
+ *
+ * The polygons of a layer are united (the accumulated winding is clamped),
+ * which is what drawing them one by one does with the AGG based raster,
+ * apart from the anti-aliased pixels where polygons touch each other.
+ */
+class RasterGrayscaleScanline: public RasterBase {
+public:
+    static const constexpr int SubpixelShift = 8;
+    static const constexpr int SubpixelScale = 1 << SubpixelShift;
+
+    // Number of rows rasterized at once.
+    static const constexpr size_t BandHeight = 32;
+
+    // If gamma is zero, thresholding will be performed which disables AA.
+    RasterGrayscaleScanline(const Resolution &res,
+                            const PixelDim &  pd,
+                            const Trafo &     trafo,
+                            double            gamma = 1.);
+
+    void draw(const ExPolygon &poly) override;
+    void draw(const ClipperLib::Polygon &poly) override;
+
+    Resolution resolution() const override { return m_resolution; }
+    PixelDim   pixel_dimensions() const override;
+    Trafo      trafo() const override { return m_trafo; }
+
+    EncodedRaster encode(RasterEncoder encoder) const override;
+
+    uint8_t read_pixel(size_t col, size_t row) const;
+
+    void clear();
+
+private:
+    // Edge in fixed-point pixel coordinates, always pointing downwards
+    // (y0 < y1). The original direction is kept in the winding contribution.
+    struct Edge {
+        int64_t x0, y0, x1, y1;
+        int     winding;
+    };
+
+    Resolution m_resolution;
+    PixelDim   m_pxdim_scaled; // used for scaled coordinate polygons
+    Trafo      m_trafo;
+
+    std::array<uint8_t, 256> m_gamma_lut;
+
+    std::vector<Edge> m_edges;
+
+    // The pixels are produced lazily from the collected edges.
+    mutable std::vector<uint8_t> m_buf;
+    mutable bool                 m_dirty = false;
+    mutable bool                 m_blank = true;
+
+    // Returns the winding multiplier used for the contour. If orientation
+    // is zero, it is chosen so that the contour winds positively.
+    template<class PointVec>
+    int add_contour(const PointVec &pts, int orientation);
+
+    const std::vector<uint8_t> &pixels() const;
+
+    void rasterize() const;
+
+    // Accumulate the signed area coverage of a line segment lying within
+    // a single pixel row into the cover array of that row.
+    void accumulate_row(int32_t *cover,
+                        int64_t  xa,
+                        int64_t  ya,
+                        int64_t  xb,
+                        int64_t  yb,
+                        int      winding) const;
+};
+
+uqptr<RasterBase> create_raster_grayscale_scanline(
+    const RasterBase::Resolution &res,
+    const RasterBase::PixelDim &  pxdim,
+    double                        gamma = 1.0,
+    const RasterBase::Trafo &     tr    = {});
+
+}} // namespace Slic3r::sla
+
+#endif // SLA_SCANLINERASTER_HPP
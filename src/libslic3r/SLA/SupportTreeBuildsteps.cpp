@@ -207,51 +207,62 @@ IndexedMesh::hit_result SupportTreeBuildsteps::pinhead_mesh_intersect(
 
     // We will shoot multiple rays from the head pinpoint in the direction
     // of the pinhead robe (side) surface. The result will be the smallest
-    // hit distance.
-
-    ccr::for_each(size_t(0), hits.size(),
-                  [&m, &rings, sd, &hits](size_t i) {
-
-       // Point on the circle on the pin sphere
-       Vec3d ps = rings.pinring(i);
-       // This is the point on the circle on the back sphere
-       Vec3d p = rings.backring(i);
-
-       auto &hit = hits[i];
-
-       // Point ps is not on mesh but can be inside or
-       // outside as well. This would cause many problems
-       // with ray-casting. To detect the position we will
-       // use the ray-casting result (which has an is_inside
-       // predicate).
-
-       Vec3d n = (p - ps).normalized();
-       auto  q = m.query_ray_hit(ps + sd * n, n);
-
-       if (q.is_inside()) { // the hit is inside the model
-           if (q.distance() > rings.rpin) {
-               // If we are inside the model and the hit
-               // distance is bigger than our pin circle
-               // diameter, it probably indicates that the
-               // support point was already inside the
-               // model, or there is really no space
-               // around the point. We will assign a zero
-               // hit distance to these cases which will
-               // enforce the function return value to be
-               // an invalid ray with zero hit distance.
-               // (see min_element at the end)
-               hit = HitResult(0.0);
-           } else {
-               // re-cast the ray from the outside of the
-               // object. The starting point has an offset
-               // of 2*safety_distance because the
-               // original ray has also had an offset
-               auto q2 = m.query_ray_hit(ps + (q.distance() + 2 * sd) * n, n);
-               hit = q2;
-           }
-       } else
-           hit = q;
-    });
+    // hit distance. The rays are cast as a single batch.
+
+    std::vector<Vec3d> sources(SAMPLES), dirs(SAMPLES);
+    for (size_t i = 0; i < SAMPLES; ++i) {
+        // Point on the circle on the pin sphere
+        Vec3d ps = rings.pinring(i);
+        // This is the point on the circle on the back sphere
+        Vec3d p = rings.backring(i);
+
+        // Point ps is not on mesh but can be inside or
+        // outside as well. This would cause many problems
+        // with ray-casting. To detect the position we will
+        // use the ray-casting result (which has an is_inside
+        // predicate).
+        dirs[i] = (p - ps).normalized();
+        sources[i] = ps + sd * dirs[i];
+    }
+
+    std::vector<HitResult> qs = m.query_ray_hit(sources, dirs);
+
+    // Rays to be re-cast from the outside of the object
+    std::vector<size_t> recast;
+
+    for (size_t i = 0; i < SAMPLES; ++i) {
+        const HitResult &q = qs[i];
+        if (q.is_inside()) { // the hit is inside the model
+            if (q.distance() > rings.rpin) {
+                // If we are inside the model and the hit
+                // distance is bigger than our pin circle
+                // diameter, it probably indicates that the
+                // support point was already inside the
+                // model, or there is really no space
+                // around the point. We will assign a zero
+                // hit distance to these cases which will
+                // enforce the function return value to be
+                // an invalid ray with zero hit distance.
+                // (see min_element at the end)
+                hits[i] = HitResult(0.0);
+            } else {
+                // re-cast the ray from the outside of the
+                // object. The starting point has an offset
+                // of 2*safety_distance because the
+                // original ray has also had an offset
+                sources[recast.size()] = sources[i] + (q.distance() + sd) * dirs[i];
+                dirs[recast.size()] = dirs[i];
+                recast.emplace_back(i);
+            }
+        } else
+            hits[i] = q;
+    }
+
+    if (!recast.empty()) {
+        sources.resize(recast.size()); dirs.resize(recast.size());
+        std::vector<HitResult> q2s = m.query_ray_hit(sources, dirs);
+        for (size_t i = 0; i < recast.size(); ++i) hits[recast[i]] = q2s[i];
+    }
 
     return min_hit(hits);
 }
@@ -267,24 +278,37 @@ IndexedMesh::hit_result SupportTreeBuildsteps::bridge_mesh_intersect(
     // Hit results
     std::array<Hit, SAMPLES> hits;
 
-    ccr::for_each(size_t(0), hits.size(),
-                 [this, r, src, /*ins_check,*/ &ring, dir, sd, &hits] (size_t i)
-    {
-        Hit &hit = hits[i];
-
+    // The rays of all the samples are cast as a single batch.
+    std::vector<Vec3d> sources(SAMPLES), dirs(SAMPLES, dir);
+    for (size_t i = 0; i < SAMPLES; ++i) {
         // Point on the circle on the pin sphere
         Vec3d p = ring.get(i, src, r + sd);
+        sources[i] = p + r * dir;
+    }
+
+    std::vector<Hit> hrs = m_mesh.query_ray_hit(sources, dirs);
 
-        auto hr = m_mesh.query_ray_hit(p + r * dir, dir);
+    // Rays to be re-cast from the outside of the object
+    std::vector<size_t> recast;
 
+    for (size_t i = 0; i < SAMPLES; ++i) {
+        const Hit &hr = hrs[i];
         if(/*ins_check && */hr.is_inside()) {
-            if(hr.distance() > 2 * r + sd) hit = Hit(0.0);
+            if(hr.distance() > 2 * r + sd) hits[i] = Hit(0.0);
             else {
                 // re-cast the ray from the outside of the object
-                hit = m_mesh.query_ray_hit(p + (hr.distance() + EPSILON) * dir, dir);
+                Vec3d p = ring.get(i, src, r + sd);
+                sources[recast.size()] = p + (hr.distance() + EPSILON) * dir;
+                recast.emplace_back(i);
             }
-        } else hit = hr;
-    });
+        } else hits[i] = hr;
+    }
+
+    if (!recast.empty()) {
+        sources.resize(recast.size()); dirs.resize(recast.size());
+        std::vector<Hit> hrs2 = m_mesh.query_ray_hit(sources, dirs);
+        for (size_t i = 0; i < recast.size(); ++i) hits[recast[i]] = hrs2[i];
+    }
 
     return min_hit(hits);
 }
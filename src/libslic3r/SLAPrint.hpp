@@ -2,6 +2,7 @@
 #define slic3r_SLAPrint_hpp_
 
 #include <mutex>
+#include <thread>
 #include "PrintBase.hpp"
 #include "SLA/RasterBase.hpp"
 #include "SLA/SupportTree.hpp"
@@ -373,24 +374,118 @@ class SLAPrinter {
 protected:
     std::vector<sla::EncodedRaster> m_layers;
     
+    // In streaming mode, draw_layers() does not keep the encoded layers in
+    // memory. The layers are rasterized, encoded and consumed in order by
+    // stream_layers() when the archive is written.
+    bool   m_streaming = false;
+    size_t m_max_inflight_layers = 0;
+    
     virtual uqptr<sla::RasterBase> create_raster() const = 0;
     virtual sla::RasterEncoder get_encoder() const = 0;
     
+    // Number of consecutive layers encoded in sequence with the same encoder
+    // instance. Encoders referencing the previous layer, like
+    // sla::DeltaRLERasterEncoder, need more than one. The first layer of
+    // every group is encoded without a reference.
+    virtual size_t layer_group_size() const { return 1; }
+    
+    // Draw and encode the layers of a group in sequence.
+    // Fn: void(sla::RasterBase& raster, size_t lyrid);
+    // EncFn: T(sla::EncodedRaster &&enc, size_t lyrid);
+    template<class Fn, class EncFn>
+    auto encode_group(size_t group, size_t layer_num, Fn &&drawfn, EncFn &&encfn)
+    {
+        using T = std::decay_t<std::invoke_result_t<EncFn, sla::EncodedRaster, size_t>>;
+        
+        size_t gs   = std::max(layer_group_size(), size_t(1));
+        size_t from = group * gs, to = std::min(layer_num, from + gs);
+        
+        std::vector<T> ret; ret.reserve(to - from);
+        sla::RasterEncoder encoder = get_encoder();
+        for (size_t idx = from; idx < to; ++idx) {
+            auto rst = create_raster();
+            drawfn(*rst, idx);
+            ret.emplace_back(encfn(rst->encode(encoder), idx));
+        }
+        
+        return ret;
+    }
+    
+    size_t group_count(size_t layer_num) const
+    {
+        size_t gs = std::max(layer_group_size(), size_t(1));
+        return (layer_num + gs - 1) / gs;
+    }
+    
+    // Fn have to be thread safe: void(sla::RasterBase& raster, size_t lyrid);
+    // OutFn is called serially in the order of layers:
+    // void(T &&result, size_t lyrid), where T is the return value of
+    // EncFn: T(sla::EncodedRaster &&enc, size_t lyrid), called in parallel.
+    // StopFn: bool(), no more layers are started once it returns true.
+    // StatusFn: void(size_t layers_done), called serially after OutFn.
+    template<class Fn, class EncFn, class OutFn, class StopFn, class StatusFn>
+    void stream_layers(size_t     layer_num,
+                       Fn       &&drawfn,
+                       EncFn    &&encfn,
+                       OutFn    &&outfn,
+                       StopFn   &&stopfn,
+                       StatusFn &&statusfn)
+    {
+        size_t max_inflight = m_max_inflight_layers;
+        if (max_inflight == 0)
+            max_inflight = 2 * std::max(std::thread::hardware_concurrency(), 1u);
+        
+        size_t gs = std::max(layer_group_size(), size_t(1));
+        max_inflight = std::max(max_inflight / gs, size_t(1));
+        
+        sla::ccr::for_each_ordered(
+            size_t(0), group_count(layer_num),
+            [this, layer_num, &drawfn, &encfn] (size_t grp) {
+                return encode_group(grp, layer_num, drawfn, encfn);
+            },
+            [&outfn, &statusfn, gs] (auto &&results, size_t grp) {
+                for (size_t i = 0; i < results.size(); ++i)
+                    outfn(std::move(results[i]), grp * gs + i);
+                statusfn(grp * gs + results.size());
+            },
+            max_inflight, stopfn);
+    }
+    
 public:
     virtual ~SLAPrinter() = default;
     
     virtual void apply(const SLAPrinterConfig &cfg) = 0;
     
+    // Enable or disable the streaming mode. The number of layers being
+    // processed at the same time is bounded by max_inflight_layers, zero
+    // means twice the number of hardware threads.
+    void set_streaming(bool streaming, size_t max_inflight_layers = 0)
+    {
+        m_streaming = streaming;
+        m_max_inflight_layers = max_inflight_layers;
+        m_layers = {};
+    }
+    
+    bool is_streaming() const { return m_streaming; }
+    
     // Fn have to be thread safe: void(sla::RasterBase& raster, size_t lyrid);
     template<class Fn> void draw_layers(size_t layer_num, Fn &&drawfn)
     {
+        // Rasterization is deferred to the export in streaming mode.
+        if (m_streaming) { m_layers = {}; return; }
+        
         m_layers.resize(layer_num);
-        sla::ccr::for_each(size_t(0), m_layers.size(),
-                           [this, &drawfn] (size_t idx) {
-                               sla::EncodedRaster& enc = m_layers[idx];
-                               auto rst = create_raster();
-                               drawfn(*rst, idx);
-                               enc = rst->encode(get_encoder());
+        size_t gs = std::max(layer_group_size(), size_t(1));
+        sla::ccr::for_each(size_t(0), group_count(layer_num),
+                           [this, layer_num, gs, &drawfn] (size_t grp) {
+                               auto enc = encode_group(
+                                   grp, layer_num, drawfn,
+                                   [](sla::EncodedRaster &&e, size_t) {
+                                       return std::move(e);
+                                   });
+                               
+                               for (size_t i = 0; i < enc.size(); ++i)
+                                   m_layers[grp * gs + i] = std::move(enc[i]);
                            });
     }
 };
@@ -13,6 +13,8 @@
 #include <cmath>
 #include <cassert>
 
+#include <tbb/parallel_for.h>
+
 namespace Slic3r {
 
 // Naive implementation of the Traveling Salesman Problem, it works by always taking the next closest neighbor.
@@ -998,11 +1000,241 @@ std::vector<std::pair<size_t, bool>> chain_segments_greedy2(SegmentEndPointFunc
 	return chain_segments_greedy_constrained_reversals2_<PointType, SegmentEndPointFunc, false, decltype(could_reverse_func)>(end_point_func, could_reverse_func, num_segments, start_near);
 }
 
-std::vector<std::pair<size_t, bool>> chain_extrusion_entities(std::vector<ExtrusionEntity*> &entities, const Point *start_near)
+std::vector<std::pair<size_t, bool>> chain_segments(const Points &end_points, const std::vector<bool> &could_reverse, const Point *start_near)
+{
+	assert(end_points.size() == 2 * could_reverse.size());
+	auto segment_end_point = [&end_points](size_t idx, bool first_point) -> const Point& { return end_points[first_point ? 2 * idx : 2 * idx + 1]; };
+	auto segment_could_reverse = [&could_reverse](size_t idx) -> bool { return could_reverse[idx]; };
+	return chain_segments_greedy_constrained_reversals<Point, decltype(segment_end_point), decltype(segment_could_reverse)>(segment_end_point, segment_could_reverse, could_reverse.size(), start_near);
+}
+
+double chain_travel_length(const std::vector<std::pair<size_t, bool>> &chain, const Points &end_points, const Point *start_near)
+{
+	double length = 0.;
+	const Point *last = start_near;
+	for (const std::pair<size_t, bool> &segment : chain) {
+		const Point &first = end_points[2 * segment.first + (segment.second ? 1 : 0)];
+		if (last != nullptr)
+			length += (first - *last).cast<double>().norm();
+		last = &end_points[2 * segment.first + (segment.second ? 0 : 1)];
+	}
+	return length;
+}
+
+// Shorter chains are left as the greedy chaining produced them. Building the KD tree and spawning the parallel
+// queries would cost more than the few moves there are to gain, and the chains of most islands are that short.
+static constexpr size_t improve_chain_min_segments = 16;
+
+// Local search over the chain produced by the greedy chaining. Two kinds of moves are considered:
+// 2-opt: a sub-chain is reversed, which reverses its segments,
+// Or-opt: a single segment is moved to another place of the chain, possibly reversed.
+// Only the moves connecting an end point with one of its closest end points are evaluated, and the total work
+// is bounded by a multiple of the number of segments, as each move shifts a part of the chain.
+// The budget is given by the amount of work rather than by time to keep the G-code deterministic.
+void improve_chain(std::vector<std::pair<size_t, bool>> &chain, const Points &end_points, const std::vector<bool> &could_reverse, const Point *start_near)
+{
+	// Number of closest end points considered for a new connection.
+	static constexpr size_t num_neighbors = 5;
+	// Number of positions of the chain shifted or evaluated per segment, which bounds the local search.
+	static constexpr size_t work_per_segment = 64;
+	// Maximum distance of two positions of the chain to be connected by a move. Longer moves are costly
+	// and rarely pay off, as the greedy chaining already connected the close segments.
+	static constexpr size_t max_span = 64;
+
+	const size_t num_segments = chain.size();
+	if (num_segments < improve_chain_min_segments)
+		return;
+	assert(end_points.size() == 2 * num_segments);
+	assert(could_reverse.size() == num_segments);
+
+	std::vector<Vec2d> pts;
+	pts.reserve(end_points.size());
+	for (const Point &pt : end_points)
+		pts.emplace_back(pt.cast<double>());
+	const Vec2d start = start_near ? Vec2d(start_near->cast<double>()) : Vec2d::Zero();
+
+	// For each end point the closest end points of the other segments. The last end point of a segment starting and ending
+	// at the same point (for example a loop or a single point) is left out, so that it does not take a second neighbor slot.
+	std::vector<size_t> neighbors(pts.size() * num_neighbors, std::numeric_limits<size_t>::max());
+	{
+		auto coordinate_fn = [&pts](size_t idx, size_t dimension) -> double { return pts[idx][dimension]; };
+		KDTreeIndirect<2, double, decltype(coordinate_fn)> kdtree(coordinate_fn, pts.size());
+		// Query along the chain, which is spatially coherent, so that the successive queries visit the same nodes.
+		tbb::parallel_for(tbb::blocked_range<size_t>(0, num_segments, 512), [&](const tbb::blocked_range<size_t> &range) {
+			for (size_t pos = range.begin(); pos < range.end(); ++ pos) {
+				size_t i = 2 * chain[pos].first;
+				auto   filter = [&pts, i](size_t idx) { return idx / 2 != i / 2 && (idx % 2 == 0 || pts[idx] != pts[idx - 1]); };
+				find_closest_points<num_neighbors>(kdtree, pts[i], filter, &neighbors[i * num_neighbors]);
+				if (pts[i + 1] == pts[i])
+					std::copy(neighbors.begin() + i * num_neighbors, neighbors.begin() + (i + 1) * num_neighbors, neighbors.begin() + (i + 1) * num_neighbors);
+				else
+					find_closest_points<num_neighbors>(kdtree, pts[i + 1], filter, &neighbors[(i + 1) * num_neighbors]);
+			}
+		});
+	}
+
+	std::vector<size_t> pos_of(num_segments);
+	for (size_t pos = 0; pos < num_segments; ++ pos)
+		pos_of[chain[pos].first] = pos;
+
+	// Indices of the first / last end points of the segment at position pos.
+	auto first = [&chain](size_t pos) { return 2 * chain[pos].first + (chain[pos].second ? 1 : 0); };
+	auto last  = [&chain](size_t pos) { return 2 * chain[pos].first + (chain[pos].second ? 0 : 1); };
+	// Travel from the end of the chain preceding position pos to the end point idx.
+	auto travel_to = [&](size_t pos, size_t idx) {
+		return pos > 0 ? (pts[idx] - pts[last(pos - 1)]).norm() : start_near ? (pts[idx] - start).norm() : 0.;
+	};
+	// Travel into the segment at position pos.
+	auto travel_in = [&](size_t pos) { return pos < num_segments ? travel_to(pos, first(pos)) : 0.; };
+
+	// 2-opt: Reverse positions <a, b>.
+	auto two_opt_gain = [&](size_t a, size_t b) {
+		assert(a <= b && b < num_segments);
+		return travel_in(a) + travel_in(b + 1) - travel_to(a, last(b)) - (b + 1 < num_segments ? (pts[first(b + 1)] - pts[first(a)]).norm() : 0.);
+	};
+	// Or-opt: Move the segment at position pos in front of position insert_pos, possibly reversed.
+	auto or_opt_gain = [&](size_t pos, size_t insert_pos, bool reverse) {
+		assert(insert_pos != pos && insert_pos != pos + 1 && insert_pos <= num_segments);
+		size_t seg_first = reverse ? last(pos) : first(pos);
+		size_t seg_last  = reverse ? first(pos) : last(pos);
+		double removed   = travel_in(pos) + travel_in(pos + 1) - (pos + 1 < num_segments ? travel_to(pos, first(pos + 1)) : 0.);
+		double inserted  = travel_to(insert_pos, seg_first) + (insert_pos < num_segments ? (pts[first(insert_pos)] - pts[seg_last]).norm() : 0.) - travel_in(insert_pos);
+		return removed - inserted;
+	};
+	const bool all_reversible = std::find(could_reverse.begin(), could_reverse.end(), false) == could_reverse.end();
+	size_t     work           = 0;
+	auto reversible = [&](size_t a, size_t b) {
+		if (all_reversible)
+			return true;
+		work += b + 1 - a;
+		for (size_t pos = a; pos <= b; ++ pos)
+			if (! could_reverse[chain[pos].first])
+				return false;
+		return true;
+	};
+	auto update_positions = [&](size_t a, size_t b) {
+		for (size_t pos = a; pos <= b; ++ pos)
+			pos_of[chain[pos].first] = pos;
+	};
+
+	struct Move {
+		enum Type { None, TwoOpt, OrOpt } type = None;
+		double gain = 0.;
+		// TwoOpt: reversed interval <a, b>, OrOpt: position of the moved segment a, insert position b.
+		size_t a, b;
+		bool   reverse = false;
+	};
+
+	const double min_gain = double(SCALED_EPSILON);
+	const size_t max_work = work_per_segment * num_segments;
+	for (bool improved = true; improved && work < max_work;) {
+		improved = false;
+		for (size_t pos = 0; pos < num_segments && work < max_work; ++ pos) {
+			Move best;
+			best.gain = min_gain;
+			auto consider = [&best](Move::Type type, double gain, size_t a, size_t b, bool reverse) {
+				if (gain > best.gain) {
+					best.type    = type;
+					best.gain    = gain;
+					best.a       = a;
+					best.b       = b;
+					best.reverse = reverse;
+				}
+			};
+			for (bool at_last : { true, false }) {
+				const size_t idx = at_last ? last(pos) : first(pos);
+				for (size_t k = 0; k < num_neighbors; ++ k) {
+					const size_t other = neighbors[idx * num_neighbors + k];
+					if (other == std::numeric_limits<size_t>::max())
+						break;
+					const size_t other_pos   = pos_of[other / 2];
+					// The first end point stands for both end points of a segment starting and ending at the same point.
+					const bool   other_first = other == first(other_pos) || pts[other] == pts[first(other_pos)];
+					++ work;
+					if ((other_pos > pos ? other_pos - pos : pos - other_pos) > max_span)
+						continue;
+					if (at_last) {
+						// Connect last(pos) -> other.
+						if (other_first) {
+							if (other_pos != pos + 1)
+								consider(Move::OrOpt, or_opt_gain(other_pos, pos + 1, false), other_pos, pos + 1, false);
+						} else {
+							if (other_pos > pos && reversible(pos + 1, other_pos))
+								consider(Move::TwoOpt, two_opt_gain(pos + 1, other_pos), pos + 1, other_pos, false);
+							else if (other_pos < pos && reversible(other_pos + 1, pos))
+								consider(Move::TwoOpt, two_opt_gain(other_pos + 1, pos), other_pos + 1, pos, false);
+							if (other_pos != pos + 1 && could_reverse[other / 2])
+								consider(Move::OrOpt, or_opt_gain(other_pos, pos + 1, true), other_pos, pos + 1, true);
+						}
+					} else {
+						// Connect other -> first(pos).
+						if (! other_first) {
+							if (other_pos + 1 != pos)
+								consider(Move::OrOpt, or_opt_gain(other_pos, pos, false), other_pos, pos, false);
+						} else {
+							if (other_pos > pos && reversible(pos, other_pos - 1))
+								consider(Move::TwoOpt, two_opt_gain(pos, other_pos - 1), pos, other_pos - 1, false);
+							else if (other_pos < pos && reversible(other_pos, pos - 1))
+								consider(Move::TwoOpt, two_opt_gain(other_pos, pos - 1), other_pos, pos - 1, false);
+							if (other_pos + 1 != pos && could_reverse[other / 2])
+								consider(Move::OrOpt, or_opt_gain(other_pos, pos, true), other_pos, pos, true);
+						}
+					}
+				}
+			}
+			if (best.type == Move::TwoOpt) {
+				std::reverse(chain.begin() + best.a, chain.begin() + best.b + 1);
+				for (size_t i = best.a; i <= best.b; ++ i)
+					chain[i].second = ! chain[i].second;
+				update_positions(best.a, best.b);
+				work += best.b + 1 - best.a;
+				improved = true;
+			} else if (best.type == Move::OrOpt) {
+				std::pair<size_t, bool> segment = chain[best.a];
+				if (best.reverse)
+					segment.second = ! segment.second;
+				if (best.b > best.a) {
+					std::move(chain.begin() + best.a + 1, chain.begin() + best.b, chain.begin() + best.a);
+					chain[best.b - 1] = segment;
+					update_positions(best.a, best.b - 1);
+					work += best.b - best.a;
+				} else {
+					std::move_backward(chain.begin() + best.b, chain.begin() + best.a, chain.begin() + best.a + 1);
+					chain[best.b] = segment;
+					update_positions(best.b, best.a);
+					work += best.a + 1 - best.b;
+				}
+				improved = true;
+			}
+		}
+	}
+}
+
+// Build the end points of the segments to call improve_chain() on the result of a greedy chaining.
+template<typename SegmentEndPointFunc, typename CouldReverseFunc>
+static inline void improve_chain(std::vector<std::pair<size_t, bool>> &chain, SegmentEndPointFunc end_point_func, CouldReverseFunc could_reverse_func, const Point *start_near)
+{
+	if (chain.size() < improve_chain_min_segments)
+		return;
+	Points            end_points;
+	std::vector<bool> could_reverse;
+	end_points.reserve(2 * chain.size());
+	could_reverse.reserve(chain.size());
+	for (size_t i = 0; i < chain.size(); ++ i) {
+		end_points.emplace_back(end_point_func(i, true));
+		end_points.emplace_back(end_point_func(i, false));
+		could_reverse.emplace_back(could_reverse_func(i));
+	}
+	improve_chain(chain, end_points, could_reverse, start_near);
+}
+
+std::vector<std::pair<size_t, bool>> chain_extrusion_entities(std::vector<ExtrusionEntity*> &entities, const Point *start_near, bool improve_travels)
 {
 	auto segment_end_point = [&entities](size_t idx, bool first_point) -> const Point& { return first_point ? entities[idx]->first_point() : entities[idx]->last_point(); };
 	auto could_reverse = [&entities](size_t idx) { const ExtrusionEntity *ee = entities[idx]; return ee->is_loop() || ee->can_reverse(); };
 	std::vector<std::pair<size_t, bool>> out = chain_segments_greedy_constrained_reversals<Point, decltype(segment_end_point), decltype(could_reverse)>(segment_end_point, could_reverse, entities.size(), start_near);
+	if (improve_travels)
+		improve_chain(out, segment_end_point, could_reverse, start_near);
 	for (std::pair<size_t, bool> &segment : out) {
 		ExtrusionEntity *ee = entities[segment.first];
 		if (ee->is_loop())
@@ -1028,9 +1260,9 @@ void reorder_extrusion_entities(std::vector<ExtrusionEntity*> &entities, const s
     entities.swap(out);
 }
 
-void chain_and_reorder_extrusion_entities(std::vector<ExtrusionEntity*> &entities, const Point *start_near)
+void chain_and_reorder_extrusion_entities(std::vector<ExtrusionEntity*> &entities, const Point *start_near, bool improve_travels)
 {
-	reorder_extrusion_entities(entities, chain_extrusion_entities(entities, start_near));
+	reorder_extrusion_entities(entities, chain_extrusion_entities(entities, start_near, improve_travels));
 }
 
 std::vector<std::pair<size_t, bool>> chain_extrusion_paths(std::vector<ExtrusionPath> &extrusion_paths, const Point *start_near)
@@ -1903,7 +2135,7 @@ static inline void improve_ordering_by_two_exchanges_with_segment_flipping(Polyl
 #endif /* NDEBUG */
 }
 
-Polylines chain_polylines(Polylines &&polylines, const Point *start_near)
+Polylines chain_polylines(Polylines &&polylines, const Point *start_near, bool improve_travels)
 {
 #ifdef DEBUG_SVG_OUTPUT
 	static int iRun = 0;
@@ -1915,6 +2147,8 @@ Polylines chain_polylines(Polylines &&polylines, const Point *start_near)
 	if (! polylines.empty()) {
 		auto segment_end_point = [&polylines](size_t idx, bool first_point) -> const Point& { return first_point ? polylines[idx].first_point() : polylines[idx].last_point(); };
 		std::vector<std::pair<size_t, bool>> ordered = chain_segments_greedy2<Point, decltype(segment_end_point)>(segment_end_point, polylines.size(), start_near);
+		if (improve_travels)
+			improve_chain(ordered, segment_end_point, [](size_t) { return true; }, start_near);
 		out.reserve(polylines.size()); 
 		for (auto &segment_and_reversal : ordered) {
 			out.emplace_back(std::move(polylines[segment_and_reversal.first]));
@@ -14,19 +14,31 @@ namespace Slic3r {
 
 std::vector<size_t> 				 chain_points(const Points &points, Point *start_near = nullptr);
 
-std::vector<std::pair<size_t, bool>> chain_extrusion_entities(std::vector<ExtrusionEntity*> &entities, const Point *start_near = nullptr);
+// With improve_travels, the greedy chain is refined by improve_chain(). It pays off for the chains dominated by travels:
+// the loops of an island in PerimeterGenerator, the infill lines of a surface in the Fill classes and the support islands
+// at the G-code export.
+std::vector<std::pair<size_t, bool>> chain_extrusion_entities(std::vector<ExtrusionEntity*> &entities, const Point *start_near = nullptr, bool improve_travels = false);
 void                                 reorder_extrusion_entities(std::vector<ExtrusionEntity*> &entities, const std::vector<std::pair<size_t, bool>> &chain);
-void                                 chain_and_reorder_extrusion_entities(std::vector<ExtrusionEntity*> &entities, const Point *start_near = nullptr);
+void                                 chain_and_reorder_extrusion_entities(std::vector<ExtrusionEntity*> &entities, const Point *start_near = nullptr, bool improve_travels = false);
 
 std::vector<std::pair<size_t, bool>> chain_extrusion_paths(std::vector<ExtrusionPath> &extrusion_paths, const Point *start_near = nullptr);
 void                                 reorder_extrusion_paths(std::vector<ExtrusionPath> &extrusion_paths, std::vector<std::pair<size_t, bool>> &chain);
 void                                 chain_and_reorder_extrusion_paths(std::vector<ExtrusionPath> &extrusion_paths, const Point *start_near = nullptr);
 
-Polylines 							 chain_polylines(Polylines &&src, const Point *start_near = nullptr);
-inline Polylines 					 chain_polylines(const Polylines& src, const Point* start_near = nullptr) { Polylines tmp(src); return chain_polylines(std::move(tmp), start_near); }
+Polylines 							 chain_polylines(Polylines &&src, const Point *start_near = nullptr, bool improve_travels = false);
+inline Polylines 					 chain_polylines(const Polylines& src, const Point* start_near = nullptr, bool improve_travels = false) { Polylines tmp(src); return chain_polylines(std::move(tmp), start_near, improve_travels); }
 
 std::vector<ClipperLib::PolyNode*>	 chain_clipper_polynodes(const Points &points, const std::vector<ClipperLib::PolyNode*> &items);
 
+// Chain segments given by their first and last points (two end points per segment) by the greedy algorithm used by the functions above.
+std::vector<std::pair<size_t, bool>> chain_segments(const Points &end_points, const std::vector<bool> &could_reverse, const Point *start_near = nullptr);
+// Shorten the travels between the segments of a chain by a bounded local search (2-opt and Or-opt moves).
+// The result of the greedy chaining is only refined on request, see chain_extrusion_entities() and chain_polylines().
+// Short chains are left as they are.
+void                                 improve_chain(std::vector<std::pair<size_t, bool>> &chain, const Points &end_points, const std::vector<bool> &could_reverse, const Point *start_near = nullptr);
+// Length of the travels between the segments of a chain, starting at start_near if provided.
+double                               chain_travel_length(const std::vector<std::pair<size_t, bool>> &chain, const Points &end_points, const Point *start_near = nullptr);
+
 // Chain instances of print objects by an approximate shortest path.
 // Returns pairs of PrintObject idx and instance of that PrintObject.
 class Print;
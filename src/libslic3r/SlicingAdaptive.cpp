@@ -5,6 +5,9 @@
 
 #include <boost/log/trivial.hpp>
 
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
+
 // Based on the work of Florens Waserfall (@platch on github)
 // and his paper
 // Florens Wasserfall, Norman Hendrich, Jianwei Zhang:
@@ -76,6 +79,9 @@ static inline float layer_height_from_slope(const SlicingAdaptive::FaceZ &face,
 void SlicingAdaptive::clear()
 {
 	m_faces.clear();
+	m_active_faces.clear();
+	m_next_face = 0;
+	m_last_print_z = 0.f;
 }
 
 void SlicingAdaptive::prepare(const ModelObject &object)
@@ -87,21 +93,23 @@ void SlicingAdaptive::prepare(const ModelObject &object)
     mesh.transform(first_instance.get_matrix(), first_instance.is_left_handed());
 
     // 1) Collect faces from mesh.
-    m_faces.reserve(mesh.stl.stats.number_of_facets);
-    for (const stl_facet &face : mesh.stl.facet_start) {
-    	Vec3f n = face.normal.normalized();
-		m_faces.emplace_back(FaceZ({ face_z_span(face), std::abs(n.z()), std::sqrt(n.x() * n.x() + n.y() * n.y()) }));
-    }
+    m_faces.assign(mesh.stl.facet_start.size(), FaceZ());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, m_faces.size()),
+    	[this, &mesh](const tbb::blocked_range<size_t> &range) {
+    		for (size_t i = range.begin(); i < range.end(); ++ i) {
+    			const stl_facet &face = mesh.stl.facet_start[i];
+		    	Vec3f n = face.normal.normalized();
+				m_faces[i] = FaceZ({ face_z_span(face), std::abs(n.z()), std::sqrt(n.x() * n.x() + n.y() * n.y()) });
+			}
+    	});
 
 	// 2) Sort faces lexicographically by their Z span.
-	std::sort(m_faces.begin(), m_faces.end(), [](const FaceZ &f1, const FaceZ &f2) { return f1.z_span < f2.z_span; });
+	tbb::parallel_sort(m_faces.begin(), m_faces.end(), [](const FaceZ &f1, const FaceZ &f2) { return f1.z_span < f2.z_span; });
 }
 
-// current_facet is in/out parameter, rememebers the index of the last face of m_faces visited, 
-// where this function will start from.
 // print_z - the top print surface of the previous layer.
 // returns height of the next layer.
-float SlicingAdaptive::next_layer_height(const float print_z, float quality_factor, size_t &current_facet)
+float SlicingAdaptive::next_layer_height(const float print_z, float quality_factor)
 {
 	float  height = (float)m_slicing_params.max_layer_height;
 
@@ -125,29 +133,26 @@ float SlicingAdaptive::next_layer_height(const float print_z, float quality_fact
 	}
 	
 	// find all facets intersecting the slice-layer
-	size_t ordered_id = current_facet;
-	{
-		bool first_hit = false;
-		for (; ordered_id < m_faces.size(); ++ ordered_id) {
-	        const std::pair<float, float> &zspan = m_faces[ordered_id].z_span;
-	        // facet's minimum is higher than slice_z -> end loop
-			if (zspan.first >= print_z)
-				break;
-			// facet's maximum is higher than slice_z -> store the first event for next cusp_height call to begin at this point
-			if (zspan.second > print_z) {
-				// first event?
-				if (! first_hit) {
-					first_hit = true;
-					current_facet = ordered_id;
-	            }
-				// skip touching facets which could otherwise cause small cusp values
-				if (zspan.second < print_z + EPSILON)
-					continue;
-				// compute cusp-height for this facet and store minimum of all heights
-				height = std::min(height, layer_height_from_slope(m_faces[ordered_id], max_surface_deviation));
-	        }
-		}
+	// The facets starting below print_z are swept in the order of their minimum Z, only those still
+	// reaching above print_z are kept, thus each facet is visited just while it crosses the print_z.
+	if (print_z < m_last_print_z) {
+		m_active_faces.clear();
+		m_next_face = 0;
+	}
+	m_last_print_z = print_z;
+	for (; m_next_face < m_faces.size() && m_faces[m_next_face].z_span.first < print_z; ++ m_next_face)
+		m_active_faces.emplace_back(m_next_face);
+	m_active_faces.erase(std::remove_if(m_active_faces.begin(), m_active_faces.end(),
+		// facet's maximum is not higher than slice_z -> it will not cross any following layer
+		[this, print_z](size_t id) { return m_faces[id].z_span.second <= print_z; }), m_active_faces.end());
+	for (size_t id : m_active_faces) {
+		// skip touching facets which could otherwise cause small cusp values
+		if (m_faces[id].z_span.second < print_z + EPSILON)
+			continue;
+		// compute cusp-height for this facet and store minimum of all heights
+		height = std::min(height, layer_height_from_slope(m_faces[id], max_surface_deviation));
 	}
+	size_t ordered_id = m_next_face;
 
 	// lower height limit due to printer capabilities
 	height = std::max(height, float(m_slicing_params.min_layer_height));
@@ -20,7 +20,8 @@ public:
     // Return next layer height starting from the last print_z, using a quality measure
     // (quality in range from 0 to 1, 0 - highest quality at low layer heights, 1 - lowest print quality at high layer heights).
     // The layer height curve shall be centered roughly around the default profile's layer height for quality 0.5.
-	float next_layer_height(const float print_z, float quality, size_t &current_facet);
+    // The faces crossing print_z are tracked incrementally for increasing print_z, a lower print_z restarts the tracking.
+	float next_layer_height(const float print_z, float quality);
     float horizontal_facet_distance(float z);
 
 	struct FaceZ {
@@ -34,7 +35,14 @@ public:
 protected:
 	SlicingParameters 		m_slicing_params;
 
+	// Sorted lexicographically by their Z span.
 	std::vector<FaceZ>		m_faces;
+
+	// Sweep over m_faces by next_layer_height(): indices of the faces starting below the last print_z
+	// and possibly ending above it, and the index of the first face of m_faces not visited yet.
+	std::vector<size_t>		m_active_faces;
+	size_t 					m_next_face = 0;
+	float 					m_last_print_z = 0.f;
 };
 
 }; // namespace Slic3r
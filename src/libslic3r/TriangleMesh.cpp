@@ -687,10 +687,35 @@ void TriangleMeshSlicer::init(const TriangleMesh *_mesh, throw_on_cancel_callbac
         throw Slic3r::InvalidArgument("TriangleMeshSlicer was passed a mesh without shared vertices.");
 
     throw_on_cancel();
-    facets_edges.assign(_mesh->stl.stats.number_of_facets * 3, -1);
+    m_vertices_transformed.clear();
+    m_left_handed = false;
 	v_scaled_shared.assign(_mesh->its.vertices.size(), stl_vertex());
 	for (size_t i = 0; i < v_scaled_shared.size(); ++ i)
         this->v_scaled_shared[i] = _mesh->its.vertices[i] / float(SCALING_FACTOR);
+    this->init_edges(throw_on_cancel);
+}
+
+void TriangleMeshSlicer::init(const TriangleMesh *_mesh, const Transform3d &trafo, throw_on_cancel_callback_type throw_on_cancel)
+{
+    mesh = _mesh;
+    if (! mesh->has_shared_vertices())
+        throw Slic3r::InvalidArgument("TriangleMeshSlicer was passed a mesh without shared vertices.");
+
+    throw_on_cancel();
+    m_vertices_transformed.assign(_mesh->its.vertices.size(), stl_vertex());
+    v_scaled_shared.assign(_mesh->its.vertices.size(), stl_vertex());
+    for (size_t i = 0; i < v_scaled_shared.size(); ++ i) {
+        m_vertices_transformed[i] = (trafo * _mesh->its.vertices[i].cast<double>()).cast<float>();
+        this->v_scaled_shared[i]  = m_vertices_transformed[i] / float(SCALING_FACTOR);
+    }
+    // Same as TriangleMesh::transform(trafo, true) flipping the facets.
+    m_left_handed = trafo.matrix().block(0, 0, 3, 3).determinant() < 0.;
+    this->init_edges(throw_on_cancel);
+}
+
+void TriangleMeshSlicer::init_edges(throw_on_cancel_callback_type throw_on_cancel)
+{
+    facets_edges.assign(this->mesh->stl.stats.number_of_facets * 3, -1);
 
     // Create a mapping from triangle edge into face.
     struct EdgeToFace {
@@ -707,11 +732,12 @@ void TriangleMeshSlicer::init(const TriangleMesh *_mesh, throw_on_cancel_callbac
     };
     std::vector<EdgeToFace> edges_map;
     edges_map.assign(this->mesh->stl.stats.number_of_facets * 3, EdgeToFace());
-    for (uint32_t facet_idx = 0; facet_idx < this->mesh->stl.stats.number_of_facets; ++ facet_idx)
+    for (uint32_t facet_idx = 0; facet_idx < this->mesh->stl.stats.number_of_facets; ++ facet_idx) {
+        stl_triangle_vertex_indices vertices = this->facet_vertices(facet_idx);
         for (int i = 0; i < 3; ++ i) {
             EdgeToFace &e2f = edges_map[facet_idx*3+i];
-            e2f.vertex_low  = this->mesh->its.indices[facet_idx][i];
-            e2f.vertex_high = this->mesh->its.indices[facet_idx][(i + 1) % 3];
+            e2f.vertex_low  = vertices[i];
+            e2f.vertex_high = vertices[(i + 1) % 3];
             e2f.face        = facet_idx;
             // 1 based indexing, to be always strictly positive.
             e2f.face_edge   = i + 1;
@@ -722,6 +748,7 @@ void TriangleMeshSlicer::init(const TriangleMesh *_mesh, throw_on_cancel_callbac
                 e2f.face_edge = - e2f.face_edge;
             }
         }
+    }
     throw_on_cancel();
     std::sort(edges_map.begin(), edges_map.end());
 
@@ -765,14 +792,111 @@ void TriangleMeshSlicer::init(const TriangleMesh *_mesh, throw_on_cancel_callbac
         if ((i & 0x0ffff) == 0)
             throw_on_cancel();
     }
+
+    if (m_use_quaternion)
+        this->update_rotated_data();
+}
+
+stl_facet TriangleMeshSlicer::facet(size_t facet_idx) const
+{
+    if (m_vertices_transformed.empty())
+        return m_use_quaternion ? this->mesh->stl.facet_start[facet_idx].rotated(m_quaternion) : this->mesh->stl.facet_start[facet_idx];
+    stl_facet                   facet;
+    stl_triangle_vertex_indices vertices = this->facet_vertices(facet_idx);
+    for (int i = 0; i < 3; ++ i)
+        facet.vertex[i] = m_vertices_transformed[vertices(i)];
+    facet.normal = (facet.vertex[1] - facet.vertex[0]).cross(facet.vertex[2] - facet.vertex[0]).normalized();
+    return m_use_quaternion ? facet.rotated(m_quaternion) : facet;
+}
+
+stl_triangle_vertex_indices TriangleMeshSlicer::facet_vertices(size_t facet_idx) const
+{
+    stl_triangle_vertex_indices vertices = this->mesh->its.indices[facet_idx];
+    if (m_left_handed)
+        std::swap(vertices(0), vertices(1));
+    return vertices;
 }
 
 
 
 void TriangleMeshSlicer::set_up_direction(const Vec3f& up)
 {
-    m_quaternion.setFromTwoVectors(up, Vec3f::UnitZ());
+    Eigen::Quaternion<float, Eigen::DontAlign> q;
+    q.setFromTwoVectors(up, Vec3f::UnitZ());
+    if (m_use_quaternion && q.coeffs() == m_quaternion.coeffs())
+        // Nothing changed, keep the cached data.
+        return;
+
+    m_quaternion = q;
     m_use_quaternion = true;
+    if (this->mesh != nullptr)
+        this->update_rotated_data();
+}
+
+void TriangleMeshSlicer::update_rotated_data()
+{
+    m_v_scaled_rotated.resize(this->v_scaled_shared.size());
+    for (size_t i = 0; i < this->v_scaled_shared.size(); ++ i)
+        m_v_scaled_rotated[i] = m_quaternion * this->v_scaled_shared[i];
+
+    // Z span of the rotated facets, calculated the same way _slice_do() does.
+    std::vector<std::pair<float, float>> spans(this->mesh->stl.stats.number_of_facets);
+    float min_z = std::numeric_limits<float>::max();
+    float max_z = - std::numeric_limits<float>::max();
+    for (size_t i = 0; i < spans.size(); ++ i) {
+        stl_facet facet = this->facet(i);
+        spans[i].first  = fminf(facet.vertex[0](2), fminf(facet.vertex[1](2), facet.vertex[2](2)));
+        spans[i].second = fmaxf(facet.vertex[0](2), fmaxf(facet.vertex[1](2), facet.vertex[2](2)));
+        min_z = std::min(min_z, spans[i].first);
+        max_z = std::max(max_z, spans[i].second);
+    }
+
+    m_height_index_start.clear();
+    m_height_index_max_z.clear();
+    m_height_index_facets.clear();
+    if (spans.empty())
+        return;
+
+    // Each facet is stored once, in the bucket of its minimum z.
+    // Roughly sqrt(n) buckets keep both the buckets and the number of facets per bucket small.
+    size_t num_buckets = std::clamp<size_t>(size_t(std::sqrt(double(spans.size()))), 1, 65536);
+    m_height_index_min  = min_z;
+    m_height_index_max  = max_z;
+    m_height_index_step = std::max((max_z - min_z) / float(num_buckets), std::numeric_limits<float>::min());
+    m_height_index_start.assign(num_buckets + 1, 0);
+    m_height_index_max_z.assign(num_buckets, - std::numeric_limits<float>::max());
+    // Counting sort of the facets into the buckets. The bucket index is monotonic in z, thus a facet spanning z
+    // is listed in the bucket of z or in a bucket below, whose maximum z is then at least z.
+    for (const std::pair<float, float> &span : spans) {
+        size_t b = this->height_bucket(span.first);
+        ++ m_height_index_start[b + 1];
+        m_height_index_max_z[b] = std::max(m_height_index_max_z[b], span.second);
+    }
+    for (size_t b = 0; b < num_buckets; ++ b)
+        m_height_index_start[b + 1] += m_height_index_start[b];
+    m_height_index_facets.assign(spans.size(), 0);
+    std::vector<size_t> next(m_height_index_start.begin(), m_height_index_start.end() - 1);
+    for (size_t i = 0; i < spans.size(); ++ i)
+        m_height_index_facets[next[this->height_bucket(spans[i].first)] ++] = int(i);
+}
+
+size_t TriangleMeshSlicer::height_bucket(float z) const
+{
+    return std::min(size_t(std::max(0.f, (z - m_height_index_min) / m_height_index_step)), m_height_index_start.size() - 2);
+}
+
+std::vector<int> TriangleMeshSlicer::facets_at_height(float z) const
+{
+    std::vector<int> out;
+    if (z < m_height_index_min || z > m_height_index_max)
+        // The plane does not touch the mesh.
+        return out;
+    // The facets starting above z are in the buckets above the bucket of z. Of the buckets below, only those
+    // with a facet reaching up to z are visited.
+    for (size_t b = 0; b <= this->height_bucket(z); ++ b)
+        if (m_height_index_max_z[b] >= z)
+            out.insert(out.end(), m_height_index_facets.begin() + m_height_index_start[b], m_height_index_facets.begin() + m_height_index_start[b + 1]);
+    return out;
 }
 
 
@@ -810,7 +934,21 @@ void TriangleMeshSlicer::slice(const std::vector<float> &z, SlicingMode mode, st
     
     BOOST_LOG_TRIVIAL(debug) << "TriangleMeshSlicer::_slice_do";
     std::vector<IntersectionLines> lines(z.size());
-    {
+    if (z.size() == 1 && ! m_height_index_start.empty()) {
+        // A single cut along a custom up direction, only the facets near the plane are visited.
+        std::vector<int> facets = this->facets_at_height(z.front());
+        boost::mutex lines_mutex;
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(0, facets.size()),
+            [&lines, &lines_mutex, &z, &facets, throw_on_cancel, this](const tbb::blocked_range<size_t>& range) {
+                for (size_t i = range.begin(); i < range.end(); ++ i) {
+                    if ((i & 0x0ffff) == 0)
+                        throw_on_cancel();
+                    this->_slice_do(size_t(facets[i]), &lines, &lines_mutex, z);
+                }
+            }
+        );
+    } else {
         boost::mutex lines_mutex;
         tbb::parallel_for(
             tbb::blocked_range<int>(0,this->mesh->stl.stats.number_of_facets),
@@ -906,7 +1044,7 @@ void TriangleMeshSlicer::slice(const std::vector<float> &z, SlicingMode mode, st
 void TriangleMeshSlicer::_slice_do(size_t facet_idx, std::vector<IntersectionLines>* lines, boost::mutex* lines_mutex, 
     const std::vector<float> &z) const
 {
-    const stl_facet &facet = m_use_quaternion ? (this->mesh->stl.facet_start.data() + facet_idx)->rotated(m_quaternion) : *(this->mesh->stl.facet_start.data() + facet_idx);
+    const stl_facet facet = this->facet(facet_idx);
     
     // find facet extents
     const float min_z = fminf(facet.vertex[0](2), fminf(facet.vertex[1](2), facet.vertex[2](2)));
@@ -978,13 +1116,9 @@ TriangleMeshSlicer::FacetSliceType TriangleMeshSlicer::slice_facet(
     // Reorder vertices so that the first one is the one with lowest Z.
     // This is needed to get all intersection lines in a consistent order
     // (external on the right of the line)
-    const stl_triangle_vertex_indices &vertices = this->mesh->its.indices[facet_idx];
+    const stl_triangle_vertex_indices vertices = this->facet_vertices(facet_idx);
     int i = (facet.vertex[1].z() == min_z) ? 1 : ((facet.vertex[2].z() == min_z) ? 2 : 0);
 
-    // These are used only if the cut plane is tilted:
-    stl_vertex rotated_a;
-    stl_vertex rotated_b;
-
     for (int j = i; j - i < 3; ++j) {  // loop through facet edges
         int        edge_id  = this->facets_edges[facet_idx * 3 + (j % 3)];
         int        a_id     = vertices[j % 3];
@@ -993,10 +1127,8 @@ TriangleMeshSlicer::FacetSliceType TriangleMeshSlicer::slice_facet(
         const stl_vertex *a;
         const stl_vertex *b;
         if (m_use_quaternion) {
-            rotated_a = m_quaternion * this->v_scaled_shared[a_id];
-            rotated_b = m_quaternion * this->v_scaled_shared[b_id];
-            a = &rotated_a;
-            b = &rotated_b;
+            a = &m_v_scaled_rotated[a_id];
+            b = &m_v_scaled_rotated[b_id];
         }
         else {
             a = &this->v_scaled_shared[a_id];
@@ -1007,9 +1139,10 @@ TriangleMeshSlicer::FacetSliceType TriangleMeshSlicer::slice_facet(
         if (a->z() == slice_z && b->z() == slice_z) {
             // Edge is horizontal and belongs to the current layer.
             // The following rotation of the three vertices may not be efficient, but this branch happens rarely.
-            const stl_vertex &v0 = m_use_quaternion ? stl_vertex(m_quaternion * this->v_scaled_shared[vertices[0]]) : this->v_scaled_shared[vertices[0]];
-            const stl_vertex &v1 = m_use_quaternion ? stl_vertex(m_quaternion * this->v_scaled_shared[vertices[1]]) : this->v_scaled_shared[vertices[1]];
-            const stl_vertex &v2 = m_use_quaternion ? stl_vertex(m_quaternion * this->v_scaled_shared[vertices[2]]) : this->v_scaled_shared[vertices[2]];
+            const std::vector<stl_vertex> &v_scaled = m_use_quaternion ? m_v_scaled_rotated : this->v_scaled_shared;
+            const stl_vertex &v0 = v_scaled[vertices[0]];
+            const stl_vertex &v1 = v_scaled[vertices[1]];
+            const stl_vertex &v2 = v_scaled[vertices[2]];
             const stl_normal &normal = facet.normal;
             // We may ignore this edge for slicing purposes, but we may still use it for object cutting.
             FacetSliceType    result = Slicing;
@@ -1127,7 +1260,7 @@ TriangleMeshSlicer::FacetSliceType TriangleMeshSlicer::slice_facet(
                 i = vertices[2];
             assert(i != line_out->a_id && i != line_out->b_id);
             line_out->edge_type = ((m_use_quaternion ?
-                                    (m_quaternion * this->v_scaled_shared[i]).z()
+                                    m_v_scaled_rotated[i].z()
                                     : this->v_scaled_shared[i].z()) < slice_z) ? feTop : feBottom;
         }
 #endif
@@ -1803,6 +1936,8 @@ void TriangleMeshSlicer::cut(float z, TriangleMesh* upper, TriangleMesh* lower)
     IntersectionLines upper_lines, lower_lines;
     
     BOOST_LOG_TRIVIAL(trace) << "TriangleMeshSlicer::cut - slicing object";
+    // The cut is only supported for a mesh sliced without a transformation.
+    assert(m_vertices_transformed.empty());
     float scaled_z = scale_(z);
     for (uint32_t facet_idx = 0; facet_idx < this->mesh->stl.stats.number_of_facets; ++ facet_idx) {
         const stl_facet* facet = &this->mesh->stl.facet_start[facet_idx];
@@ -179,6 +179,9 @@ public:
     TriangleMeshSlicer() : mesh(nullptr) {}
 	TriangleMeshSlicer(const TriangleMesh* mesh) { this->init(mesh, [](){}); }
     void init(const TriangleMesh *mesh, throw_on_cancel_callback_type throw_on_cancel);
+    // Slice the mesh transformed by trafo. Only the transformed shared vertices are stored by the slicer,
+    // thus a mesh shared by the Model does not need to be copied and transformed before slicing.
+    void init(const TriangleMesh *mesh, const Transform3d &trafo, throw_on_cancel_callback_type throw_on_cancel);
     void slice(const std::vector<float> &z, SlicingMode mode, std::vector<Polygons>* layers, throw_on_cancel_callback_type throw_on_cancel) const;
     void slice(const std::vector<float> &z, SlicingMode mode, const float closing_radius, std::vector<ExPolygons>* layers, throw_on_cancel_callback_type throw_on_cancel) const;
     enum FacetSliceType {
@@ -189,6 +192,9 @@ public:
     FacetSliceType slice_facet(float slice_z, const stl_facet &facet, const int facet_idx,
         const float min_z, const float max_z, IntersectionLine *line_out) const;
     void cut(float z, TriangleMesh* upper, TriangleMesh* lower) const;
+    // Slice along the given direction instead of the Z axis. The rotated vertices and an index of the facets
+    // by their height along the direction are cached, so that repeated single plane cuts along the same
+    // direction (the clipping plane in the GUI) only visit the facets near the plane.
     void set_up_direction(const Vec3f& up);
     
 private:
@@ -197,11 +203,35 @@ private:
     std::vector<int>         facets_edges;
     // Scaled copy of this->mesh->stl.v_shared
     std::vector<stl_vertex>  v_scaled_shared;
+    // this->mesh->its.vertices transformed by the transformation passed to init(), empty if there is none.
+    std::vector<stl_vertex>  m_vertices_transformed;
+    // The transformation passed to init() is left handed, the facets are traversed with the first two vertices swapped.
+    bool                     m_left_handed = false;
     // Quaternion that will be used to rotate every facet before the slicing
     Eigen::Quaternion<float, Eigen::DontAlign> m_quaternion;
     // Whether or not the above quaterion should be used
     bool                     m_use_quaternion = false;
+    // v_scaled_shared rotated by m_quaternion.
+    std::vector<stl_vertex>  m_v_scaled_rotated;
+    // Facets bucketed by the minimum of their rotated Z coordinates, each facet is listed once.
+    // The facets of the i-th bucket are m_height_index_facets[m_height_index_start[i] .. m_height_index_start[i + 1]),
+    // m_height_index_max_z[i] is the maximum of their rotated Z coordinates.
+    float                    m_height_index_min  = 0.f;
+    float                    m_height_index_max  = 0.f;
+    float                    m_height_index_step = 0.f;
+    std::vector<size_t>      m_height_index_start;
+    std::vector<float>       m_height_index_max_z;
+    std::vector<int>         m_height_index_facets;
 
+    void init_edges(throw_on_cancel_callback_type throw_on_cancel);
+    // Facet of the mesh being sliced, transformed and rotated.
+    stl_facet facet(size_t facet_idx) const;
+    // Indices of the shared vertices of a facet of the mesh being sliced, in the order of the facet() vertices.
+    stl_triangle_vertex_indices facet_vertices(size_t facet_idx) const;
+    void update_rotated_data();
+    size_t height_bucket(float z) const;
+    // Facets which may intersect the plane at (unscaled) z, that is all the facets of the buckets reaching up to z.
+    std::vector<int> facets_at_height(float z) const;
     void _slice_do(size_t facet_idx, std::vector<IntersectionLines>* lines, boost::mutex* lines_mutex, const std::vector<float> &z) const;
     void make_loops(std::vector<IntersectionLine> &lines, Polygons* loops) const;
     void make_expolygons(const Polygons &loops, const float closing_radius, ExPolygons* slices) const;
@@ -111,6 +111,70 @@ void Zipper::add_entry(const std::string &name, const void *data, size_t l)
     m_data.clear();
 }
 
+Zipper::CompressedEntry Zipper::compress_entry(const std::string &name,
+                                               const void *       data,
+                                               size_t             l) const
+{
+    CompressedEntry entry;
+    entry.name = name;
+    entry.uncompressed_size = l;
+
+    int level = MZ_NO_COMPRESSION;
+    switch (m_compression) {
+    case NO_COMPRESSION: level = MZ_NO_COMPRESSION; break;
+    case FAST_COMPRESSION: level = MZ_BEST_SPEED; break;
+    case TIGHT_COMPRESSION: level = MZ_BEST_COMPRESSION; break;
+    }
+
+    // Same thresholds and parameters as mz_zip_writer_add_mem_ex uses, so
+    // the result is identical to adding the uncompressed buffer.
+    if (level != MZ_NO_COMPRESSION && l > 3) {
+        mz_uint flags = tdefl_create_comp_flags_from_zip_params(
+            level, -MZ_DEFAULT_WINDOW_BITS, MZ_DEFAULT_STRATEGY);
+
+        size_t outlen = 0;
+        void *pcomp = tdefl_compress_mem_to_heap(data, l, &outlen, int(flags));
+
+        if (pcomp) {
+            auto pptr = static_cast<const uint8_t*>(pcomp);
+            entry.data.assign(pptr, pptr + outlen);
+            entry.uncompressed_crc = uint32_t(mz_crc32(MZ_CRC32_INIT,
+                                            static_cast<const mz_uint8*>(data), l));
+            entry.deflated = true;
+            mz_free(pcomp);
+
+            return entry;
+        }
+    }
+
+    // Compression was not requested or failed: the data will be stored.
+    auto pptr = static_cast<const uint8_t*>(data);
+    entry.data.assign(pptr, pptr + l);
+
+    return entry;
+}
+
+void Zipper::add_entry(const CompressedEntry &entry)
+{
+    if(!m_impl->is_alive()) return;
+
+    finish_entry();
+
+    bool ok = entry.deflated ?
+        mz_zip_writer_add_mem_ex(&m_impl->arch, entry.name.c_str(),
+                                 entry.data.data(), entry.data.size(),
+                                 nullptr, 0, MZ_ZIP_FLAG_COMPRESSED_DATA,
+                                 entry.uncompressed_size, entry.uncompressed_crc) :
+        mz_zip_writer_add_mem(&m_impl->arch, entry.name.c_str(),
+                              entry.data.data(), entry.data.size(),
+                              MZ_NO_COMPRESSION);
+
+    if (!ok) m_impl->blow_up();
+
+    m_entry.clear();
+    m_data.clear();
+}
+
 void Zipper::finish_entry()
 {
     if(!m_impl->is_alive()) return;
@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <string>
 #include <memory>
+#include <vector>
 
 namespace Slic3r {
 
@@ -17,6 +18,17 @@ public:
         TIGHT_COMPRESSION
     };
 
+    // An entry with its data already compressed by compress_entry(). This
+    // allows the expensive deflate to run in parallel for multiple entries,
+    // only the final write into the archive is serialized.
+    struct CompressedEntry {
+        std::string          name;
+        std::vector<uint8_t> data;
+        size_t               uncompressed_size = 0;
+        uint32_t             uncompressed_crc = 0;
+        bool                 deflated = false;
+    };
+
 private:
     class Impl;
     std::unique_ptr<Impl> m_impl;
@@ -51,6 +63,16 @@ public:
     /// This method throws exactly like finish_entry() does.
     void add_entry(const std::string& name, const void* data, size_t bytes);
 
+    /// Compress a byte buffer with the compression level of this archive
+    /// without touching the archive itself. This method is thread safe.
+    CompressedEntry compress_entry(const std::string& name,
+                                   const void*        data,
+                                   size_t             bytes) const;
+
+    /// Add an entry prepared by compress_entry(). The previous entry is
+    /// finished. This method throws exactly like finish_entry() does.
+    void add_entry(const CompressedEntry& entry);
+
     // Writing data to the archive works like with standard streams. The target
     // within the zip file is the entry created with the add_entry method.
 
@@ -1126,6 +1126,8 @@ boost::any& Choice::get_value()
 			m_value = static_cast<PrintHostType>(ret_enum);
 		else if (m_opt_id.compare("display_orientation") == 0)
 			m_value = static_cast<SLADisplayOrientation>(ret_enum);
+		else if (m_opt_id.compare("layer_encoding") == 0)
+			m_value = static_cast<SLALayerEncoding>(ret_enum);
         else if (m_opt_id.compare("support_pillar_connection_mode") == 0)
             m_value = static_cast<SLAPillarConnectionMode>(ret_enum);
 		else if (m_opt_id == "printhost_authorization_type")
@@ -72,6 +72,7 @@ void MeshClipper::recalculate_triangles()
 
     // Now do the cutting
     std::vector<ExPolygons> list_of_expolys;
+    // The slicer caches its data for the last up direction, moving the plane along it only visits the facets near the plane.
     m_tms->set_up_direction(up.cast<float>());
     m_tms->slice(std::vector<float>{height_mesh}, SlicingMode::Regular, 0.f, &list_of_expolys, [](){});
     m_triangles2d = triangulate_expolygons_2f(list_of_expolys[0], m_trafo.get_matrix().matrix().determinant() < 0.);
@@ -102,7 +103,7 @@ void MeshClipper::recalculate_triangles()
 
 Vec3f MeshRaycaster::get_triangle_normal(size_t facet_idx) const
 {
-    return m_normals[facet_idx];
+    return m_emesh.get_triangle_mesh()->stl.facet_start[facet_idx].normal;
 }
 
 void MeshRaycaster::line_from_mouse_pos(const Vec2d& mouse_pos, const Transform3d& trafo, const Camera& camera,
@@ -222,7 +223,7 @@ Vec3f MeshRaycaster::get_closest_point(const Vec3f& point, Vec3f* normal) const
     Vec3d closest_point;
     m_emesh.squared_distance(point.cast<double>(), idx, closest_point);
     if (normal)
-        *normal = m_normals[idx];
+        *normal = this->get_triangle_normal(idx);
 
     return closest_point.cast<float>();
 }
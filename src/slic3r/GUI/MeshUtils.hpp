@@ -108,11 +108,7 @@ public:
     // during MeshRaycaster existence.
     MeshRaycaster(const TriangleMesh& mesh)
         : m_emesh(mesh)
-    {
-        m_normals.reserve(mesh.stl.facet_start.size());
-        for (const stl_facet& facet : mesh.stl.facet_start)
-            m_normals.push_back(facet.normal);
-    }
+    {}
 
     void line_from_mouse_pos(const Vec2d& mouse_pos, const Transform3d& trafo, const Camera& camera,
                              Vec3d& point, Vec3d& direction) const;
@@ -147,8 +143,8 @@ public:
     Vec3f get_triangle_normal(size_t facet_idx) const;
 
 private:
+    // The facet normals are read from the referenced mesh, they are not copied.
     sla::IndexedMesh m_emesh;
-    std::vector<stl_normal> m_normals;
 };
 
     
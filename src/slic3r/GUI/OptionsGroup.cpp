@@ -868,6 +868,9 @@ boost::any ConfigOptionsGroup::get_config_value(const DynamicPrintConfig& config
         else if (opt_key == "display_orientation") {
             ret  = static_cast<int>(config.option<ConfigOptionEnum<SLADisplayOrientation>>(opt_key)->value);
         }
+        else if (opt_key == "layer_encoding") {
+            ret  = static_cast<int>(config.option<ConfigOptionEnum<SLALayerEncoding>>(opt_key)->value);
+        }
         else if (opt_key == "support_pillar_connection_mode") {
             ret  = static_cast<int>(config.option<ConfigOptionEnum<SLAPillarConnectionMode>>(opt_key)->value);
         }
@@ -2296,6 +2296,10 @@ void TabPrinter::build_sla()
     optgroup->append_single_option_line("elefant_foot_compensation");
     optgroup->append_single_option_line("elefant_foot_min_width");
     optgroup->append_single_option_line("gamma_correction");
+
+    optgroup = page->new_optgroup(L("Output"));
+    optgroup->append_single_option_line("layer_encoding");
+    optgroup->append_single_option_line("fast_rasterization");
     
     optgroup = page->new_optgroup(L("Exposure"));
     optgroup->append_single_option_line("min_exposure_time");
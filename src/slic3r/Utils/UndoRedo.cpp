@@ -1,4 +1,5 @@
 #include "UndoRedo.hpp"
+#include "UndoRedoDelta.hpp"
 
 #include <algorithm>
 #include <iostream>
@@ -7,6 +8,11 @@
 #include <typeinfo> 
 #include <cassert>
 #include <cstddef>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <map>
+#include <set>
 
 #include <cereal/types/polymorphic.hpp>
 #include <cereal/types/map.hpp> 
@@ -20,6 +26,7 @@
 #include <libslic3r/PrintConfig.hpp>
 #include <libslic3r/ObjectID.hpp>
 #include <libslic3r/Utils.hpp>
+#include <libslic3r/Thread.hpp>
 
 #include <boost/foreach.hpp>
 
@@ -296,6 +303,83 @@ private:
 	std::string 				m_serialized;
 };
 
+// Small edits of big mutable objects (for example the painted supports of a ModelVolume) change
+// just a small part of the serialized data. The delta is a sequence of segments, each segment
+// starts with a 16 byte header (offset into the base data, size). A segment either copies a range
+// of the base data, or its offset is SIZE_MAX and the segment data follows the header.
+// The headers are not aligned inside the delta, they are only accessed through memcpy().
+namespace delta {
+	// Granularity of the comparison of the part of the data which differs in between the common prefix and suffix.
+	static constexpr const size_t 	BlockSize 	= 256;
+	static constexpr const uint64_t Literal 	= uint64_t(-1);
+
+	static inline void append_segment(std::string &out, uint64_t offset, uint64_t size, const char *literal)
+	{
+		uint64_t header[2] = { offset, size };
+		out.append((const char*)header, sizeof(header));
+		if (literal != nullptr)
+			out.append(literal, size);
+	}
+
+	std::string encode(const char *base, size_t base_size, const std::string &data)
+	{
+		const size_t size   = data.size();
+		const size_t common = std::min(base_size, size);
+		size_t prefix = 0;
+		while (prefix < common && base[prefix] == data[prefix])
+			++ prefix;
+		size_t suffix = 0;
+		while (suffix < common - prefix && base[base_size - suffix - 1] == data[size - suffix - 1])
+			++ suffix;
+
+		std::string out;
+		if (prefix > 0)
+			append_segment(out, 0, prefix, nullptr);
+		// Compare the rest block by block at the same offsets, which captures scattered changes of data of constant size.
+		uint64_t literal_begin = prefix;
+		for (size_t begin = prefix; begin < size - suffix;) {
+			size_t end = std::min(begin + BlockSize, size - suffix);
+			if (end <= base_size - suffix && memcmp(base + begin, data.data() + begin, end - begin) == 0) {
+				if (literal_begin < begin)
+					append_segment(out, Literal, begin - literal_begin, data.data() + literal_begin);
+				// Merge with the preceding copy segment if continuous.
+				uint64_t last[2] = { Literal, 0 };
+				if (out.size() >= sizeof(last))
+					memcpy(last, out.data() + out.size() - sizeof(last), sizeof(last));
+				if (literal_begin == begin && last[0] != Literal && last[0] + last[1] == begin) {
+					last[1] += end - begin;
+					memcpy(&out[out.size() - sizeof(last)], last, sizeof(last));
+				} else
+					append_segment(out, begin, end - begin, nullptr);
+				literal_begin = end;
+			}
+			begin = end;
+		}
+		if (literal_begin < size - suffix)
+			append_segment(out, Literal, size - suffix - literal_begin, data.data() + literal_begin);
+		if (suffix > 0)
+			append_segment(out, base_size - suffix, suffix, nullptr);
+		return out;
+	}
+
+	void decode(const std::string &base, const char *delta, size_t delta_size, std::string &out)
+	{
+		out.clear();
+		for (const char *ptr = delta, *end = delta + delta_size; ptr < end;) {
+			uint64_t header[2];
+			memcpy(header, ptr, sizeof(header));
+			ptr += sizeof(header);
+			if (header[0] == Literal) {
+				out.append(ptr, header[1]);
+				ptr += header[1];
+			} else {
+				assert(header[0] + header[1] <= base.size());
+				out.append(base.data() + header[0], header[1]);
+			}
+		}
+	}
+} // namespace delta
+
 struct MutableHistoryInterval
 {
 private:
@@ -303,26 +387,79 @@ private:
 	{
 		// Reference counter of this data chunk. We may have used shared_ptr, but the shared_ptr is thread safe
 		// with the associated cost of CPU cache invalidation on refcount change.
+		// Both the history intervals and the deltas referencing this data as their base are counted.
 		size_t		refcnt;
+		// If not null, the data stored here is a delta against the base data.
+		Data	   *base;
+		// Number of deltas to apply to reconstruct the data, to limit the cost of the reconstruction.
+		size_t 		depth;
+		// Size of the reconstructed data.
+		size_t 		full_size;
+		// First 8 bytes of the reconstructed data, where the timestamp is serialized.
+		char 		head[8];
 		size_t		size;
 		char 		data[1];
 
-		// The serialized data matches the data stored here.
-		bool 		matches(const std::string& rhs) { return this->size == rhs.size() && memcmp(this->data, rhs.data(), this->size) == 0; }
+		static Data* create(const std::string &full_data, Data *base, const std::string &stored_data) {
+			Data *out = (Data*)new char[offsetof(Data, data) + stored_data.size()];
+			out->refcnt    = 1;
+			out->base      = base;
+			out->depth     = (base == nullptr) ? 0 : base->depth + 1;
+			out->full_size = full_data.size();
+			memset(out->head, 0, sizeof(out->head));
+			memcpy(out->head, full_data.data(), std::min(full_data.size(), sizeof(out->head)));
+			out->size      = stored_data.size();
+			memcpy(out->data, stored_data.data(), stored_data.size());
+			if (base != nullptr)
+				++ base->refcnt;
+			return out;
+		}
+
+		static void release(Data *data) {
+			while (data != nullptr && -- data->refcnt == 0) {
+				Data *base = data->base;
+				delete[] (char*)data;
+				data = base;
+			}
+		}
+
+		void 		reconstruct(std::string &out) const {
+			if (this->base == nullptr)
+				out.assign(this->data, this->data + this->size);
+			else {
+				std::string base_data;
+				this->base->reconstruct(base_data);
+				delta::decode(base_data, this->data, this->size, out);
+			}
+			assert(out.size() == this->full_size);
+		}
 
 		// The timestamp matches the timestamp serialized in the data stored here.
-		bool 		matches_timestamp(uint64_t timestamp) { assert(timestamp > 0);  assert(this->size > 8); return memcmp(this->data, &timestamp, 8) == 0; }
+		bool 		matches_timestamp(uint64_t timestamp) { assert(timestamp > 0);  assert(this->full_size > 8); return memcmp(this->head, &timestamp, 8) == 0; }
+
+		// Memory occupied by this data including the shares of the base data.
+		size_t 		memsize() const { return this->size + (this->base ? (this->base->memsize() + this->base->refcnt - 1) / this->base->refcnt : 0); }
 	};
 
 	Interval    m_interval;
 	Data	   *m_data;
 
 public:
-	MutableHistoryInterval(const Interval &interval, const std::string &input_data) : m_interval(interval), m_data(nullptr) {
-		m_data = (Data*)new char[offsetof(Data, data) + input_data.size()];
-		m_data->refcnt = 1;
-		m_data->size = input_data.size();
-		memcpy(m_data->data, input_data.data(), input_data.size());
+	// Maximum length of a chain of deltas.
+	static constexpr const size_t MaxDeltaDepth = 8;
+
+	MutableHistoryInterval(const Interval &interval, const std::string &input_data) : m_interval(interval), m_data(Data::create(input_data, nullptr, input_data)) {}
+
+	// Store the input data as a delta against the data of the other interval if it pays off.
+	// full_other_data is the reconstructed data of the other interval.
+	MutableHistoryInterval(const Interval &interval, const std::string &input_data, const MutableHistoryInterval &other, const char *full_other_data, size_t full_other_size) : m_interval(interval), m_data(nullptr) {
+		if (other.m_data->depth < MaxDeltaDepth) {
+			std::string encoded = delta::encode(full_other_data, full_other_size, input_data);
+			if (encoded.size() < input_data.size() / 2)
+				m_data = Data::create(input_data, other.m_data, encoded);
+		}
+		if (m_data == nullptr)
+			m_data = Data::create(input_data, nullptr, input_data);
 	}
 
 	MutableHistoryInterval(const Interval &interval, MutableHistoryInterval &other) : m_interval(interval), m_data(other.m_data) {
@@ -333,12 +470,9 @@ public:
 	MutableHistoryInterval(const size_t begin, const size_t end) : m_interval(begin, end), m_data(nullptr) {}
 
 	MutableHistoryInterval(MutableHistoryInterval&& rhs) : m_interval(rhs.m_interval), m_data(rhs.m_data) { rhs.m_data = nullptr; }
-	MutableHistoryInterval& operator=(MutableHistoryInterval&& rhs) { m_interval = rhs.m_interval; m_data = rhs.m_data; rhs.m_data = nullptr; return *this; }
+	MutableHistoryInterval& operator=(MutableHistoryInterval&& rhs) { Data::release(m_data); m_interval = rhs.m_interval; m_data = rhs.m_data; rhs.m_data = nullptr; return *this; }
 
-	~MutableHistoryInterval() {
-		if (m_data != nullptr && -- m_data->refcnt == 0)
-			delete[] (char*)m_data;
-	}
+	~MutableHistoryInterval() { Data::release(m_data); }
 
 	const Interval& interval() const { return m_interval; }
 	size_t		begin() const { return m_interval.begin(); }
@@ -353,15 +487,26 @@ public:
 	const char* data() const { return m_data->data; }
 	size_t  	size() const { return m_data->size; }
 	size_t		refcnt() const { return m_data->refcnt; }
-	bool		matches(const std::string& data) { return m_data->matches(data); }
+	bool 		is_delta() const { return m_data->base != nullptr; }
+	bool 		has_data() const { return m_data != nullptr; }
+	bool 		shares_data(const MutableHistoryInterval &rhs) const { return m_data == rhs.m_data; }
+	void 		full_data(std::string &out) const { m_data->reconstruct(out); }
 	bool		matches_timestamp(uint64_t timestamp) { return m_data->matches_timestamp(timestamp); }
 	size_t 		memsize() const {
 		return m_data->refcnt == 1 ?
 			// Count just the size of the snapshot data.
-			m_data->size :
+			m_data->memsize() :
 			// Count the size of the snapshot data divided by the number of references, rounded up.
-			(m_data->size + m_data->refcnt - 1) / m_data->refcnt;
+			(m_data->memsize() + m_data->refcnt - 1) / m_data->refcnt;
+	}
+
+#ifndef NDEBUG
+	// Count the references to the data of this interval held by the bases of the deltas, each data is visited once.
+	void 		count_base_references(std::map<const char*, size_t> &refcntrs, std::set<const char*> &visited) const {
+		for (const Data *data = m_data; data->base != nullptr && visited.insert(data->data).second; data = data->base)
+			++ refcntrs[data->base->data];
 	}
+#endif /* NDEBUG */
 
 private:
 	MutableHistoryInterval(const MutableHistoryInterval &rhs);
@@ -396,7 +541,7 @@ public:
 
 	// Estimated size in memory, to be used to drop least recently used snapshots.
 	size_t memsize() const override {
-		size_t memsize = sizeof(*this);
+		size_t memsize = sizeof(*this) + m_last_data.capacity();
 		memsize += m_history.size() * sizeof(MutableHistoryInterval);
 		for (const MutableHistoryInterval &interval : m_history)
 			memsize += interval.memsize();
@@ -426,22 +571,47 @@ public:
 
 	void save(size_t active_snapshot_time, size_t current_time, const std::string &data) {
 		assert(m_history.empty() || m_history.back().end() <= active_snapshot_time);
-		if (m_history.empty() || m_history.back().end() < active_snapshot_time) {
-			if (! m_history.empty() && m_history.back().matches(data))
+		if (m_history.empty()) {
+			// Allocate new data.
+			m_history.emplace_back(Interval(current_time, current_time + 1), data);
+			return;
+		}
+		// The previous data stored as a delta is reconstructed only if it was not cached by the previous save().
+		const char *last_data = m_history.back().data();
+		size_t 		last_size = m_history.back().size();
+		if (m_history.back().is_delta()) {
+			if (! m_last_data_ref.shares_data(m_history.back())) {
+				m_history.back().full_data(m_last_data);
+				m_last_data_ref = MutableHistoryInterval(Interval(0, 0), m_history.back());
+			}
+			last_data = m_last_data.data();
+			last_size = m_last_data.size();
+		}
+		bool matches = last_size == data.size() && memcmp(last_data, data.data(), last_size) == 0;
+		if (m_history.back().end() < active_snapshot_time) {
+			if (matches)
 				// Share the previous data by reference counting.
 				m_history.emplace_back(Interval(current_time, current_time + 1), m_history.back());
 			else
-				// Allocate new data.
-				m_history.emplace_back(Interval(current_time, current_time + 1), data);
+				// Allocate new data, possibly as a delta against the previous data.
+				m_history.emplace_back(Interval(current_time, current_time + 1), data, m_history.back(), last_data, last_size);
 		} else {
-			assert(! m_history.empty());
 			assert(m_history.back().end() == active_snapshot_time);
-			if (m_history.back().matches(data))
+			if (matches)
 				// Just extend the last interval using the old data.
 				m_history.back().extend_end(current_time + 1);
 			else
-				// Allocate new data time continuous with the previous data.
-				m_history.emplace_back(Interval(active_snapshot_time, current_time + 1), data);
+				// Allocate new data time continuous with the previous data, possibly as a delta against the previous data.
+				m_history.emplace_back(Interval(active_snapshot_time, current_time + 1), data, m_history.back(), last_data, last_size);
+		}
+		if (! m_history.back().is_delta()) {
+			// The full data is stored, release the cache.
+			m_last_data = std::string();
+			m_last_data_ref = MutableHistoryInterval(0, 0);
+		} else if (! m_last_data_ref.shares_data(m_history.back())) {
+			// A new delta was stored, its full data is the input data.
+			m_last_data = data;
+			m_last_data_ref = MutableHistoryInterval(Interval(0, 0), m_history.back());
 		}
 	}
 
@@ -453,7 +623,9 @@ public:
 			-- it;
 		}
 		assert(timestamp >= it->begin() && timestamp < it->end());
-		return std::string(it->data(), it->data() + it->size());
+		std::string out;
+		it->full_data(out);
+		return out;
 	}
 
 	// Currently all mutable snapshots are mandatory.
@@ -465,7 +637,7 @@ public:
 	std::string format() override {
 		std::string out = typeid(T).name();
 		for (const MutableHistoryInterval &interval : m_history)
-			out += std::string(", ptr:") + ptr_to_string(interval.data()) + " len:" + std::to_string(interval.size()) + " <" + std::to_string(interval.begin()) + "," + std::to_string(interval.end()) + ")";
+			out += std::string(", ptr:") + ptr_to_string(interval.data()) + (interval.is_delta() ? " delta" : "") + " len:" + std::to_string(interval.size()) + " <" + std::to_string(interval.begin()) + "," + std::to_string(interval.end()) + ")";
 		return out;
 	}
 #endif /* SLIC3R_UNDOREDO_DEBUG */
@@ -473,6 +645,12 @@ public:
 #ifndef NDEBUG
 	bool valid() override;
 #endif /* NDEBUG */
+
+private:
+	// Full data of the last snapshot if it is stored as a delta, so that the chain of deltas is not reconstructed
+	// by every save(). m_last_data_ref shares the data of that snapshot, which therefore cannot be released and reused.
+	std::string 			m_last_data;
+	MutableHistoryInterval 	m_last_data_ref { 0, 0 };
 };
 
 #ifndef NDEBUG
@@ -502,6 +680,14 @@ bool MutableObjectHistory<T>::valid()
 			assert(m_history[i - 1].interval().strictly_before(m_history[i].interval()));
 			++ refcntrs[m_history[i].data()];
 		}
+		// The deltas hold references to their base data, the cache of the last full data holds a reference as well.
+		std::set<const char*> visited;
+		for (const auto &hi : m_history)
+			hi.count_base_references(refcntrs, visited);
+		if (m_last_data_ref.has_data()) {
+			++ refcntrs[m_last_data_ref.data()];
+			m_last_data_ref.count_base_references(refcntrs, visited);
+		}
 		for (const auto &hi : m_history) {
 			assert(hi.data() != nullptr);
 			assert(refcntrs[hi.data()] == hi.refcnt());
@@ -517,8 +703,12 @@ public:
 	// Stack needs to be initialized. An empty stack is not valid, there must be a "New Project" status stored at the beginning.
 	// Initially enable Undo / Redo stack to occupy maximum 10% of the total system physical memory.
 	StackImpl() : m_memory_limit(std::min(Slic3r::total_physical_memory() / 10, size_t(1 * 16384 * 65536 / UNDO_REDO_DEBUG_LOW_MEM_FACTOR))), m_active_snapshot_time(0), m_current_time(0) {}
+	~StackImpl() { this->join_store_thread(); }
 
 	void clear() {
+		this->join_store_thread();
+		m_store_exception = nullptr;
+		m_release_pending = false;
 		m_objects.clear();
 		m_shared_ptr_to_object_id.clear();
 		m_snapshots.clear();
@@ -528,8 +718,9 @@ public:
 	}
 
 	bool empty() const {
-		assert(m_objects.empty() == m_snapshots.empty());
-		assert(! m_objects.empty() || (m_current_time == 0 && m_active_snapshot_time == 0));
+		// The histories are being modified by the store thread.
+		assert(this->store_pending() || m_objects.empty() == m_snapshots.empty());
+		assert(this->store_pending() || ! m_objects.empty() || (m_current_time == 0 && m_active_snapshot_time == 0));
 		return m_snapshots.empty();
 	}
 
@@ -542,6 +733,8 @@ public:
 			memsize += object.second->memsize();
 		return memsize;
 	}
+	// While the last snapshot is being stored, the memory occupied after the snapshot before is returned.
+	size_t memsize_stored() const { return this->store_pending() ? m_memsize_stored : this->memsize(); }
 
     // Store the current application state onto the Undo / Redo stack, remove all snapshots after m_active_snapshot_time.
     void take_snapshot(const std::string& snapshot_name, const Slic3r::Model& model, const Slic3r::GUI::Selection& selection, const Slic3r::GUI::GLGizmosManager& gizmos, const SnapshotData &snapshot_data);
@@ -553,6 +746,11 @@ public:
     bool redo(Slic3r::Model &model, Slic3r::GUI::GLGizmosManager &gizmos, size_t jump_to_time);
 	void release_least_recently_used();
 
+	// The serialized data of the mutable objects is stored into their histories (compared against the previous
+	// snapshot and possibly delta encoded) by a background thread, so that the UI thread only serializes.
+	// The histories are only accessed after this call returns.
+	void wait_for_store();
+
 	// Snapshot history (names with timestamps).
 	const std::vector<Snapshot>& 	snapshots() const { return m_snapshots; }
 	// Timestamp of the active snapshot.
@@ -600,8 +798,10 @@ public:
 		auto it = std::lower_bound(m_snapshots.begin(), m_snapshots.end(), Snapshot(m_active_snapshot_time));
 		assert(it != m_snapshots.begin() && it != m_snapshots.end() && it->timestamp == m_active_snapshot_time);
 		assert(m_active_snapshot_time <= m_snapshots.back().timestamp);
-		for (auto it = m_objects.begin(); it != m_objects.end(); ++ it)
-			assert(it->second->valid());
+		// The histories are being modified by the store thread.
+		if (! this->store_pending())
+			for (auto it = m_objects.begin(); it != m_objects.end(); ++ it)
+				assert(it->second->valid());
 		return true;
 	}
 #endif /* NDEBUG */
@@ -620,6 +820,8 @@ private:
 		return it->second;
 	}
 	void 							collect_garbage();
+	bool 							store_pending() const { return m_store_thread.joinable(); }
+	void 							join_store_thread() { if (m_store_thread.joinable()) m_store_thread.join(); }
 
 	// Maximum memory allowed to be occupied by the Undo / Redo stack. If the limit is exceeded,
 	// least recently used snapshots will be released.
@@ -637,6 +839,17 @@ private:
 	size_t 													m_current_time;
 	// Last selection serialized or deserialized.
 	Selection 												m_selection;
+	// Serialized data of the mutable objects of the snapshot being taken, to be stored into their histories by m_store_thread.
+	std::vector<std::function<void()>> 						m_pending_saves;
+	boost::thread 											m_store_thread;
+	// Exception thrown by m_store_thread, rethrown by wait_for_store().
+	std::exception_ptr 										m_store_exception;
+	// Memory occupied by the Undo / Redo stack, calculated by m_store_thread after storing a snapshot
+	// and handed over to m_memsize_stored by wait_for_store().
+	size_t 													m_memsize_store_result = 0;
+	size_t 													m_memsize_stored = 0;
+	// release_least_recently_used() was called while a snapshot was being stored.
+	bool 													m_release_pending = false;
 };
 
 using InputArchive  = cereal::UserDataAdapter<StackImpl, cereal::BinaryInputArchive>;
@@ -784,13 +997,16 @@ template<typename T> ObjectID StackImpl::save_mutable_object(const T &object)
 			needs_to_save = ! object_history->try_save_timestamp(m_active_snapshot_time, m_current_time, timestamp);
 	}
 	if (needs_to_save) {
-		// Serialize the object into a string.
+		// Serialize the object into a string. The object may be modified right after the snapshot is taken,
+		// the serialized data is its copy to be compared and stored by the store thread.
 		std::ostringstream oss;
 		{
 			Slic3r::UndoRedo::OutputArchive archive(*this, oss);
 			archive(object);
 		}
-		object_history->save(m_active_snapshot_time, m_current_time, oss.str());
+		m_pending_saves.emplace_back([object_history, active_snapshot_time = m_active_snapshot_time, current_time = m_current_time, data = oss.str()]() {
+			object_history->save(active_snapshot_time, current_time, data);
+		});
 	}
 	return object.id();
 }
@@ -846,6 +1062,7 @@ template<typename T> void StackImpl::load_mutable_object(const Slic3r::ObjectID
 // Store the current application state onto the Undo / Redo stack, remove all snapshots after m_active_snapshot_time.
 void StackImpl::take_snapshot(const std::string& snapshot_name, const Slic3r::Model& model, const Slic3r::GUI::Selection& selection, const Slic3r::GUI::GLGizmosManager& gizmos, const SnapshotData &snapshot_data)
 {
+	this->wait_for_store();
 	// Release old snapshot data.
 	assert(m_active_snapshot_time <= m_current_time);
 	for (auto &kvp : m_objects)
@@ -869,13 +1086,43 @@ void StackImpl::take_snapshot(const std::string& snapshot_name, const Slic3r::Mo
 	// Save snapshot info of the last "current" aka "top most" state, that is only being serialized
 	// if undoing an action. Such a snapshot has an invalid Model ID assigned if it was not taken yet.
 	m_snapshots.emplace_back(topmost_snapshot_name, m_active_snapshot_time, 0, snapshot_data);
-	// Release empty objects from the history.
-	this->collect_garbage();
+	// Compare the serialized data against the previous snapshots and store it in the background.
+	// The histories, m_objects and m_shared_ptr_to_object_id are not touched by the UI thread until wait_for_store().
+	m_store_thread = create_thread([this, pending_saves = std::move(m_pending_saves)]() {
+		try {
+			for (const std::function<void()> &save : pending_saves)
+				save();
+			// Release empty objects from the history.
+			this->collect_garbage();
+			m_memsize_store_result = this->memsize();
+		} catch (...) {
+			m_store_exception = std::current_exception();
+		}
+	});
+	m_pending_saves.clear();
+}
+
+void StackImpl::wait_for_store()
+{
+	if (! this->store_pending())
+		return;
+	m_store_thread.join();
+	m_memsize_stored = m_memsize_store_result;
+	if (m_store_exception) {
+		std::exception_ptr ex = m_store_exception;
+		m_store_exception = nullptr;
+		std::rethrow_exception(ex);
+	}
 	assert(this->valid());
 #ifdef SLIC3R_UNDOREDO_DEBUG
 	std::cout << "After snapshot" << std::endl;
 	this->print();
 #endif /* SLIC3R_UNDOREDO_DEBUG */
+	if (m_release_pending) {
+		m_release_pending = false;
+		if (m_memsize_stored > m_memory_limit)
+			this->release_least_recently_used();
+	}
 }
 
 void StackImpl::load_snapshot(size_t timestamp, Slic3r::Model& model, Slic3r::GUI::GLGizmosManager& gizmos)
@@ -884,6 +1131,7 @@ void StackImpl::load_snapshot(size_t timestamp, Slic3r::Model& model, Slic3r::GU
 	const auto it_snapshot = std::lower_bound(m_snapshots.begin(), m_snapshots.end(), Snapshot(timestamp));
 	if (it_snapshot == m_snapshots.end() || it_snapshot->timestamp != timestamp)
 		throw Slic3r::RuntimeError((boost::format("Snapshot with timestamp %1% does not exist") % timestamp).str());
+	this->wait_for_store();
 
 	m_active_snapshot_time = timestamp;
 	model.clear_objects();
@@ -989,6 +1237,11 @@ void StackImpl::collect_garbage()
 
 void StackImpl::release_least_recently_used()
 {
+	if (this->store_pending()) {
+		// Release after the snapshot is stored, if the memory limit is exceeded, see wait_for_store().
+		m_release_pending = true;
+		return;
+	}
 	assert(this->valid());
 	size_t current_memsize = this->memsize();
 #ifdef SLIC3R_UNDOREDO_DEBUG
@@ -1078,7 +1331,7 @@ bool Stack::empty() const { return pimpl->empty(); }
 
 void Stack::set_memory_limit(size_t memsize) { pimpl->set_memory_limit(memsize); }
 size_t Stack::get_memory_limit() const { return pimpl->get_memory_limit(); }
-size_t Stack::memsize() const { return pimpl->memsize(); }
+size_t Stack::memsize() const { return pimpl->memsize_stored(); }
 void Stack::release_least_recently_used() { pimpl->release_least_recently_used(); }
 void Stack::take_snapshot(const std::string& snapshot_name, const Slic3r::Model& model, const Slic3r::GUI::Selection& selection, const Slic3r::GUI::GLGizmosManager& gizmos, const SnapshotData &snapshot_data)
 	{ pimpl->take_snapshot(snapshot_name, model, selection, gizmos, snapshot_data); }
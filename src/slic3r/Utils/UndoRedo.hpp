@@ -96,12 +96,15 @@ public:
 	size_t get_memory_limit() const;
 
 	// Estimate size of the RAM consumed by the Undo / Redo stack.
+	// While a snapshot is being stored in the background, the estimate after the previous snapshot is returned.
 	size_t memsize() const;
 
 	// Release least recently used snapshots up to the memory limit set above.
 	void release_least_recently_used();
 
 	// Store the current application state onto the Undo / Redo stack, remove all snapshots after m_active_snapshot_time.
+	// The state is serialized by the calling thread, the serialized data is compared to the previous snapshots and stored
+	// by a background thread. The next call to the stack waits for it.
     void take_snapshot(const std::string& snapshot_name, const Slic3r::Model& model, const Slic3r::GUI::Selection& selection, const Slic3r::GUI::GLGizmosManager& gizmos, const SnapshotData &snapshot_data);
 
 	// To be queried to enable / disable the Undo / Redo buttons at the UI.
@@ -0,0 +1,21 @@
+#ifndef slic3r_Utils_UndoRedoDelta_hpp_
+#define slic3r_Utils_UndoRedoDelta_hpp_
+
+#include <string>
+
+// Implementation detail of the Undo / Redo stack, exposed for the unit tests only.
+namespace Slic3r {
+namespace UndoRedo {
+
+// Delta encoding of a mutable object snapshot against the previous snapshot of the same object.
+namespace delta {
+	// Encode data as a delta against the base data.
+	std::string encode(const char *base, size_t base_size, const std::string &data);
+	// Reconstruct the data from the base data and the delta.
+	void 		decode(const std::string &base, const char *delta, size_t delta_size, std::string &out);
+} // namespace delta
+
+} // namespace UndoRedo
+} // namespace Slic3r
+
+#endif /* slic3r_Utils_UndoRedoDelta_hpp_ */
@@ -1,7 +1,11 @@
 #include <catch2/catch.hpp>
 
+#include <iomanip>
 #include <memory>
+#include <random>
+#include <sstream>
 
+#include "libslic3r/GCodeReader.hpp"
 #include "libslic3r/GCodeWriter.hpp"
 
 using namespace Slic3r;
@@ -94,3 +98,87 @@ SCENARIO("set_speed emits values with fixed-point output.", "[GCodeWriter]") {
         }
     }
 }
+
+SCENARIO("Moves are formatted the same way as by std::ostringstream.", "[GCodeWriter]") {
+    // Ties of the decimal rounding, negative zeros, huge values and random values of the G-code magnitudes.
+    std::vector<double> values { 0., -0., 0.0005, 0.0015, 0.0025, -0.0005, -0.0004, 1.0005, 2.5, 0.125, 0.0625, 0.03125,
+                                 123456.0005, 99999.9995, 1e14, 1e15, 1e16, -1e17, 4.0000000001, 8.9999999999 };
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<double> small(-1., 1.), large(-10000., 10000.);
+    for (size_t i = 0; i < 5000; ++ i) {
+        values.emplace_back(small(rng));
+        values.emplace_back(large(rng));
+        // Values with up to 4 decimal digits, the halves are ties if they are exact in binary.
+        values.emplace_back(double(int(large(rng) * 1000.)) / 10000.);
+    }
+    auto format = [](double v, int precision) {
+        std::ostringstream ss;
+        ss << std::fixed << std::setprecision(precision) << v;
+        return ss.str();
+    };
+
+    GIVEN("GCodeWriter instance with a single extruder") {
+        GCodeWriter writer;
+        writer.set_extruders({ 0 });
+        writer.set_extruder(0);
+        const std::string F = format(writer.config.travel_speed.value * 60., 3);
+        WHEN("travel_to_xy is called") {
+            THEN("X and Y are emitted with 3 decimal digits") {
+                size_t num_mismatches = 0;
+                for (size_t i = 0; i + 1 < values.size(); ++ i)
+                    if (writer.travel_to_xy(Vec2d(values[i], values[i + 1])) != "G1 X" + format(values[i], 3) + " Y" + format(values[i + 1], 3) + " F" + F + "\n")
+                        ++ num_mismatches;
+                REQUIRE(num_mismatches == 0);
+            }
+        }
+        WHEN("extrude_to_xy is called") {
+            THEN("E is emitted with 5 decimal digits") {
+                size_t num_mismatches = 0;
+                for (double v : values) {
+                    std::string gcode = writer.extrude_to_xy(Vec2d(1., 2.), v);
+                    if (gcode != "G1 X1.000 Y2.000 E" + format(writer.extruder()->E(), 5) + "\n")
+                        ++ num_mismatches;
+                }
+                REQUIRE(num_mismatches == 0);
+            }
+        }
+        WHEN("The Z of a move is replaced by GCodeReader::GCodeLine::set, as the spiral vase does") {
+            THEN("Z is emitted with 3 decimal digits") {
+                GCodeReader reader;
+                size_t num_mismatches = 0;
+                for (double v : values) {
+                    // The new value is a float.
+                    const float z = float(v);
+                    reader.parse_line("G1 X1.000 Y2.000 Z0.200 E0.50000", [z, &format, &num_mismatches](GCodeReader &reader, GCodeReader::GCodeLine &line) {
+                        line.set(reader, Z, z);
+                        if (line.raw() != "G1 X1.000 Y2.000 Z" + format(z, 3) + " E0.50000")
+                            ++ num_mismatches;
+                    });
+                }
+                REQUIRE(num_mismatches == 0);
+            }
+        }
+        WHEN("The emitted values are parsed back") {
+            THEN("GCodeReader::parse_double returns the same values as strtod") {
+                size_t num_mismatches = 0;
+                for (double v : values)
+                    for (int precision : { 3, 5, 12 }) {
+                        std::string str = format(v, precision);
+                        char *end1 = nullptr, *end2 = nullptr;
+                        double v1 = GCodeReader::parse_double(str.c_str(), &end1);
+                        double v2 = strtod(str.c_str(), &end2);
+                        if (v1 != v2 || std::signbit(v1) != std::signbit(v2) || end1 != end2)
+                            ++ num_mismatches;
+                    }
+                for (const char *str : { "1e3", "-.5", "+7.", ".", "-", "12abc", "0x10", " 1", "nan", "1234567890123456789.5" }) {
+                    char *end1 = nullptr, *end2 = nullptr;
+                    double v1 = GCodeReader::parse_double(str, &end1);
+                    double v2 = strtod(str, &end2);
+                    if (! (v1 == v2 || (std::isnan(v1) && std::isnan(v2))) || end1 != end2)
+                        ++ num_mismatches;
+                }
+                REQUIRE(num_mismatches == 0);
+            }
+        }
+    }
+}
@@ -3,6 +3,7 @@
 #include "libslic3r/libslic3r.h"
 #include "libslic3r/Print.hpp"
 #include "libslic3r/Layer.hpp"
+#include "libslic3r/GCode/WipeTower.hpp"
 
 #include "test_data.hpp"
 
@@ -126,3 +127,49 @@ SCENARIO("Print: Brim generation", "[Print]") {
         }
     }
 }
+
+SCENARIO("Print: Wipe tower planning", "[Print]") {
+    GIVEN("Two 20mm cubes with perimeters printed by the first extruder and infill by the second extruder") {
+        Slic3r::DynamicPrintConfig config = Slic3r::DynamicPrintConfig::full_print_config();
+        config.set_num_extruders(2);
+        config.set_deserialize({
+            { "wipe_tower",             1 },
+            { "wipe_into_infill",       1 },
+            { "perimeter_extruder",     1 },
+            { "infill_extruder",        2 },
+            { "solid_infill_extruder",  2 },
+            { "layer_height",           0.5 },
+            { "first_layer_height",     0.5 }
+        });
+        WHEN("The wipe tower is planned") {
+            Slic3r::Print print;
+            Slic3r::Test::init_and_process_print({ TestMesh::cube_20x20x20, TestMesh::cube_20x20x20 }, print, config);
+            const ToolOrdering &tool_ordering = print.tool_ordering();
+            THEN("The wipe tower performs the tool changes of the tool ordering in order") {
+                REQUIRE(std::distance(tool_ordering.begin(), tool_ordering.end()) == 40);
+                std::vector<std::pair<int, int>> planned;
+                unsigned int current_extruder = tool_ordering.all_extruders().back();
+                for (const LayerTools &lt : tool_ordering)
+                    for (unsigned int extruder : lt.extruders)
+                        if (extruder != current_extruder) {
+                            planned.emplace_back(int(current_extruder), int(extruder));
+                            current_extruder = extruder;
+                        }
+                std::vector<std::pair<int, int>> generated;
+                for (const std::vector<WipeTower::ToolChangeResult> &layer_tool_changes : print.wipe_tower_data().tool_changes)
+                    for (const WipeTower::ToolChangeResult &tool_change : layer_tool_changes)
+                        if (tool_change.initial_tool != tool_change.new_tool)
+                            generated.emplace_back(tool_change.initial_tool, tool_change.new_tool);
+                REQUIRE(! planned.empty());
+                REQUIRE(generated == planned);
+            }
+            THEN("Some infill is used for wiping") {
+                size_t num_layers_overridden = 0;
+                for (LayerTools &lt : const_cast<ToolOrdering&>(tool_ordering).layer_tools())
+                    if (lt.wiping_extrusions().is_anything_overridden())
+                        ++ num_layers_overridden;
+                REQUIRE(num_layers_overridden > 0);
+            }
+        }
+    }
+}
@@ -201,6 +201,29 @@ SCENARIO( "PrintGCode basic functionality", "[PrintGCode]") {
                 REQUIRE(gcode.find("M107") != std::string::npos);
             }
         }
+        WHEN("Spiral vase is enabled") {
+			std::string gcode = ::Test::slice({ TestMesh::cube_20x20x20 }, {
+				{ "spiral_vase",                true },
+                { "perimeters",                 1 },
+                { "fill_density",               0 },
+                { "top_solid_layers",           0 },
+                { "bottom_solid_layers",        3 },
+                { "layer_height",               0.4 },
+                { "first_layer_height",         0.4 }
+                });
+            THEN("The walls above the bottom layers are extruded while raising Z") {
+                size_t num_spiral_moves = 0;
+                double final_z          = 0.;
+                GCodeReader reader;
+                reader.parse_buffer(gcode, [&num_spiral_moves, &final_z] (GCodeReader& self, const GCodeReader::GCodeLine& line) {
+                    if (line.cmd_is("G1") && line.extruding(self) && line.dist_XY(self) > 0. && line.dist_Z(self) > 0.)
+                        ++ num_spiral_moves;
+                    final_z = std::max<double>(final_z, static_cast<double>(self.z()));
+                });
+                REQUIRE(num_spiral_moves > 0);
+                REQUIRE(final_z == Approx(20.));
+            }
+        }
         WHEN("end_gcode exists with layer_num and layer_z") {
 			std::string gcode = ::Test::slice({ TestMesh::cube_20x20x20 }, {
 				{ "end_gcode",              "; Layer_num [layer_num]\n; Layer_z [layer_z]" },
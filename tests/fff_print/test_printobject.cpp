@@ -87,3 +87,91 @@ SCENARIO("PrintObject: object layer heights", "[PrintObject]") {
 #endif
     }
 }
+
+SCENARIO("PrintObject: slicing of an object composed of multiple volumes", "[PrintObject]") {
+    GIVEN("Two overlapping 20mm cubes as two parts of a single object") {
+        Slic3r::Model model;
+        ModelObject *object = model.add_object();
+        TriangleMesh cube1 = make_cube(20., 20., 20.);
+        TriangleMesh cube2 = make_cube(20., 20., 20.);
+        cube2.translate(10.f, 0.f, 0.f);
+        object->add_volume(cube1);
+        object->add_volume(cube2);
+        object->add_instance();
+        object->ensure_on_bed();
+
+        WHEN("The object is sliced") {
+            DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+            config.set_deserialize({ { "first_layer_height", 0.5 }, { "layer_height", 0.5 } });
+            Slic3r::Print print;
+            print.auto_assign_extruders(object);
+            print.apply(model, config);
+            print.process();
+            const std::vector<Slic3r::Layer*> &layers = print.objects().front()->layers();
+            THEN("Each layer contains a single island, the union of the cubes") {
+                REQUIRE(layers.size() == 40);
+                for (const Layer *layer : layers) {
+                    REQUIRE(layer->lslices.size() == 1);
+                    REQUIRE(layer->lslices.front().area() == Approx(30. * 20. / (SCALING_FACTOR * SCALING_FACTOR)));
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("PrintObject: changing the configuration of a layer range", "[PrintObject]") {
+    GIVEN("20mm cube with 2 perimeters in the layer range from 10mm to 12mm") {
+        DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+        config.set_deserialize({ { "first_layer_height", 0.5 }, { "layer_height", 0.5 } });
+        Slic3r::Print print;
+        Slic3r::Model model;
+        Slic3r::Test::init_print({TestMesh::cube_20x20x20}, print, model, config);
+        ModelConfig &range_config = model.objects.front()->layer_config_ranges[{ 10., 12. }];
+        range_config.set("layer_height", 0.5);
+        range_config.set("perimeters", 2);
+        print.apply(model, config);
+        print.process();
+        const PrintObject &object = *print.objects().front();
+        auto num_perimeters = [&object](size_t layer_idx) {
+            size_t n = 0;
+            for (const LayerRegion *layerm : object.layers()[layer_idx]->regions())
+                n += layerm->perimeters.items_count();
+            return n;
+        };
+        // The layers of the layer range are the only layers containing the second region.
+        auto in_range = [&object](size_t layer_idx) {
+            const Layer &layer = *object.layers()[layer_idx];
+            return layer.regions().size() > 1 && ! layer.regions()[1]->slices.empty();
+        };
+        WHEN("The number of perimeters of the layer range is changed to 4") {
+            // Number of times the perimeters and the fills of each layer were generated.
+            auto generations = [&object]() {
+                std::vector<std::pair<size_t, size_t>> out;
+                for (const Layer *layer : object.layers())
+                    out.emplace_back(layer->regions().front()->perimeters_generation, layer->regions().front()->fills_generation);
+                return out;
+            };
+            const std::vector<std::pair<size_t, size_t>> generations_before = generations();
+            range_config.set("perimeters", 4);
+            print.apply(model, config);
+            print.process();
+            THEN("The layers of the layer range have 4 perimeters, the other layers have 3 perimeters") {
+                size_t num_layers_in_range = 0;
+                for (size_t layer_idx = 0; layer_idx < object.layers().size(); ++ layer_idx)
+                    if (in_range(layer_idx)) {
+                        ++ num_layers_in_range;
+                        REQUIRE(num_perimeters(layer_idx) == 4);
+                    } else
+                        REQUIRE(num_perimeters(layer_idx) == 3);
+                REQUIRE(num_layers_in_range == 4);
+            }
+            THEN("Only the perimeters of the layer range are regenerated, the bottom layer is not refilled") {
+                const std::vector<std::pair<size_t, size_t>> generations_after = generations();
+                REQUIRE(generations_after.size() == generations_before.size());
+                for (size_t layer_idx = 0; layer_idx < generations_after.size(); ++ layer_idx)
+                    REQUIRE(generations_after[layer_idx].first == generations_before[layer_idx].first + (in_range(layer_idx) ? 1 : 0));
+                REQUIRE(generations_after.front().second == generations_before.front().second);
+            }
+        }
+    }
+}
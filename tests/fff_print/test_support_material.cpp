@@ -18,6 +18,41 @@ TEST_CASE("SupportMaterial: Three raft layers created", "[SupportMaterial]")
     REQUIRE(print.objects().front()->support_layers().size() == 3);
 }
 
+TEST_CASE("SupportMaterial: refined chaining does not lengthen the travels", "[SupportMaterial]")
+{
+	Slic3r::Print print;
+	Slic3r::Test::init_and_process_print({ TestMesh::overhang, TestMesh::bridge_with_hole, TestMesh::ipadstand }, print, {
+		{ "support_material", 1 },
+		{ "support_material_spacing", 1 }
+		});
+
+	// Length of the travels between the extrusions printed in the order of the collection.
+	auto travel_length = [](const ExtrusionEntityCollection &extrusions, const Point &start) {
+		double length = 0.;
+		Point  last   = start;
+		for (const ExtrusionEntity *ee : extrusions.entities) {
+			length += (ee->first_point() - last).cast<double>().norm();
+			last    = ee->last_point();
+		}
+		return length;
+	};
+
+	size_t num_layers = 0;
+	double length_greedy = 0., length_improved = 0.;
+	for (const PrintObject *object : print.objects())
+		for (const SupportLayer *layer : object->support_layers()) {
+			const Point start(0, 0);
+			double greedy   = travel_length(layer->support_fills.chained_path_from(start, erMixed, false), start);
+			double improved = travel_length(layer->support_fills.chained_path_from(start, erMixed, true), start);
+			REQUIRE(improved <= greedy + SCALED_EPSILON);
+			length_greedy   += greedy;
+			length_improved += improved;
+			++ num_layers;
+		}
+	REQUIRE(num_layers > 0);
+	REQUIRE(length_improved < length_greedy);
+}
+
 SCENARIO("SupportMaterial: support_layers_z and contact_distance", "[SupportMaterial]")
 {
     // Box h = 20mm, hole bottom at 5mm, hole height 10mm (top edge at 15mm).
@@ -228,6 +228,117 @@ SCENARIO( "TriangleMesh: slice behavior.") {
     }
 }
 
+SCENARIO( "TriangleMeshSlicer: cuts along a tilted up direction.") {
+    GIVEN( "A sphere and a slicer with a tilted up direction") {
+        TriangleMesh sphere = make_sphere(10., 2. * PI / 100.);
+        sphere.repair();
+        TriangleMeshSlicer slicer(&sphere);
+        slicer.set_up_direction(Vec3f(1.f, 2.f, 3.f).normalized());
+        std::vector<float> z { -9.f, -6.f, -2.5f, 0.f, 0.5f, 3.f, 7.f, 9.f };
+
+        WHEN( "Each height is cut separately") {
+            std::vector<ExPolygons> all;
+            slicer.slice(z, SlicingMode::Regular, 0.f, &all, [](){});
+            THEN( "The cuts match the cuts of all the heights at once") {
+                for (size_t i = 0; i < z.size(); ++ i) {
+                    std::vector<ExPolygons> single;
+                    slicer.slice({ z[i] }, SlicingMode::Regular, 0.f, &single, [](){});
+                    REQUIRE(single.front().size() == 1);
+                    REQUIRE(single.front().front().area() == Approx(all[i].front().area()));
+                    // Area of the circular cut of the sphere.
+                    REQUIRE(single.front().front().area() * SCALING_FACTOR * SCALING_FACTOR == Approx(PI * (100. - z[i] * z[i])).epsilon(0.02));
+                }
+            }
+        }
+        WHEN( "The direction is set again and the mesh is cut outside") {
+            slicer.set_up_direction(Vec3f(1.f, 2.f, 3.f).normalized());
+            std::vector<ExPolygons> single;
+            slicer.slice({ 10.5f }, SlicingMode::Regular, 0.f, &single, [](){});
+            THEN( "The cut is empty") {
+                REQUIRE(single.front().empty());
+            }
+        }
+    }
+}
+
+SCENARIO( "TriangleMeshSlicer: slicing through a transformation.") {
+    GIVEN( "Two merged cubes and a mirroring transformation") {
+        TriangleMesh mesh = make_cube(20., 20., 20.);
+        TriangleMesh cube2 = make_cube(5., 10., 30.);
+        cube2.translate(25.f, 0.f, 0.f);
+        mesh.merge(cube2);
+        mesh.repair();
+        Transform3d trafo = Geometry::assemble_transform(Vec3d(5., 0., 3.), Vec3d::Zero(), Vec3d(1., 2., 1.), Vec3d(-1., 1., 1.));
+        TriangleMesh mesh_transformed = mesh;
+        mesh_transformed.transform(trafo, true);
+        mesh_transformed.require_shared_vertices();
+        std::vector<float> z { 4.f, 10.f, 20.f, 25.f, 32.f };
+        WHEN( "The mesh is sliced through the transformation and the transformed copy is sliced") {
+            std::vector<ExPolygons> sliced, sliced_transformed;
+            TriangleMeshSlicer slicer;
+            slicer.init(&mesh, trafo, [](){});
+            slicer.slice(z, SlicingMode::Regular, 0.f, &sliced, [](){});
+            TriangleMeshSlicer slicer_transformed(&mesh_transformed);
+            slicer_transformed.slice(z, SlicingMode::Regular, 0.f, &sliced_transformed, [](){});
+            THEN( "The slices match") {
+                for (size_t i = 0; i < z.size(); ++ i) {
+                    REQUIRE(sliced[i].size() == sliced_transformed[i].size());
+                    double area = 0., area_transformed = 0.;
+                    for (const ExPolygon &expoly : sliced[i]) {
+                        REQUIRE(expoly.area() > 0.);
+                        area += expoly.area();
+                    }
+                    for (const ExPolygon &expoly : sliced_transformed[i])
+                        area_transformed += expoly.area();
+                    REQUIRE(area == Approx(area_transformed));
+                }
+                REQUIRE(sliced[1].size() == 2);
+                REQUIRE(sliced[3].size() == 1);
+            }
+        }
+    }
+}
+
+SCENARIO( "TriangleMeshSlicer: slicing a repaired mesh through a mirroring transformation.") {
+    // PrintObject::slice_volume() slices the volume mesh through its transformation. It used to slice a transformed copy
+    // of the mesh instead, with the facets of a repaired mesh checked again, which is what the reference slices do here.
+    Transform3d trafo = Geometry::assemble_transform(Vec3d(-3., 7., 1.), Vec3d(0., 0., 0.7), Vec3d(1.5, 1., 0.8), Vec3d(1., -1., 1.));
+    for (Test::TestMesh test_mesh : { Test::TestMesh::gt2_teeth, Test::TestMesh::ipadstand, Test::TestMesh::sloping_hole, Test::TestMesh::two_hollow_squares }) {
+        GIVEN(std::string("The repaired mesh ") + Test::mesh_names.at(test_mesh)) {
+            TriangleMesh mesh = Test::mesh(test_mesh);
+            REQUIRE(mesh.repaired);
+            mesh.require_shared_vertices();
+            TriangleMesh mesh_copy = mesh;
+            mesh_copy.transform(trafo, true);
+            stl_check_facets_exact(&mesh_copy.stl);
+            mesh_copy.require_shared_vertices();
+            BoundingBoxf3 bb = mesh_copy.bounding_box();
+            std::vector<float> z;
+            for (double h = bb.min.z() + 0.1; h < bb.max.z(); h += 0.3)
+                z.emplace_back(float(h));
+            WHEN("The mesh is sliced through the transformation and the checked transformed copy is sliced") {
+                std::vector<ExPolygons> sliced, sliced_copy;
+                TriangleMeshSlicer slicer;
+                slicer.init(&mesh, trafo, [](){});
+                slicer.slice(z, SlicingMode::Regular, 0.f, &sliced, [](){});
+                TriangleMeshSlicer slicer_copy(&mesh_copy);
+                slicer_copy.slice(z, SlicingMode::Regular, 0.f, &sliced_copy, [](){});
+                THEN("The slices match") {
+                    for (size_t i = 0; i < z.size(); ++ i) {
+                        REQUIRE(sliced[i].size() == sliced_copy[i].size());
+                        double area = 0., area_copy = 0.;
+                        for (const ExPolygon &expoly : sliced[i])
+                            area += expoly.area();
+                        for (const ExPolygon &expoly : sliced_copy[i])
+                            area_copy += expoly.area();
+                        REQUIRE(area == Approx(area_copy));
+                    }
+                }
+            }
+        }
+    }
+}
+
 SCENARIO( "make_xxx functions produce meshes.") {
     GIVEN("make_cube() function") {
         WHEN("make_cube() is called with arguments 20,20,20") {
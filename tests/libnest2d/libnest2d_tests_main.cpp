@@ -687,6 +687,42 @@ TEST_CASE("Items can be preloaded", "[Nesting]") {
     }
 }
 
+TEST_CASE("Cached nfps should give the same arrangement", "[Nesting]") {
+    auto bin = Box({0, 0}, {250000000, 210000000});
+
+    auto make_items = [] {
+        std::vector<Item> items;
+        for (int i = 0; i < 20; ++i)
+            items.emplace_back(RectangleItem{20000000, 10000000});
+        for (int i = 0; i < 5; ++i)
+            items.emplace_back(RectangleItem{30000000, 30000000});
+
+        return items;
+    };
+
+    auto cache = std::make_shared<placers::NfpCache<PolygonImpl>>();
+
+    NestConfig<> cfg;
+    std::vector<Item> expected = make_items();
+    libnest2d::nest(expected, bin, 1000000, cfg);
+
+    cfg.placer_config.nfp_cache = cache;
+
+    // The second arrangement with the same cache only does lookups
+    for (int run = 0; run < 2; ++run) {
+        std::vector<Item> items = make_items();
+        libnest2d::nest(items, bin, 1000000, cfg);
+
+        REQUIRE(cache->size() > 0);
+
+        for (size_t i = 0; i < items.size(); ++i) {
+            REQUIRE(items[i].binId() == expected[i].binId());
+            REQUIRE(items[i].translation().X == expected[i].translation().X);
+            REQUIRE(items[i].translation().Y == expected[i].translation().Y);
+        }
+    }
+}
+
 namespace {
 
 struct ItemPair {
@@ -3,6 +3,12 @@
 #include "libslic3r/Model.hpp"
 #include "libslic3r/Format/3mf.hpp"
 #include "libslic3r/Format/STL.hpp"
+#include "libslic3r/Zipper.hpp"
+#include "libslic3r/miniz_extension.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
 
 #include <boost/filesystem/operations.hpp>
 
@@ -85,3 +91,174 @@ SCENARIO("Export+Import geometry to/from 3mf file cycle", "[3mf]") {
         }
     }
 }
+
+SCENARIO("Export+Import of a mesh written in multiple pieces", "[3mf]") {
+    GIVEN("a model with a big mesh and an object with multiple instances") {
+        Model src_model;
+        // Over 100k vertices and 200k triangles, so the mesh is compressed in multiple pieces.
+        TriangleMesh sphere = make_sphere(10., 2. * PI / 480.);
+        sphere.repair();
+        src_model.add_object("sphere", "", sphere);
+        TriangleMesh cube = make_cube(10., 10., 10.);
+        cube.repair();
+        src_model.add_object("cube", "", cube);
+        src_model.add_default_instances();
+        src_model.objects[1]->add_instance()->set_offset(Vec3d(20., 0., 0.));
+
+        WHEN("model is saved+loaded to/from 3mf file") {
+            std::string test_file = std::string(TEST_DATA_DIR) + "/test_3mf/pieces.3mf";
+            bool stored = store_3mf(test_file.c_str(), &src_model, nullptr, false);
+
+            Model dst_model;
+            DynamicPrintConfig dst_config;
+            bool loaded = load_3mf(test_file.c_str(), &dst_config, &dst_model, false);
+
+            // The coordinates as written, the loader moves the meshes to the centers of their bounding boxes.
+            std::vector<float> written;
+            mz_zip_archive archive;
+            mz_zip_zero_struct(&archive);
+            if (open_zip_reader(&archive, test_file)) {
+                size_t size = 0;
+                if (char *data = static_cast<char*>(mz_zip_reader_extract_file_to_heap(&archive, "3D/3dmodel.model", &size, 0))) {
+                    std::string xml(data, size);
+                    mz_free(data);
+                    for (size_t pos = xml.find("<vertex "); pos != std::string::npos; pos = xml.find("<vertex ", pos + 1))
+                        for (const char *attr : { "x=\"", "y=\"", "z=\"" })
+                            written.emplace_back(std::strtof(xml.c_str() + xml.find(attr, pos) + 3, nullptr));
+                }
+                close_zip_reader(&archive);
+            }
+            boost::filesystem::remove(test_file);
+
+            THEN("the geometry and the instances match") {
+                REQUIRE(stored);
+                REQUIRE(loaded);
+                REQUIRE(dst_model.objects.size() == 2);
+                REQUIRE(dst_model.objects[1]->instances.size() == 2);
+
+                TriangleMesh src_mesh = src_model.mesh();
+                src_mesh.repair();
+                TriangleMesh dst_mesh = dst_model.mesh();
+                dst_mesh.repair();
+
+                const indexed_triangle_set &src = src_mesh.its;
+                const indexed_triangle_set &dst = dst_mesh.its;
+                REQUIRE(dst.vertices.size() == src.vertices.size());
+                REQUIRE(dst.indices.size() == src.indices.size());
+            }
+
+            THEN("the coordinates are written exactly") {
+                std::vector<float> expected;
+                for (const ModelObject *object : src_model.objects)
+                    for (const ModelVolume *volume : object->volumes)
+                        for (const Vec3f &v : volume->mesh().its.vertices) {
+                            Vec3f w = (volume->get_matrix() * v.cast<double>()).cast<float>();
+                            expected.insert(expected.end(), { w.x(), w.y(), w.z() });
+                        }
+
+                REQUIRE(written.size() == expected.size());
+                REQUIRE(written == expected);
+            }
+        }
+    }
+}
+
+SCENARIO("Import of the numbers of a hand written 3mf file", "[3mf]") {
+    GIVEN("a mesh with plain, unusual and malformed numbers") {
+        // Two tetrahedra, the first with well formed numbers in uncommon notations, the second with malformed ones.
+        // A missing attribute is marked by nullptr.
+        struct Vertex { const char *coords[3]; };
+        const std::vector<Vertex> vertices = {
+            { "0", "0", "0" },
+            { "+10.5", "1e-3", "-0" },
+            { "2.5E+1", " 20.25", "0.1000000000000000055511151231257827" },
+            { "5.", "-.75", "12345678901234567890e-18" },
+            { "30abc", "0x10", "1e" },
+            { "40", "", nullptr },
+            { "35.000000000000000000001", "25", "1.5e-30" },
+            { "32", "8 ", "-1.25e1" }
+        };
+        struct Triangle { const char *indices[3]; };
+        const std::vector<Triangle> triangles = {
+            { "0", "2", "1" },
+            { "+0", " 1", "3 " },
+            { "0001", "2.0", "3" },
+            { "2", "0", "00000000000000000003" },
+            { "4", "6", "5" },
+            { "4", "5", "7abc" },
+            { "5", "6", "7" },
+            { "6", "4", "7" }
+        };
+
+        std::string xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            "<model unit=\"millimeter\" xml:lang=\"en-US\" xmlns=\"http://schemas.microsoft.com/3dmanufacturing/core/2015/02\">\n"
+            " <resources>\n  <object id=\"1\" type=\"model\">\n   <mesh>\n    <vertices>\n";
+        for (const Vertex &v : vertices) {
+            xml += "     <vertex";
+            for (int i = 0; i < 3; ++i)
+                if (v.coords[i] != nullptr)
+                    xml += std::string(" ") + char('x' + i) + "=\"" + v.coords[i] + "\"";
+            xml += "/>\n";
+        }
+        xml += "    </vertices>\n    <triangles>\n";
+        for (const Triangle &t : triangles)
+            xml += std::string("     <triangle v1=\"") + t.indices[0] + "\" v2=\"" + t.indices[1] + "\" v3=\"" + t.indices[2] + "\"/>\n";
+        xml += "    </triangles>\n   </mesh>\n  </object>\n </resources>\n <build>\n  <item objectid=\"1\"/>\n </build>\n</model>\n";
+
+        std::string test_file = std::string(TEST_DATA_DIR) + "/test_3mf/numbers.3mf";
+        {
+            Zipper zipper(test_file);
+            zipper.add_entry("3D/3dmodel.model", xml.data(), xml.size());
+            zipper.finalize();
+        }
+
+        WHEN("the 3mf file is loaded") {
+            Model model;
+            DynamicPrintConfig config;
+            bool loaded = load_3mf(test_file.c_str(), &config, &model, false);
+            boost::filesystem::remove(test_file);
+
+            THEN("the mesh matches the one parsed by atof() and atoi()") {
+                REQUIRE(loaded);
+                REQUIRE(model.objects.size() == 1);
+                REQUIRE(model.objects.front()->volumes.size() == 1);
+
+                // The triangles are compared as sorted triples of vertices, as the repair may reorient them.
+                using Facet = std::array<std::array<float, 3>, 3>;
+                auto sorted = [](Facet f) { std::sort(f.begin(), f.end()); return f; };
+
+                std::vector<Facet> expected;
+                for (const Triangle &t : triangles) {
+                    Facet f;
+                    for (int i = 0; i < 3; ++i) {
+                        const Vertex &v = vertices[::atoi(t.indices[i])];
+                        for (int j = 0; j < 3; ++j)
+                            f[i][j] = (v.coords[j] != nullptr) ? (float)::atof(v.coords[j]) : 0.f;
+                    }
+                    expected.emplace_back(sorted(f));
+                }
+
+                // The mesh of the volume is centered around its origin, the offset is moved to the volume transformation.
+                std::vector<Facet> imported;
+                const ModelVolume &volume = *model.objects.front()->volumes.front();
+                for (const stl_facet &facet : volume.mesh().stl.facet_start) {
+                    Facet f;
+                    for (int i = 0; i < 3; ++i) {
+                        Vec3d p = volume.get_matrix() * facet.vertex[i].cast<double>();
+                        for (int j = 0; j < 3; ++j)
+                            f[i][j] = float(p(j));
+                    }
+                    imported.emplace_back(sorted(f));
+                }
+
+                std::sort(expected.begin(), expected.end());
+                std::sort(imported.begin(), imported.end());
+                REQUIRE(imported.size() == expected.size());
+                for (size_t i = 0; i < expected.size(); ++i)
+                    for (int j = 0; j < 3; ++j)
+                        for (int k = 0; k < 3; ++k)
+                            REQUIRE(imported[i][j][k] == Approx(expected[i][j][k]).margin(1e-5));
+            }
+        }
+    }
+}
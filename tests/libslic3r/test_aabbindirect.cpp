@@ -1,6 +1,8 @@
 #include <catch2/catch.hpp>
 #include <test_utils.hpp>
 
+#include <random>
+
 #include <libslic3r/TriangleMesh.hpp>
 #include <libslic3r/AABBTreeIndirect.hpp>
 
@@ -59,3 +61,116 @@ TEST_CASE("Building a tree over a box, ray caster and closest query", "[AABBIndi
     REQUIRE(closest_point.y() == Approx(0.5));
     REQUIRE(closest_point.z() == Approx(1.));
 }
+
+TEST_CASE("Wide tree ray casts match the binary tree", "[AABBIndirect]")
+{
+    TriangleMesh tmesh = make_sphere(1., PI / 50.);
+    tmesh.repair();
+
+    auto tree = AABBTreeIndirect::build_aabb_tree_over_indexed_triangle_set(tmesh.its.vertices, tmesh.its.indices);
+    AABBTreeIndirect::WideTree wide_tree(tree);
+    REQUIRE(! wide_tree.empty());
+
+    // Rays of a cone shooting from below the sphere and from its inside, all of them hitting it.
+    std::vector<Vec3d> origins, dirs;
+    for (const Vec3d &origin : { Vec3d(0.1, 0.2, -3.), Vec3d(0., 0.1, 0.) })
+        for (size_t i = 0; i < 100; ++ i) {
+            double a = 2. * PI * double(i) / 100.;
+            origins.emplace_back(origin);
+            dirs.emplace_back(Vec3d(0.2 * std::cos(a), 0.2 * std::sin(a), 1.).normalized());
+        }
+
+    std::vector<igl::Hit> packet_hits(origins.size());
+    size_t num_hits = AABBTreeIndirect::intersect_rays_first_hit(
+        tmesh.its.vertices, tmesh.its.indices, wide_tree,
+        origins.data(), dirs.data(), origins.size(), packet_hits.data());
+    REQUIRE(num_hits == origins.size());
+
+    for (size_t i = 0; i < origins.size(); ++ i) {
+        igl::Hit hit, wide_hit;
+        bool intersected = AABBTreeIndirect::intersect_ray_first_hit(
+            tmesh.its.vertices, tmesh.its.indices, tree, origins[i], dirs[i], hit);
+        bool wide_intersected = AABBTreeIndirect::intersect_ray_first_hit(
+            tmesh.its.vertices, tmesh.its.indices, wide_tree, origins[i], dirs[i], wide_hit);
+        REQUIRE(intersected);
+        REQUIRE(wide_intersected);
+        REQUIRE(wide_hit.t == Approx(hit.t));
+        REQUIRE(packet_hits[i].t == Approx(hit.t));
+
+        std::vector<igl::Hit> hits, wide_hits;
+        AABBTreeIndirect::intersect_ray_all_hits(
+            tmesh.its.vertices, tmesh.its.indices, tree, origins[i], dirs[i], hits);
+        AABBTreeIndirect::intersect_ray_all_hits(
+            tmesh.its.vertices, tmesh.its.indices, wide_tree, origins[i], dirs[i], wide_hits);
+        REQUIRE(wide_hits.size() == hits.size());
+        for (size_t j = 0; j < hits.size(); ++ j)
+            REQUIRE(wide_hits[j].t == Approx(hits[j].t));
+    }
+
+    igl::Hit hit;
+    REQUIRE(! AABBTreeIndirect::intersect_ray_first_hit(
+        tmesh.its.vertices, tmesh.its.indices, wide_tree, Vec3d(0., 0., -3.), Vec3d(0., 0., -1.), hit));
+}
+
+TEST_CASE("Wide tree ray casts over a big mesh match the scalar query", "[AABBIndirect]")
+{
+    // Over 16384 triangles, so the halves of the big subtrees are built in parallel.
+    TriangleMesh tmesh = make_sphere(1., PI / 120.);
+    tmesh.repair();
+    REQUIRE(tmesh.its.indices.size() > 16384 * 2);
+
+    auto tree = AABBTreeIndirect::build_aabb_tree_over_indexed_triangle_set(tmesh.its.vertices, tmesh.its.indices);
+    AABBTreeIndirect::WideTree wide_tree(tree);
+
+    // Random rays from the inside of the sphere and rays from the outside aimed around it, some of them missing it.
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<double> coord(-1., 1.);
+    std::vector<Vec3d> origins, dirs;
+    for (size_t i = 0; i < 200; ++ i) {
+        Vec3d origin(coord(rng), coord(rng), coord(rng));
+        Vec3d target(coord(rng), coord(rng), coord(rng));
+        if (i % 2) {
+            origins.emplace_back(0.5 * origin);
+            dirs.emplace_back(target.normalized());
+        } else {
+            origins.emplace_back(3. * origin.normalized());
+            dirs.emplace_back((1.3 * target - origins.back()).normalized());
+        }
+    }
+
+    std::vector<igl::Hit> packet_hits(origins.size());
+    AABBTreeIndirect::intersect_rays_first_hit(
+        tmesh.its.vertices, tmesh.its.indices, wide_tree,
+        origins.data(), dirs.data(), origins.size(), packet_hits.data());
+
+    size_t num_missed = 0;
+    for (size_t i = 0; i < origins.size(); ++ i) {
+        igl::Hit hit, wide_hit;
+        bool intersected = AABBTreeIndirect::intersect_ray_first_hit(
+            tmesh.its.vertices, tmesh.its.indices, tree, origins[i], dirs[i], hit);
+        bool wide_intersected = AABBTreeIndirect::intersect_ray_first_hit(
+            tmesh.its.vertices, tmesh.its.indices, wide_tree, origins[i], dirs[i], wide_hit);
+        REQUIRE(wide_intersected == intersected);
+        if (! intersected) {
+            ++ num_missed;
+            continue;
+        }
+        REQUIRE(wide_hit.id == hit.id);
+        REQUIRE(wide_hit.t == Approx(hit.t));
+        REQUIRE(packet_hits[i].id == hit.id);
+        REQUIRE(packet_hits[i].t == Approx(hit.t));
+
+        std::vector<igl::Hit> hits, wide_hits;
+        AABBTreeIndirect::intersect_ray_all_hits(
+            tmesh.its.vertices, tmesh.its.indices, tree, origins[i], dirs[i], hits);
+        AABBTreeIndirect::intersect_ray_all_hits(
+            tmesh.its.vertices, tmesh.its.indices, wide_tree, origins[i], dirs[i], wide_hits);
+        REQUIRE(wide_hits.size() == hits.size());
+        for (size_t j = 0; j < hits.size(); ++ j) {
+            REQUIRE(wide_hits[j].id == hits[j].id);
+            REQUIRE(wide_hits[j].t == Approx(hits[j].t));
+        }
+    }
+    REQUIRE(num_missed > 0);
+    REQUIRE(num_missed < origins.size() / 2);
+}
@@ -0,0 +1,77 @@
+#include <catch2/catch.hpp>
+#include <test_utils.hpp>
+
+#include <libslic3r/Arrange.hpp>
+#include <libslic3r/BoundingBox.hpp>
+
+using namespace Slic3r;
+
+// Many identical squares, which are tiled on a lattice instead of being packed one by one.
+static arrangement::ArrangePolygons make_squares(size_t count, double size)
+{
+    arrangement::ArrangePolygons squares(count);
+    for (arrangement::ArrangePolygon &ap : squares) {
+        coord_t s = scaled(size);
+        ap.poly.contour = Polygon({{0, 0}, {s, 0}, {s, s}, {0, s}});
+    }
+    return squares;
+}
+
+static BoundingBox arranged_bbox(const arrangement::ArrangePolygon &ap)
+{
+    Polygon p = ap.poly.contour;
+    p.rotate(ap.rotation);
+    p.translate(ap.translation);
+    return p.bounding_box();
+}
+
+TEST_CASE("Identical items should be arranged on a lattice", "[Arrange]")
+{
+    const coord_t min_distance = scaled(6.);
+    // 16 squares of 20 mm fit a 100 mm bed with 6 mm in between, 40 squares need three beds.
+    arrangement::ArrangePolygons squares = make_squares(40, 20.);
+    BoundingBox bed({0, 0}, {scaled(100.), scaled(100.)});
+
+    std::vector<unsigned> progress;
+    arrangement::ArrangeParams params(min_distance);
+    params.progressind = [&progress](unsigned remaining) { progress.emplace_back(remaining); };
+
+    arrangement::arrange(squares, bed, params);
+
+    std::vector<size_t> bed_counts;
+    for (const arrangement::ArrangePolygon &ap : squares) {
+        REQUIRE(ap.is_arranged());
+        bed_counts.resize(std::max(bed_counts.size(), size_t(ap.bed_idx + 1)));
+        ++ bed_counts[ap.bed_idx];
+
+        BoundingBox bb = arranged_bbox(ap);
+        REQUIRE(bed.contains(bb.min));
+        REQUIRE(bed.contains(bb.max));
+    }
+    REQUIRE(bed_counts == std::vector<size_t>{16, 16, 8});
+
+    for (size_t i = 0; i < squares.size(); ++i)
+        for (size_t j = i + 1; j < squares.size(); ++j)
+            if (squares[i].bed_idx == squares[j].bed_idx) {
+                BoundingBox a = arranged_bbox(squares[i]), b = arranged_bbox(squares[j]);
+                coord_t gap = std::max(std::max(a.min.x() - b.max.x(), b.min.x() - a.max.x()),
+                                       std::max(a.min.y() - b.max.y(), b.min.y() - a.max.y()));
+                REQUIRE(gap >= min_distance);
+            }
+
+    REQUIRE(progress.size() == squares.size());
+    REQUIRE(progress.back() == 0);
+
+    SECTION("A stopped arrangement leaves the remaining items untouched") {
+        arrangement::ArrangePolygons stopped = make_squares(40, 20.);
+        size_t placed = 0;
+        params.progressind = [&placed](unsigned) { ++ placed; };
+        params.stopcondition = [&placed] { return placed >= 10; };
+
+        arrangement::arrange(stopped, bed, params);
+
+        REQUIRE(placed == 10);
+        REQUIRE(std::count_if(stopped.begin(), stopped.end(),
+                              [](const arrangement::ArrangePolygon &ap) { return ap.is_arranged(); }) == 10);
+    }
+}
@@ -1,5 +1,7 @@
 #include <catch2/catch.hpp>
 
+#include <random>
+
 #include "libslic3r/Point.hpp"
 #include "libslic3r/BoundingBox.hpp"
 #include "libslic3r/Polygon.hpp"
@@ -8,6 +10,9 @@
 #include "libslic3r/Geometry.hpp"
 #include "libslic3r/ClipperUtils.hpp"
 #include "libslic3r/ShortestPath.hpp"
+#include "libslic3r/EdgeGrid.hpp"
+#include "libslic3r/MotionPlanner.hpp"
+#include "libslic3r/GCode/IslandLocator.hpp"
 
 using namespace Slic3r;
 
@@ -321,6 +326,32 @@ SCENARIO("Path chaining", "[Geometry]") {
 			}
 		}
 	}
+	GIVEN("Scattered segments, some of them not reversible") {
+		Points            end_points;
+		std::vector<bool> could_reverse;
+		for (int i = 0; i < 50; ++ i)
+			for (int j = 0; j < 10; ++ j) {
+				// Deterministic pseudo random layout.
+				int x = (i * 7919 + j * 104729) % 200;
+				int y = (i * 6841 + j * 7177) % 200;
+				end_points.emplace_back(Point::new_scale(x, y));
+				end_points.emplace_back(Point::new_scale(x + (i % 3), y + (j % 4)));
+				could_reverse.emplace_back((i + j) % 5 != 0);
+			}
+		Point start = Point::new_scale(0, 0);
+		std::vector<std::pair<size_t, bool>> chain = chain_segments(end_points, could_reverse, &start);
+		double length_greedy = chain_travel_length(chain, end_points, &start);
+		improve_chain(chain, end_points, could_reverse, &start);
+		THEN("The local search shortens the travels and keeps the chain valid") {
+			REQUIRE(chain_travel_length(chain, end_points, &start) < length_greedy);
+			std::vector<int> visited(could_reverse.size(), 0);
+			for (const std::pair<size_t, bool> &segment : chain) {
+				++ visited[segment.first];
+				REQUIRE((could_reverse[segment.first] || ! segment.second));
+			}
+			REQUIRE(std::count(visited.begin(), visited.end(), 1) == int(visited.size()));
+		}
+	}
 }
 
 SCENARIO("Line distances", "[Geometry]"){
@@ -452,3 +483,117 @@ SCENARIO("Ported from xs/t/14_geometry.t", "[Geometry]"){
     	REQUIRE(! Slic3r::Geometry::directions_parallel(M_PI /2, PI, M_PI /180));
     }
 }
+
+SCENARIO("EdgeGrid signed distance", "[Geometry]") {
+    GIVEN("irregular polygon with a square hole") {
+        ExPolygon shape;
+        shape.contour = Polygon::new_scale({ { 0, 0 }, { 10, 0 }, { 12, 6 }, { 10, 10 }, { 4, 8.5 }, { 0, 10 } });
+        shape.holes.emplace_back(Polygon::new_scale({ { 3, 3 }, { 3, 7 }, { 7, 7 }, { 7, 3 } }));
+        BoundingBox bbox = get_extents(shape);
+        bbox.offset(scale_(5.));
+        EdgeGrid::Grid grid;
+        grid.set_bbox(bbox);
+        grid.create(shape, coord_t(scale_(1.)));
+        grid.calculate_sdf();
+        std::mt19937 rng(0);
+        std::uniform_real_distribution<double> coord(-2., 14.);
+        Points pts;
+        for (size_t i = 0; i < 5000; ++ i)
+            pts.emplace_back(scale_(coord(rng)), scale_(coord(rng)));
+        coord_t search_radius = coord_t(scale_(1.5));
+        std::vector<coordf_t> dists = grid.signed_distances(pts, search_radius);
+        THEN("distances within the search radius match the distances to all the edges") {
+            REQUIRE(dists.size() == pts.size());
+            Lines lines = to_lines(shape);
+            size_t num_tested = 0;
+            for (size_t i = 0; i < pts.size(); ++ i) {
+                double dist = std::numeric_limits<double>::max();
+                for (const Line &line : lines)
+                    dist = std::min(dist, line.distance_to(pts[i]));
+                if (dist > search_radius)
+                    continue;
+                if (shape.contains(pts[i]))
+                    dist = - dist;
+                REQUIRE(! std::isnan(dists[i]));
+                REQUIRE(dists[i] == Approx(dist).margin(1.));
+                ++ num_tested;
+            }
+            REQUIRE(num_tested > pts.size() / 4);
+        }
+        THEN("distance is negative inside, positive outside") {
+            auto at = [&grid, search_radius](double x, double y) {
+                coordf_t dist = 0.;
+                grid.signed_distance(Point(scale_(x), scale_(y)), search_radius, dist);
+                return unscale<double>(dist);
+            };
+            REQUIRE(at(1., 5.) == Approx(-1.));
+            REQUIRE(at(-1., 5.) == Approx(1.));
+            REQUIRE(at(5., 6.) == Approx(1.));
+            REQUIRE(at(5., 2.) == Approx(-1.));
+        }
+    }
+}
+
+SCENARIO("MotionPlanner avoids crossing the island boundaries", "[Geometry]") {
+    GIVEN("square island with a square hole") {
+        ExPolygon island;
+        island.contour = Polygon::new_scale({ { 0, 0 }, { 100, 0 }, { 100, 100 }, { 0, 100 } });
+        island.holes.emplace_back(Polygon::new_scale({ { 30, 30 }, { 30, 70 }, { 70, 70 }, { 70, 30 } }));
+        MotionPlanner planner({ island });
+        WHEN("travelling across the hole") {
+            Point from = Point::new_scale(50, 15);
+            Point to   = Point::new_scale(50, 85);
+            Polyline path = planner.shortest_path(from, to);
+            THEN("the path goes around the hole") {
+                REQUIRE(path.first_point() == from);
+                REQUIRE(path.last_point() == to);
+                REQUIRE(path.length() > scale_(70.));
+                REQUIRE(intersection_pl(Polylines{ path }, Polygons{ Polygon::new_scale({ { 31, 31 }, { 69, 31 }, { 69, 69 }, { 31, 69 } }) }).empty());
+            }
+        }
+        WHEN("travelling along a straight line inside the island") {
+            Point from = Point::new_scale(10, 10);
+            Point to   = Point::new_scale(90, 10);
+            THEN("the path is a straight line") {
+                REQUIRE(planner.shortest_path(from, to).points.size() == 2);
+            }
+        }
+    }
+}
+
+SCENARIO("IslandLocator finds the innermost island", "[Geometry]") {
+    GIVEN("a frame with an island inside its hole and a grid of small islands") {
+        ExPolygons islands;
+        islands.emplace_back();
+        islands.back().contour = Polygon::new_scale({ { 0, 0 }, { 100, 0 }, { 100, 100 }, { 0, 100 } });
+        islands.back().holes.emplace_back(Polygon::new_scale({ { 10, 10 }, { 10, 90 }, { 90, 90 }, { 90, 10 } }));
+        islands.emplace_back();
+        islands.back().contour = Polygon::new_scale({ { 40, 40 }, { 60, 40 }, { 60, 60 }, { 40, 60 } });
+        for (int i = 0; i < 20; ++ i)
+            for (int j = 0; j < 20; ++ j) {
+                islands.emplace_back();
+                islands.back().contour = Polygon::new_scale({ { 110 + 5 * i, 5 * j }, { 113 + 5 * i, 5 * j }, { 113 + 5 * i, 3 + 5 * j }, { 110 + 5 * i, 3 + 5 * j } });
+            }
+        std::vector<BoundingBox> bboxes;
+        for (const ExPolygon &island : islands)
+            bboxes.emplace_back(get_extents(island));
+        IslandLocator locator(islands, bboxes);
+        THEN("the island inside the hole is found before the frame") {
+            REQUIRE(locator.locate(Point::new_scale(50, 50)) == 1);
+            REQUIRE(locator.locate(Point::new_scale(5, 50)) == 0);
+        }
+        THEN("points inside a hole are assigned to its island, as only the contours are tested") {
+            REQUIRE(locator.locate(Point::new_scale(30, 50)) == 0);
+        }
+        THEN("points outside of all islands are not assigned") {
+            REQUIRE(locator.locate(Point::new_scale(105, 50)) == islands.size());
+            REQUIRE(locator.locate(Point::new_scale(114, 1)) == islands.size());
+            REQUIRE(locator.locate(Point::new_scale(-10, -10)) == islands.size());
+        }
+        THEN("points inside the small islands are assigned to them") {
+            for (int i = 0; i < 20; ++ i)
+                for (int j = 0; j < 20; ++ j)
+                    REQUIRE(locator.locate(Point::new_scale(111 + 5 * i, 1 + 5 * j)) == size_t(2 + 20 * i + j));
+        }
+    }
+}
@@ -1,3 +1,4 @@
+#include <atomic>
 #include <unordered_set>
 #include <unordered_map>
 #include <random>
@@ -6,6 +7,13 @@
 
 #include <libslic3r/SLA/SupportTreeMesher.hpp>
 #include <libslic3r/SLA/Concurrency.hpp>
+#include <libslic3r/SLA/ScanlineRaster.hpp>
+#include <libslic3r/SLA/Rotfinder.hpp>
+#include <libslic3r/ClipperUtils.hpp>
+#include <libslic3r/Format/SL1.hpp>
+#include <libslic3r/miniz_extension.hpp>
+
+#include <boost/filesystem/operations.hpp>
 
 namespace {
 
@@ -222,6 +230,169 @@ TEST_CASE("RasterizedPolygonAreaShouldMatch", "[SLARasterOutput]") {
     REQUIRE(raster_pxsum(raster0) == 0);
 }
 
+TEST_CASE("Scanline raster should match the AGG raster", "[SLARasterOutput]") {
+    double disp_w = 120., disp_h = 68.;
+    sla::RasterBase::Resolution res{2560, 1440};
+    sla::RasterBase::PixelDim pixdim{disp_w / res.width_px, disp_h / res.height_px};
+
+    auto bb = BoundingBox({0, 0}, {scaled(disp_w), scaled(disp_h)});
+
+    ExPolygon poly = square_with_hole(10.);
+    poly.rotate(PI / 7.);
+    poly.translate(scaled(5.), scaled(-3.));
+
+    // Returns the maximum difference of the pixels and the number of the
+    // differing pixels.
+    auto compare = [&res](const sla::RasterGrayscaleAA &agg,
+                          const sla::RasterGrayscaleScanline &scanline) {
+        int    maxdiff = 0;
+        size_t count   = 0;
+        for (size_t row = 0; row < res.height_px; ++row)
+            for (size_t col = 0; col < res.width_px; ++col) {
+                int diff = std::abs(int(agg.read_pixel(col, row)) -
+                                    int(scanline.read_pixel(col, row)));
+                maxdiff = std::max(maxdiff, diff);
+                count += (diff > 0);
+            }
+        return std::make_pair(maxdiff, count);
+    };
+
+    // All the transformations and gamma corrections the SL1 archive rasters
+    // are created with when the fast rasterization is enabled.
+    for (auto o : {sla::RasterBase::roLandscape, sla::RasterBase::roPortrait})
+        for (auto mirroring : {sla::RasterBase::NoMirror, sla::RasterBase::MirrorX,
+                               sla::RasterBase::MirrorY, sla::RasterBase::MirrorXY}) {
+            sla::RasterBase::Trafo trafo{o, mirroring};
+            trafo.center_x = bb.center().x();
+            trafo.center_y = bb.center().y();
+
+            // Only the anti-aliased edge pixels may slightly differ, a bit
+            // more after the gamma correction
+            for (double gamma : {1., .6}) {
+                sla::RasterGrayscaleAAGammaPower agg(res, pixdim, trafo, gamma);
+                sla::RasterGrayscaleScanline scanline(res, pixdim, trafo, gamma);
+                agg.draw(poly);
+                scanline.draw(poly);
+                REQUIRE(compare(agg, scanline).first <= (gamma == 1. ? 4 : 16));
+            }
+
+            // With thresholding, only the pixels covered by about a half may
+            // differ
+            sla::RasterGrayscaleAA agg(res, pixdim, trafo, agg::gamma_threshold(.5));
+            sla::RasterGrayscaleScanline scanline(res, pixdim, trafo, 0.);
+            agg.draw(poly);
+            scanline.draw(poly);
+            REQUIRE(compare(agg, scanline).second <= 16);
+        }
+}
+
+TEST_CASE("Scanline raster should unite overlapping polygons", "[SLARasterOutput]") {
+    double disp_w = 120., disp_h = 68.;
+    sla::RasterBase::Resolution res{2560, 1440};
+    sla::RasterBase::PixelDim pixdim{disp_w / res.width_px, disp_h / res.height_px};
+
+    sla::RasterGrayscaleScanline raster(res, pixdim, {}, 1.);
+    auto bb = BoundingBox({0, 0}, {scaled(disp_w), scaled(disp_h)});
+
+    ExPolygon poly = square_with_hole(10.), other = poly;
+    poly.translate(bb.center().x(), bb.center().y());
+    other.translate(bb.center().x() + scaled(5.), bb.center().y());
+    raster.draw(poly);
+    raster.draw(other);
+
+    double a = union_ex(ExPolygons{poly, other}).front().area() /
+               (scaled<double>(1.) * scaled(1.));
+
+    double ra = 0.;
+    for (size_t row = 0; row < res.height_px; ++row)
+        for (size_t col = 0; col < res.width_px; ++col)
+            ra += pixel_area(raster.read_pixel(col, row), pixdim);
+
+    REQUIRE(std::abs(a - ra) <= 2 * predict_error(poly, pixdim));
+
+    raster.clear();
+    REQUIRE(raster.read_pixel(res.width_px / 2, res.height_px / 2) == 0);
+}
+
+TEST_CASE("RLE encoded layers should decode losslessly", "[SLARasterOutput]") {
+    double disp_w = 120., disp_h = 68.;
+    sla::RasterBase::Resolution res{2560, 1440};
+    sla::RasterBase::PixelDim pixdim{disp_w / res.width_px, disp_h / res.height_px};
+
+    sla::RasterGrayscaleScanline raster(res, pixdim, {}, 1.);
+    auto bb = BoundingBox({0, 0}, {scaled(disp_w), scaled(disp_h)});
+
+    ExPolygon poly = square_with_hole(10.);
+    poly.translate(bb.center().x(), bb.center().y());
+
+    sla::DeltaRLERasterEncoder delta;
+    std::vector<uint8_t> out_rle, out_delta;
+    size_t w = 0, h = 0, dw = 0, dh = 0;
+
+    for (int layer = 0; layer < 3; ++layer) {
+        raster.clear();
+        poly.translate(scaled(0.1), 0);
+        raster.draw(poly);
+
+        sla::EncodedRaster rle = raster.encode(sla::RLERasterEncoder{});
+        sla::EncodedRaster drle = raster.encode(delta);
+        REQUIRE(sla::is_delta_rle(drle.data(), drle.size()) == (layer > 0));
+        REQUIRE(sla::decode_rle(rle.data(), rle.size(), res, out_rle, w, h));
+        REQUIRE(sla::decode_rle(drle.data(), drle.size(), res, out_delta, dw, dh));
+
+        REQUIRE(w == res.width_px);
+        REQUIRE(h == res.height_px);
+        REQUIRE(dw == w);
+        REQUIRE(dh == h);
+        REQUIRE(out_rle == out_delta);
+
+        std::vector<uint8_t> expected(w * h);
+        for (size_t row = 0; row < h; ++row)
+            for (size_t col = 0; col < w; ++col)
+                expected[row * w + col] = raster.read_pixel(col, row);
+
+        REQUIRE(out_rle == expected);
+    }
+
+    // A corrupt header is rejected before the image is allocated.
+    sla::EncodedRaster rle = raster.encode(sla::RLERasterEncoder{});
+    auto p = static_cast<const uint8_t *>(rle.data());
+    std::vector<uint8_t> corrupt(p, p + rle.size());
+    std::fill(corrupt.begin() + 4, corrupt.begin() + 12, uint8_t(0xff));
+    REQUIRE_FALSE(sla::decode_rle(corrupt.data(), corrupt.size(), res, out_rle, w, h));
+    REQUIRE_FALSE(sla::decode_rle(rle.data(), rle.size(), {res.height_px, res.width_px}, out_rle, w, h));
+}
+
+TEST_CASE("Histogram rotation search should score close to the exact search", "[SLARotfinder]") {
+    // A model needing many supports, its faces point in many directions.
+    TriangleMesh mesh = load_model("extruder_idler.obj");
+    mesh.require_shared_vertices();
+
+    auto to_transform = [](double rotx, double roty) {
+        Transform3d tr = Transform3d::Identity();
+        tr.rotate(Eigen::AngleAxisd(roty, Vec3d::UnitY()));
+        tr.rotate(Eigen::AngleAxisd(rotx, Vec3d::UnitX()));
+        return tr;
+    };
+
+    // The reference scores every rotation of the same grid exactly.
+    static const constexpr size_t GRIDSIZE = 31;
+    double exact_best = std::numeric_limits<double>::max();
+    for (size_t i = 0; i < GRIDSIZE; ++i)
+        for (size_t j = 0; j < GRIDSIZE; ++j) {
+            double rotx = -PI + 2 * PI * i / (GRIDSIZE - 1);
+            double roty = -PI + 2 * PI * j / (GRIDSIZE - 1);
+            exact_best = std::min(exact_best, sla::get_model_supportedness(mesh, to_transform(rotx, roty)));
+        }
+
+    Vec2d rot = sla::find_best_rotation_elevated(mesh, GRIDSIZE * GRIDSIZE);
+    double score = sla::get_model_supportedness(mesh, to_transform(rot.x(), rot.y()));
+
+    // The histogram only preselects the candidates scored exactly, the
+    // result may miss the exact best grid point by at most 5 %.
+    REQUIRE(score <= exact_best + 0.05 * std::abs(exact_best));
+}
+
 TEST_CASE("Triangle mesh conversions should be correct", "[SLAConversions]")
 {
     sla::Contour3D cntr;
@@ -251,3 +422,158 @@ TEST_CASE("Test concurrency")
 
     REQUIRE(s == Approx(ref));
 }
+
+TEST_CASE("Ordered concurrent loop keeps the order of results")
+{
+    const size_t N = 1000;
+    std::vector<size_t> results;
+    // Catch is not thread safe, the results are checked after the loop.
+    std::vector<size_t> squares;
+
+    sla::ccr_par::for_each_ordered(
+        size_t(0), N, [](size_t i) { return i * i; },
+        [&results, &squares](size_t &&r, size_t i) {
+            squares.emplace_back(r);
+            results.emplace_back(i);
+        }, 4);
+
+    REQUIRE(results.size() == N);
+    REQUIRE(std::is_sorted(results.begin(), results.end()));
+    for (size_t i = 0; i < results.size(); ++i)
+        REQUIRE(squares[i] == results[i] * results[i]);
+
+    // Stopping keeps the results of the indices already started. The stop
+    // predicate runs on another thread than the output, it only reads the
+    // counter of the results.
+    results.clear();
+    std::atomic<size_t> num_results{0};
+    sla::ccr_par::for_each_ordered(
+        size_t(0), N, [](size_t i) { return i; },
+        [&results, &num_results](size_t &&r, size_t) {
+            results.emplace_back(r);
+            ++num_results;
+        }, 4,
+        [&num_results] { return num_results >= 10; });
+
+    REQUIRE(results.size() >= 10);
+    REQUIRE(results.size() < N);
+    for (size_t i = 0; i < results.size(); ++i)
+        REQUIRE(results[i] == i);
+}
+
+namespace {
+
+// Names and uncompressed contents of the entries of a zip archive.
+std::vector<std::pair<std::string, std::string>> read_zip_entries(const std::string &path)
+{
+    std::vector<std::pair<std::string, std::string>> entries;
+
+    mz_zip_archive zip;
+    mz_zip_zero_struct(&zip);
+    REQUIRE(open_zip_reader(&zip, path));
+    for (mz_uint i = 0; i < mz_zip_reader_get_num_files(&zip); ++i) {
+        mz_zip_archive_file_stat stat;
+        REQUIRE(mz_zip_reader_file_stat(&zip, i, &stat));
+        std::string data(size_t(stat.m_uncomp_size), '\0');
+        REQUIRE(mz_zip_reader_extract_to_mem(&zip, i, data.data(), data.size(), 0));
+        entries.emplace_back(stat.m_filename, std::move(data));
+    }
+    close_zip_reader(&zip);
+
+    return entries;
+}
+
+} // namespace
+
+TEST_CASE("Streamed SL1 archive should equal the cached one", "[SLAArchive]") {
+    DynamicPrintConfig config;
+    config.apply(SLAFullPrintConfig::defaults());
+    config.set_key_value("printer_technology", new ConfigOptionEnum<PrinterTechnology>(ptSLA));
+    config.set_key_value("supports_enable", new ConfigOptionBool(false));
+    config.set_key_value("pad_enable", new ConfigOptionBool(false));
+
+    Model model;
+    ModelObject *object = model.add_object("cube", "", make_cube(10., 10., 5.));
+    // The bed coordinates map onto the display, keep the cube inside it.
+    object->add_instance()->set_offset(Vec3d(30., 30., 0.));
+
+    SLAPrint   print;
+    SL1Archive archive;
+    print.set_printer(&archive);
+    print.set_status_silent();
+    print.apply(model, config);
+    print.process();
+
+    auto path = [](const char *name) {
+        return (boost::filesystem::temp_directory_path() / name).string();
+    };
+
+    archive.export_print(path("cached.sl1"), print, "cube");
+    archive.set_streaming(true, 4);
+    archive.export_print(path("streamed.sl1"), print, "cube");
+
+    auto cached   = read_zip_entries(path("cached.sl1"));
+    auto streamed = read_zip_entries(path("streamed.sl1"));
+    boost::filesystem::remove(path("cached.sl1"));
+    boost::filesystem::remove(path("streamed.sl1"));
+
+    // The creation time stamp is the only content that may differ.
+    for (auto *entries : {&cached, &streamed})
+        for (auto &entry : *entries)
+            if (entry.first == "config.ini") {
+                size_t pos = entry.second.find("fileCreationTimestamp");
+                entry.second.erase(pos, entry.second.find('\n', pos) - pos);
+            }
+
+    REQUIRE(cached.size() == print.print_layers().size() + 2);
+    REQUIRE(streamed == cached);
+
+    // A canceled print stops the streamed export.
+    print.cancel();
+    REQUIRE_THROWS_AS(archive.export_print(path("canceled.sl1"), print, "cube"), CanceledException);
+    boost::filesystem::remove(path("canceled.sl1"));
+}
+
+TEST_CASE("Run-length encoded SL1 archive should import like the PNG one", "[SLAArchive]") {
+    DynamicPrintConfig config;
+    config.apply(SLAFullPrintConfig::defaults());
+    config.set_key_value("printer_technology", new ConfigOptionEnum<PrinterTechnology>(ptSLA));
+    config.set_key_value("supports_enable", new ConfigOptionBool(false));
+    config.set_key_value("pad_enable", new ConfigOptionBool(false));
+
+    Model model;
+    ModelObject *object = model.add_object("cube", "", make_cube(10., 10., 5.));
+    // The bed coordinates map onto the display, keep the cube inside it.
+    object->add_instance()->set_offset(Vec3d(30., 30., 0.));
+
+    SLAPrint   print;
+    SL1Archive archive;
+    print.set_printer(&archive);
+    print.set_status_silent();
+
+    auto export_import = [&](SLALayerEncoding encoding) {
+        config.set_key_value("layer_encoding", new ConfigOptionEnum<SLALayerEncoding>(encoding));
+        print.apply(model, config);
+        print.process();
+
+        std::string path = (boost::filesystem::temp_directory_path() / "encoded.sl1").string();
+        archive.export_print(path, print, "cube");
+
+        TriangleMesh mesh;
+        import_sla_archive(path, {2, 2}, mesh);
+        boost::filesystem::remove(path);
+
+        return mesh;
+    };
+
+    TriangleMesh png_mesh = export_import(slalePNG);
+    // The marching squares reconstruction is only approximate, the RLE
+    // archives have to reproduce it exactly though.
+    REQUIRE(png_mesh.volume() == Approx(500.).epsilon(0.1));
+
+    for (SLALayerEncoding encoding : {slaleRLE, slaleDeltaRLE}) {
+        TriangleMesh mesh = export_import(encoding);
+        REQUIRE(mesh.its.vertices == png_mesh.its.vertices);
+        REQUIRE(mesh.its.indices == png_mesh.its.indices);
+    }
+}
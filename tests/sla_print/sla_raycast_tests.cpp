@@ -95,3 +95,30 @@ TEST_CASE("Raycaster with loaded drillholes", "[sla_raycast]")
     test_support_model_collision("20mm_cube.obj", {}, hcfg, holes);
 }
 #endif
+
+TEST_CASE("Batched ray casts should match the single ones", "[sla_raycast]")
+{
+    TriangleMesh mesh = load_model("A_upsidedown.obj");
+    sla::IndexedMesh emesh{mesh};
+
+    // Fans of rays from points above, around and inside the model
+    auto bb = mesh.bounding_box();
+    std::vector<Vec3d> sources, dirs;
+    for (const Vec3d &s : {bb.center(), Vec3d(bb.center() + Vec3d(0., 0., bb.size().z())),
+                           Vec3d(bb.min - Vec3d::Ones())})
+        for (size_t i = 0; i < 100; ++i) {
+            double phi = 2 * PI * double(i) / 100.;
+            sources.emplace_back(s);
+            dirs.emplace_back(Vec3d(std::cos(phi), std::sin(phi), -0.5 + double(i % 3) / 2.).normalized());
+        }
+
+    std::vector<sla::IndexedMesh::hit_result> hits = emesh.query_ray_hit(sources, dirs);
+    REQUIRE(hits.size() == sources.size());
+
+    for (size_t i = 0; i < sources.size(); ++i) {
+        auto hit = emesh.query_ray_hit(sources[i], dirs[i]);
+        REQUIRE(hits[i].is_hit() == hit.is_hit());
+        REQUIRE(hits[i].face() == hit.face());
+        if (hit.is_hit()) REQUIRE(hits[i].distance() == Approx(hit.distance()));
+    }
+}
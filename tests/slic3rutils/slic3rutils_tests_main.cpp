@@ -1,6 +1,9 @@
 #include <catch_main.hpp>
 
+#include <random>
+
 #include "slic3r/Utils/Http.hpp"
+#include "slic3r/Utils/UndoRedoDelta.hpp"
 
 TEST_CASE("Http", "[Http][NotWorking]") {
     
@@ -20,3 +23,48 @@ TEST_CASE("Http", "[Http][NotWorking]") {
     REQUIRE(status == 200);
 }
 
+
+TEST_CASE("Undo / Redo delta encoding round trip", "[UndoRedo]") {
+    // A snapshot of a big mutable object and the next snapshot of it after an edit.
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::string base(100000, 0);
+    for (char &c : base)
+        c = char(byte(rng));
+
+    auto round_trip = [&base](const std::string &data) {
+        std::string delta = Slic3r::UndoRedo::delta::encode(base.data(), base.size(), data);
+        std::string decoded;
+        Slic3r::UndoRedo::delta::decode(base, delta.data(), delta.size(), decoded);
+        REQUIRE(decoded == data);
+        return delta.size();
+    };
+
+    SECTION("Unchanged snapshot") {
+        REQUIRE(round_trip(base) < 100);
+    }
+    SECTION("Scattered edits of constant size") {
+        std::string data = base;
+        for (size_t i = 1000; i < data.size(); i += 10007)
+            data[i] = char(~ data[i]);
+        REQUIRE(round_trip(data) < data.size() / 10);
+    }
+    SECTION("Inserted, removed and appended data") {
+        std::string data = base;
+        data.insert(50001, "inserted");
+        REQUIRE(round_trip(data) < data.size() / 10);
+        data.erase(20000, 333);
+        round_trip(data);
+        data += "appended";
+        round_trip(data);
+    }
+    SECTION("Unrelated, shorter and empty snapshots") {
+        std::string data(base.size(), 0);
+        for (char &c : data)
+            c = char(byte(rng));
+        round_trip(data);
+        round_trip(base.substr(0, 12345));
+        round_trip(base.substr(777));
+        round_trip(std::string());
+    }
+}